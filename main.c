@@ -4,6 +4,8 @@
 #include "src/types.h"
 #include "src/haze.h"
 #include "src/geos-ops.h"
+#include "src/output-store.h"
+#include "src/series-store.h"
 #include <stdio.h>
 #include <stddef.h>
 #include <geos_c.h>
@@ -65,6 +67,20 @@ int main(int argc, char *argv[])
             exitCode = EXIT_FAILURE;
             goto teardown;
         }
+    } else if (opts->exportStore) {
+        int exportFailed = opts->exportSeries
+                           ? writeSeriesStore(opts->storePath, opts->outputDirectory)
+                           : exportStore(opts->storePath, opts->outputDirectory);
+        if (exportFailed) {
+            fprintf(stderr, "Failed to export output store\n");
+            exitCode = EXIT_FAILURE;
+            goto teardown;
+        }
+    } else if (opts->query) {
+        if (querySeries(opts)) {
+            exitCode = EXIT_FAILURE;
+            goto teardown;
+        }
     }
 
 teardown:
@@ -1,8 +1,9 @@
 #! /usr/bin/env bash
 
 # This script serves as an example of processing several ERA-5 datasets in parallel using haze.
-# Since haze doesn't come with multi-processing/multi-threading capabilities on its own,
-# external tools like GNU parallel which are widely available need to be leveraged.
+# On a single machine, prefer `haze process --jobs N` which reads the AOI only once and hands
+# out datasets dynamically. This script remains useful to distribute work with external tools
+# like GNU parallel, e.g. across several machines.
 #
 # The script splits an original log file into equal chunks (i.e. files to process) and
 # and merges them afterwards, thus overwriting the file given by `ORIGINAL_LOGFILE`.
@@ -0,0 +1,290 @@
+#define _POSIX_C_SOURCE 200809L
+#include "aoi-cache.h"
+#include "manifest.h"
+#include "math-utils.h"
+#include "paths.h"
+#include "polygon-store.h"
+#include "strtree.h"
+#include "types.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <gdal/ogr_core.h>
+
+int aoiCacheKey(const char *filePath, const char *layerName, const char *inputReferenceSystem,
+                bool readPrecomputedCentroid, const OGREnvelope *spatialFilter, double simplifyTolerance,
+                uint64_t *key)
+{
+  struct stat sourceStat;
+
+  if (stat(filePath, &sourceStat) != 0) {
+    perror("stat");
+    return 1;
+  }
+
+  int64_t fileIdentity[3] = {
+    (int64_t) sourceStat.st_size,
+    (int64_t) sourceStat.st_mtim.tv_sec,
+    (int64_t) sourceStat.st_mtim.tv_nsec
+  };
+  const char *layer = layerName == NULL ? "" : layerName;
+  int flags = readPrecomputedCentroid ? 1 : 0;
+
+  // separators keep e.g. layer "ab" of file "x" apart from layer "b" of file "xa"
+  uint64_t hash = fnv1a(filePath, strlen(filePath) + 1, FNV1A_OFFSET_BASIS);
+  hash = fnv1a(fileIdentity, sizeof(fileIdentity), hash);
+  hash = fnv1a(layer, strlen(layer) + 1, hash);
+  hash = fnv1a(inputReferenceSystem, strlen(inputReferenceSystem) + 1, hash);
+  hash = fnv1a(&flags, sizeof(int), hash);
+
+  if (spatialFilter != NULL) {
+    double filter[4] = {spatialFilter->MinX, spatialFilter->MinY, spatialFilter->MaxX, spatialFilter->MaxY};
+    hash = fnv1a(filter, sizeof(filter), hash);
+  }
+
+  if (simplifyTolerance > 0.0) {
+    hash = fnv1a(&simplifyTolerance, sizeof(double), hash);
+  }
+
+  *key = hash;
+
+  return 0;
+}
+
+int readCacheField(const unsigned char *buffer, size_t size, size_t *offset, void *field,
+                   size_t fieldSize)
+{
+  if (size - *offset < fieldSize) {
+    return 1;
+  }
+
+  memcpy(field, buffer + *offset, fieldSize);
+  *offset += fieldSize;
+
+  return 0;
+}
+
+unsigned char *readWholeFile(const char *filePath, size_t *size)
+{
+  int fd = open(filePath, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+    close(fd);
+    return NULL;
+  }
+
+  unsigned char *buffer = malloc((size_t) fileStat.st_size);
+  if (buffer == NULL) {
+    perror("malloc");
+    close(fd);
+    return NULL;
+  }
+
+  size_t total = 0;
+
+  while (total < (size_t) fileStat.st_size) {
+    ssize_t bytesRead = read(fd, buffer + total, (size_t) fileStat.st_size - total);
+
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (bytesRead <= 0) {
+      free(buffer);
+      close(fd);
+      return NULL;
+    }
+
+    total += (size_t) bytesRead;
+  }
+
+  close(fd);
+  *size = total;
+
+  return buffer;
+}
+
+[[nodiscard]] vectorGeometryVector *readAOICache(const char *cachePath, uint64_t key)
+{
+  size_t size = 0;
+  unsigned char *buffer = readWholeFile(cachePath, &size);
+
+  if (buffer == NULL) {
+    return NULL;
+  }
+
+  size_t offset = 0;
+  char magic[AOI_CACHE_MAGIC_SIZE];
+  uint64_t storedKey;
+  uint64_t featureCount;
+
+  if (readCacheField(buffer, size, &offset, magic, AOI_CACHE_MAGIC_SIZE)
+      || memcmp(magic, AOI_CACHE_MAGIC, AOI_CACHE_MAGIC_SIZE) != 0
+      || readCacheField(buffer, size, &offset, &storedKey, sizeof(uint64_t))
+      || storedKey != key
+      || readCacheField(buffer, size, &offset, &featureCount, sizeof(uint64_t))) {
+    free(buffer);
+    return NULL;
+  }
+
+  vectorGeometryVector *geometries = malloc(sizeof(vectorGeometryVector));
+  if (geometries == NULL) {
+    perror("malloc");
+    free(buffer);
+    return NULL;
+  }
+
+  geometries->entries = malloc((featureCount > 0 ? featureCount : 1) * sizeof(struct vectorGeometry));
+  geometries->capacity = featureCount;
+  geometries->size = 0;
+  geometries->digest = 0;
+
+  if (geometries->entries == NULL) {
+    fprintf(stderr, "Failed to allocate memory for AOI geometries read from cache\n");
+    freeVectorGeometryList(geometries);
+    free(buffer);
+    return NULL;
+  }
+
+  bool failed = false;
+
+  for (uint64_t i = 0; i < featureCount; i++) {
+    struct vectorGeometry *feature = &geometries->entries[geometries->size];
+    compactPolygon *polygon = &feature->polygon;
+    uint32_t structure[4];
+
+    if (readCacheField(buffer, size, &offset, &feature->id, sizeof(GIntBig))
+        || readCacheField(buffer, size, &offset, &feature->precomutedLongitude, sizeof(double))
+        || readCacheField(buffer, size, &offset, &feature->precomputedLatitude, sizeof(double))
+        || readCacheField(buffer, size, &offset, &feature->hash, sizeof(uint64_t))
+        || readCacheField(buffer, size, &offset, &polygon->envelope, sizeof(OGREnvelope))
+        || readCacheField(buffer, size, &offset, structure, sizeof(structure))
+        || allocateCompactPolygon(polygon, structure[0], structure[1], structure[2])) {
+      failed = true;
+      break;
+    }
+
+    polygon->isMulti = structure[3] != 0;
+    // acquisition times are not cached, they're read from the AOI file on every run
+    feature->acquisitionHour = NAN;
+    // features are cached in layer order
+    feature->order = geometries->size;
+
+    // coordinates and offsets are restored with a single copy of the stored block
+    if (readCacheField(buffer, size, &offset, polygon->coordinates,
+                       compactPolygonBlockSize(structure[0], structure[1], structure[2]))) {
+      // size only covers completely restored features, clean up this one manually
+      freeVectorGeometry(feature);
+      failed = true;
+      break;
+    }
+
+    geometries->size++;
+  }
+
+  free(buffer);
+
+  if (failed || offset != size) {
+    fprintf(stderr, "AOI cache %s is corrupt, ignoring it\n", cachePath);
+    freeVectorGeometryList(geometries);
+    return NULL;
+  }
+
+  return geometries;
+}
+
+int writeAOICache(const char *cachePath, uint64_t key, const vectorGeometryVector *geometries)
+{
+  char *temporaryPath = constructFilePath("%s.%d.tmp", cachePath, (int) getpid());
+  if (temporaryPath == NULL) {
+    fprintf(stderr, "Failed to construct path of temporary AOI cache\n");
+    return 1;
+  }
+
+  FILE *f = fopen(temporaryPath, "wb");
+  if (f == NULL) {
+    perror("fopen");
+    free(temporaryPath);
+    return 1;
+  }
+
+  uint64_t featureCount = geometries->size;
+  bool failed = fwrite(AOI_CACHE_MAGIC, AOI_CACHE_MAGIC_SIZE, 1, f) != 1
+                || fwrite(&key, sizeof(uint64_t), 1, f) != 1
+                || fwrite(&featureCount, sizeof(uint64_t), 1, f) != 1;
+
+  for (size_t i = 0; i < geometries->size && !failed; i++) {
+    const struct vectorGeometry *feature = &geometries->entries[i];
+    const compactPolygon *polygon = &feature->polygon;
+    uint32_t structure[4] = {polygon->pointCount, polygon->ringCount, polygon->partCount, polygon->isMulti};
+
+    failed = fwrite(&feature->id, sizeof(GIntBig), 1, f) != 1
+             || fwrite(&feature->precomutedLongitude, sizeof(double), 1, f) != 1
+             || fwrite(&feature->precomputedLatitude, sizeof(double), 1, f) != 1
+             || fwrite(&feature->hash, sizeof(uint64_t), 1, f) != 1
+             || fwrite(&polygon->envelope, sizeof(OGREnvelope), 1, f) != 1
+             || fwrite(structure, sizeof(structure), 1, f) != 1
+             || fwrite(polygon->coordinates, compactPolygonBlockSize(polygon->pointCount,
+                       polygon->ringCount, polygon->partCount), 1, f) != 1;
+  }
+
+  if (fclose(f) != 0 || failed) {
+    fprintf(stderr, "Failed to write AOI cache %s\n", cachePath);
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  if (rename(temporaryPath, cachePath) != 0) {
+    perror("rename");
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  free(temporaryPath);
+
+  return 0;
+}
+
+[[nodiscard]] vectorGeometryVector *buildGEOSGeometriesCached(const char *filePath,
+    const char *layerName, const char *inputReferenceSystem, bool readPrecomputedCentroid,
+    int threads, const OGREnvelope *spatialFilter, double simplifyTolerance, const char *cachePath)
+{
+  uint64_t key;
+
+  if (aoiCacheKey(filePath, layerName, inputReferenceSystem, readPrecomputedCentroid, spatialFilter,
+                  simplifyTolerance, &key)) {
+    return NULL;
+  }
+
+  vectorGeometryVector *geometries = readAOICache(cachePath, key);
+
+  if (geometries != NULL) {
+#ifdef DEBUG
+    printf("Read %lu AOI geometries from cache %s\n", geometries->size, cachePath);
+#endif
+    return geometries;
+  }
+
+  geometries = buildGEOSGeometriesFromFile(filePath, layerName, inputReferenceSystem,
+               readPrecomputedCentroid, threads, spatialFilter, simplifyTolerance);
+
+  if (geometries != NULL && writeAOICache(cachePath, key, geometries)) {
+    fprintf(stderr, "Warning: Failed to update AOI cache, continuing without it\n");
+  }
+
+  return geometries;
+}
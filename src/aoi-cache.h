@@ -0,0 +1,122 @@
+#ifndef AOI_CACHE_H
+#define AOI_CACHE_H
+/**
+ * @file aoi-cache.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for a binary cache of reprojected AOI geometries.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup aoi-cache AOI Cache
+ * @{
+ */
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <gdal/ogr_core.h>
+
+/// Magic bytes at the start of an AOI cache, the last byte being the format version
+#define AOI_CACHE_MAGIC "HAZEAOI\002"
+
+/// Number of magic bytes
+#define AOI_CACHE_MAGIC_SIZE 8
+
+/**
+ * @brief Compute the key of an AOI cache
+ *
+ * @details The key covers the source file's path, size and modification time, the layer name, the
+ *          target reference system, whether precomputed centroids are read, the spatial filter and
+ *          the simplification tolerance.
+ *          A cache is only used if its key matches.
+ *
+ * @param filePath Path to AOI dataset.
+ * @param layerName Name of layer to read, possibly NULL.
+ * @param inputReferenceSystem WKT of reference system geometries are reprojected to.
+ * @param readPrecomputedCentroid Whether precomputed centroids are read.
+ * @param spatialFilter Extent features are restricted to, possibly NULL.
+ * @param simplifyTolerance Tolerance features are simplified with, 0 if they're not simplified.
+ * @param key Set to the resulting key.
+ * @return int 0 on success, 1 on error.
+ */
+int aoiCacheKey(const char *filePath, const char *layerName, const char *inputReferenceSystem,
+                bool readPrecomputedCentroid, const OGREnvelope *spatialFilter, double simplifyTolerance,
+                uint64_t *key);
+
+/**
+ * @brief Copy a field out of a buffer
+ *
+ * @param buffer Buffer to read from.
+ * @param size Size of buffer.
+ * @param offset Offset of field, advanced past the field on success.
+ * @param field Destination of field.
+ * @param fieldSize Size of field.
+ * @return int 0 on success, 1 if the buffer is exhausted.
+ */
+int readCacheField(const unsigned char *buffer, size_t size, size_t *offset, void *field,
+                   size_t fieldSize);
+
+/**
+ * @brief Read an entire file into memory with a single sequential read
+ *
+ * @note The caller must free the returned buffer.
+ *
+ * @param filePath Path to file.
+ * @param size Set to the number of bytes read.
+ * @return unsigned char* File contents, NULL if the file is missing, empty or could not be read.
+ */
+unsigned char *readWholeFile(const char *filePath, size_t *size);
+
+/**
+ * @brief Load area of interest from a cache
+ *
+ * @details The cache is read with a single sequential read. Compact polygons are stored as is,
+ *          thus restoring them only copies their coordinate blocks.
+ *
+ * @note The caller must free the returned vector with freeVectorGeometryList().
+ *
+ * @param cachePath Path to cache.
+ * @param key Expected key of the cache.
+ * @return vectorGeometryVector* Vector of AOI geometries, NULL if the cache is missing, stale or invalid.
+ */
+[[nodiscard]] vectorGeometryVector *readAOICache(const char *cachePath, uint64_t key);
+
+/**
+ * @brief Write area of interest to a cache
+ *
+ * @details The cache is written to a temporary file first and moved into place afterwards.
+ *
+ * @param cachePath Path to cache.
+ * @param key Key of the cache.
+ * @param geometries Vector of AOI geometries as returned by buildGEOSGeometriesFromFile().
+ * @return int 0 on success, 1 on error.
+ */
+int writeAOICache(const char *cachePath, uint64_t key, const vectorGeometryVector *geometries);
+
+/**
+ * @brief Read area of interest from a cache if it's up to date, otherwise from the source file
+ *
+ * @details If the source file is read, the cache is rewritten afterwards. Failing to write the
+ *          cache is not considered an error.
+ *
+ * @note The caller must free the returned vector with freeVectorGeometryList().
+ *
+ * @param filePath Path to AOI dataset.
+ * @param layerName Name of layer to read, possibly NULL.
+ * @param inputReferenceSystem WKT of reference system geometries are reprojected to.
+ * @param readPrecomputedCentroid Whether precomputed centroids are read.
+ * @param threads Number of threads used when reading the source file.
+ * @param spatialFilter Extent features are restricted to, possibly NULL.
+ * @param simplifyTolerance Tolerance features are simplified with, 0 to keep them as they are.
+ * @param cachePath Path to cache.
+ * @return vectorGeometryVector* Vector of AOI geometries, NULL on error.
+ */
+[[nodiscard]] vectorGeometryVector *buildGEOSGeometriesCached(const char *filePath,
+    const char *layerName, const char *inputReferenceSystem, bool readPrecomputedCentroid,
+    int threads, const OGREnvelope *spatialFilter, double simplifyTolerance, const char *cachePath);
+
+/** @} */ // end of group
+#endif // AOI_CACHE_H
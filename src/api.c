@@ -3,6 +3,8 @@
 #include "types.h"
 #include "paths.h"
 #include "date-check.h"
+#include "journal.h"
+#include "variables.h"
 #include <curl/easy.h>
 #include <gdal/ogr_core.h>
 #include <jansson.h>
@@ -200,13 +202,14 @@ json_t *jsonArrayFromIntegers(const int *arr, size_t elements, const char *forma
 
 char *constructStringRequest(const int *years, const int *months, const int *days, const int *hours,
                              const size_t yearsElements, const size_t monthsElements, const size_t daysElements,
-                             const size_t hoursElements, const OGREnvelope *aoi)
+                             const size_t hoursElements, const OGREnvelope *aoi, unsigned int variables)
 {
   json_t *yearsArray = NULL;
   json_t *monthsArray = NULL;
   json_t *daysArray = NULL;
   json_t *hoursArray = NULL;
   json_t *aoiArray = NULL;
+  json_t *variablesArray = NULL;
   json_t *jsonRequest = NULL;
 
   if ((yearsArray = jsonArrayFromIntegers(years, yearsElements, "%.4d")) == NULL) {
@@ -229,6 +232,19 @@ char *constructStringRequest(const int *years, const int *months, const int *day
     goto cleanup;
   }
 
+  if ((variablesArray = json_array()) == NULL) {
+    fprintf(stderr, "Failed to create JSON array for requested variables\n");
+    goto cleanup;
+  }
+
+  // all variables go into a single product, thus their bands share one file
+  for (int i = 0; i < variableCount(variables); i++) {
+    if (json_array_append_new(variablesArray, json_string(variableRequestName(nthVariable(variables, i))))) {
+      fprintf(stderr, "Failed to create JSON array for requested variables\n");
+      goto cleanup;
+    }
+  }
+
   if (aoi == NULL) {
     aoiArray = NULL;
   } else {
@@ -246,11 +262,11 @@ char *constructStringRequest(const int *years, const int *months, const int *day
 
   /// NOTE: delegates data-checking to API, i.e. it's valid to submit a request for 31th of Feburary
   // steals references to JSON objects
-  jsonRequest = json_pack("{s: {s:[s], s:o, s:o, s:o, s:o, s:o*, s:s, s:s, s:[s]}}",
+  jsonRequest = json_pack("{s: {s:[s], s:o, s:o, s:o, s:o, s:o*, s:s, s:s, s:o}}",
                           "inputs", "product_type", "reanalysis", "year", yearsArray, "month", monthsArray, "day", daysArray,
                           "time",
                           hoursArray, "area", aoiArray, "data_format", "grib", "download_format", "unarchived", "variable",
-                          "total_column_water_vapour");
+                          variablesArray);
 
   if (jsonRequest == NULL) {
     fprintf(stderr, "Failed to craete complete JSON request\n");
@@ -266,6 +282,7 @@ char *constructStringRequest(const int *years, const int *months, const int *day
 
 // jansson checks for NULL before accessing object members
 cleanup:
+  json_decref(variablesArray);
   json_decref(hoursArray);
   json_decref(daysArray);
   json_decref(monthsArray);
@@ -295,13 +312,6 @@ cleanup:
     return 1;
   }
 
-  FILE *logFile = fopen(options->logFile, "a");
-
-  if (logFile == NULL) {
-    fprintf(stderr, "Failed to open logfile\n");
-    return 1;
-  }
-
   size_t requestedDatasets = 1;
   size_t monthlyDatasetsToRequest = options->yearsElements * options->monthsElements;
   size_t dailyDatasetsToRequest = monthlyDatasetsToRequest * options->daysElements;
@@ -339,7 +349,7 @@ cleanup:
                                                   requestMonths, requestDays,
                                                   options->hours, 1, 1, 1, options->hoursElements, maxAttempts);
 
-          if (fprintf(logFile, "%s\t%s\n", outputPath, requestStatus == 0 ? "DOWNLOADED" : "FAILED") < 0) {
+          if (appendLogRecord(options->logFile, outputPath, requestStatus == 0 ? "DOWNLOADED" : "FAILED")) {
             fprintf(stderr,
                     "Failed to add downloaded file to log file. Deleting file and continuing. (request %lu/%lu)\n",
                     requestedDatasets, dailyDatasetsToRequest);
@@ -349,9 +359,6 @@ cleanup:
             continue;
           }
 
-          // feels more appropriate to write immediately
-          fflush(logFile);
-
           if (requestStatus == 0) {
             fprintf(stderr, "Successfully processed download request %lu/%lu\n", requestedDatasets,
                     dailyDatasetsToRequest);
@@ -390,7 +397,7 @@ cleanup:
                                                 requestMonths,
                                                 options->days, options->hours, 1, 1, options->daysElements, options->hoursElements, maxAttempts);
 
-        if (fprintf(logFile, "%s\t%s\n", outputPath, requestStatus == 0 ? "DOWNLOADED" : "FAILED") < 0) {
+        if (appendLogRecord(options->logFile, outputPath, requestStatus == 0 ? "DOWNLOADED" : "FAILED")) {
           fprintf(stderr,
                   "Failed to add downloaded file to log file. Deleting file and continuing. (request %lu/%lu)\n",
                   requestedDatasets, monthlyDatasetsToRequest);
@@ -400,9 +407,6 @@ cleanup:
           continue;
         }
 
-        // feels more appropriate to write immediately
-        fflush(logFile);
-
         if (requestStatus == 0) {
           fprintf(stderr, "Successfully processed download request %lu/%lu\n", requestedDatasets,
                   monthlyDatasetsToRequest);
@@ -423,8 +427,6 @@ cleanup:
   curl_slist_free_all(header_list);
   curl_easy_cleanup(handle);
 
-  fclose(logFile);
-
   if (failedDownloads) {
     printf(
       "Failed to download %u datasets. Check the log file for entried with status 'FAILED' to re-download them manually. "
@@ -521,7 +523,7 @@ long int slurpAndGetPositiveLongInteger(const char *input, const char *key)
 {
   char *requestId = cdsRequestProduct(handle, subsetYears, subsetMonths, subsetDays,
                                       subsetHours, yearsElements, monthsElements,
-                                      daysElements, hoursElements, aoi);
+                                      daysElements, hoursElements, aoi, options->variables);
 
   if (requestId == NULL) {
     fprintf(stderr, "Failed to request product or extract job id\n");
@@ -563,7 +565,7 @@ long int slurpAndGetPositiveLongInteger(const char *input, const char *key)
 char *cdsRequestProduct(CURL *handle, const int *years, const int *months, const int *days,
                         const int *hours, const size_t yearsElements, const size_t monthsElements,
                         const size_t daysElements, const size_t hoursElements,
-                        const OGREnvelope *aoi)
+                        const OGREnvelope *aoi, unsigned int variables)
 {
   CURL *requestHandle = curl_easy_duphandle(handle);
   if (requestHandle == NULL) {
@@ -573,7 +575,7 @@ char *cdsRequestProduct(CURL *handle, const int *years, const int *months, const
 
   char *stringRequest = constructStringRequest(years, months, days, hours,
                         yearsElements, monthsElements, daysElements, hoursElements,
-                        aoi);
+                        aoi, variables);
   if (stringRequest == NULL) {
     fprintf(stderr, "Failed to export JSON to string\n");
     curl_easy_cleanup(requestHandle);
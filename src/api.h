@@ -131,11 +131,12 @@ json_t *jsonArrayFromIntegers(const int *arr, size_t elements, const char *forma
  * @param daysElements Number of entries in respective array.
  * @param hoursElements Number of entries in respective array.
  * @param aoi Reference to a north-up bounding box with EPSG:4326 coordinates to restrict AOI, possibly NULL.
+ * @param variables VARIABLE_* flags of variables to request within the same product.
  * @return char* Reference to JSON-formatted product request or NULL on error.
  */
 char *constructStringRequest(const int *years, const int *months, const int *days, const int *hours,
                              const size_t yearsElements, const size_t monthsElements, const size_t daysElements,
-                             const size_t hoursElements, const OGREnvelope *aoi);
+                             const size_t hoursElements, const OGREnvelope *aoi, unsigned int variables);
 
 /**
  * @brief Perform product request and download of ERA-5 products
@@ -219,11 +220,13 @@ long int slurpAndGetPositiveLongInteger(const char *input, const char *key);
  * @param daysElements Number of entries in respective array.
  * @param hoursElements Number of entries in respective array.
  * @param aoi Reference to a north-up bounding box with EPSG:4326 coordinates to restrict AOI, possibly NULL.
+ * @param variables VARIABLE_* flags of variables to request within the same product.
  * @return char* Job/Request ID, NULL on error.
  */
 char *cdsRequestProduct(CURL *handle, const int *years, const int *months, const int *days,
                         const int *hours, const size_t yearsElements, const size_t monthsElements,
-                        const size_t daysElements, const size_t hoursElements, const OGREnvelope *aoi);
+                        const size_t daysElements, const size_t hoursElements, const OGREnvelope *aoi,
+                        unsigned int variables);
 
 /**
  * @brief Query the CDS API for the status of a previously created product request
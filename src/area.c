@@ -1,4 +1,5 @@
 #include "area.h"
+#include "types.h"
 #include <gdal/ogr_api.h>
 #include <gdal/ogr_core.h>
 #include <gdal/ogr_srs_api.h>
@@ -87,14 +88,9 @@ double fastMultipolygonialGeodesicArea(const OGRGeometryH geometry, const struct
   return area;
 }
 
-double fastGeodesicArea(const OGRGeometryH geometry, const OGRSpatialReferenceH spatialReference)
+int geodesicFromSpatialReference(const OGRSpatialReferenceH spatialReference,
+                                 struct geod_geodesic *g)
 {
-  // did we REALLY get a valid geometry?
-  if (!OGR_G_IsValid(geometry)) {
-    fprintf(stderr, "Input geometry is not valid\n");
-    return -1.0;
-  }
-
   OGRErr semiMajorError = OGRERR_NONE;
   OGRErr inverseFlatteningError = OGRERR_NONE;
 
@@ -103,12 +99,27 @@ double fastGeodesicArea(const OGRGeometryH geometry, const OGRSpatialReferenceH
 
   if (semiMajorError != OGRERR_NONE || inverseFlatteningError != OGRERR_NONE) {
     fprintf(stderr, "Failed to extract semi-major and inverse flattening from CRS\n");
+    return 1;
+  }
+
+  geod_init(g, semiMajor, inverseFlattening != 0 ? 1.0 / inverseFlattening : 0.0);
+
+  return 0;
+}
+
+double fastGeodesicArea(const OGRGeometryH geometry, const OGRSpatialReferenceH spatialReference)
+{
+  // did we REALLY get a valid geometry?
+  if (!OGR_G_IsValid(geometry)) {
+    fprintf(stderr, "Input geometry is not valid\n");
     return -1.0;
   }
 
   struct geod_geodesic g;
 
-  geod_init(&g, semiMajor, inverseFlattening != 0 ? 1.0 / inverseFlattening : 0.0);
+  if (geodesicFromSpatialReference(spatialReference, &g)) {
+    return -1.0;
+  }
 
   if (OGR_G_GetGeometryType(geometry) == wkbPolygon
       || OGR_G_GetGeometryType(geometry) == wkbPolygon25D) {
@@ -122,3 +133,46 @@ double fastGeodesicArea(const OGRGeometryH geometry, const OGRSpatialReferenceH
 
   return -1.0;
 }
+
+double fastCompactRingGeodesicArea(const double *coordinates, uint32_t pointCount,
+                                   const struct geod_geodesic *g)
+{
+  double area = 0.0;
+  struct geod_polygon polygon;
+
+  // points are added one by one, thus no separate arrays of latitudes and longitudes are needed
+  geod_polygon_init(&polygon, 0);
+
+  for (uint32_t point = 0; point < pointCount; point++) {
+    geod_polygon_addpoint(g, &polygon, coordinates[2 * (size_t) point + 1],
+                          coordinates[2 * (size_t) point]);
+  }
+
+  geod_polygon_compute(g, &polygon, 0, 1, &area, NULL);
+
+  return fabs(area);
+}
+
+double fastCompactGeodesicArea(const compactPolygon *polygon,
+                               const OGRSpatialReferenceH spatialReference)
+{
+  struct geod_geodesic g;
+
+  if (geodesicFromSpatialReference(spatialReference, &g)) {
+    return -1.0;
+  }
+
+  double area = 0.0;
+
+  for (uint32_t part = 0; part < polygon->partCount; part++) {
+    for (uint32_t ring = polygon->partOffsets[part]; ring < polygon->partOffsets[part + 1]; ring++) {
+      double ringArea = fastCompactRingGeodesicArea(polygon->coordinates + 2 * (size_t)
+                        polygon->ringOffsets[ring], polygon->ringOffsets[ring + 1] - polygon->ringOffsets[ring], &g);
+
+      // first ring of each part is the exterior one
+      area += ring == polygon->partOffsets[part] ? ringArea : -ringArea;
+    }
+  }
+
+  return area;
+}
@@ -14,6 +14,8 @@
  * @{
  */
 
+#include "types.h"
+#include <stdint.h>
 #include <gdal/ogr_api.h>
 #include <geodesic.h>
 
@@ -121,5 +123,45 @@ double fastMultipolygonialGeodesicArea(const OGRGeometryH geometry, const struct
  */
 double fastGeodesicArea(const OGRGeometryH geometry, const OGRSpatialReferenceH spatialReference);
 
+/**
+ * @brief Initialize a geodesic from the ellipsoid of a spatial reference
+ *
+ * @param spatialReference Reference to spatial reference object.
+ * @param g Geodesic to initialize.
+ * @return int 0 on success, 1 if semi-major or inverse flattening are not set.
+ */
+int geodesicFromSpatialReference(const OGRSpatialReferenceH spatialReference,
+                                 struct geod_geodesic *g);
+
+/**
+ * @brief Fast Computation of Geodesic Area for a Ring of a Compact Polygon
+ *
+ * @details Same as fastLinearRingGeodesicArea() but reads interleaved x/y coordinates directly,
+ *          without copying them into separate arrays first.
+ *
+ * @param coordinates Interleaved longitude/latitude pairs of the ring.
+ * @param pointCount Number of points of the ring.
+ * @param g Reference to an initialized `struct geod_geodesic`.
+ * @return double Area of the ring.
+ */
+double fastCompactRingGeodesicArea(const double *coordinates, uint32_t pointCount,
+                                   const struct geod_geodesic *g);
+
+/**
+ * @brief Fast Computation of Geodesic Area for Compact Polygons
+ *
+ * @details Same as fastGeodesicArea() but operating on a compact polygon, see polygon-store.h.
+ *          Validity of the polygon is not checked, the caller is responsible for that.
+ *
+ * @ref fastGeodesicArea(), fastCompactRingGeodesicArea()
+ *
+ * @param polygon Reference to compact polygon whose area should be calculated.
+ * @param spatialReference Reference to spatial reference object which describes
+ *        the CRS of `polygon`.
+ * @return double Area of `polygon`, -1.0 on error.
+ */
+double fastCompactGeodesicArea(const compactPolygon *polygon,
+                               const OGRSpatialReferenceH spatialReference);
+
 /** @} */ // end of group
 #endif // AREA_H
\ No newline at end of file
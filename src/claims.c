@@ -0,0 +1,622 @@
+#define _POSIX_C_SOURCE 200809L
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include "claims.h"
+#include "haze.h"
+#include "journal.h"
+#include "math-utils.h"
+#include "paths.h"
+#include "types.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+char *claimPath(const char *claimDirectory, const char *datasetPath, const char *suffix)
+{
+  uint64_t hash = fnv1a(datasetPath, strlen(datasetPath), FNV1A_OFFSET_BASIS);
+
+  return constructFilePath("%s/%016llx.%s", claimDirectory, (unsigned long long) hash, suffix);
+}
+
+int initClaimState(claimState *state, stringList *list, const char *logFile, int expiry)
+{
+  memset(state, 0, sizeof(claimState));
+  state->cursor = list;
+  state->expiry = expiry;
+
+  state->claimDirectory = constructFilePath("%s.claims", logFile);
+  if (state->claimDirectory == NULL) {
+    fprintf(stderr, "Failed to construct path of claim directory\n");
+    return 1;
+  }
+
+  if (mkdir(state->claimDirectory, 0755) != 0 && errno != EEXIST) {
+    perror("mkdir");
+    free(state->claimDirectory);
+    return 1;
+  }
+
+  char hostName[HOST_NAME_MAX + 1] = {0};
+  if (gethostname(hostName, HOST_NAME_MAX) != 0) {
+    strcpy(hostName, "unknown");
+  }
+
+  state->instance = constructFilePath("%s.%d", hostName, (int) getpid());
+  if (state->instance == NULL) {
+    fprintf(stderr, "Failed to construct instance identifier\n");
+    free(state->claimDirectory);
+    return 1;
+  }
+
+  state->instancePath = constructFilePath("%s/%s.instance", state->claimDirectory, state->instance);
+  time_t now;
+
+  if (state->instancePath == NULL || touchInstanceFile(state->instancePath, &now)) {
+    fprintf(stderr, "Failed to register instance in claim directory\n");
+    free(state->instancePath);
+    free(state->instance);
+    free(state->claimDirectory);
+    return 1;
+  }
+
+  // done markers are removed once no other instance is registered, thus entries merged into the
+  // log file before registering must be known from the log file itself
+  if (refreshProcessedEntries(list, logFile)) {
+    fprintf(stderr, "Failed to refresh statuses from log file\n");
+    unlink(state->instancePath);
+    free(state->instancePath);
+    free(state->instance);
+    free(state->claimDirectory);
+    return 1;
+  }
+
+  if (pthread_mutex_init(&state->lock, NULL) != 0) {
+    fprintf(stderr, "Failed to initialize claim mutex\n");
+    unlink(state->instancePath);
+    free(state->instancePath);
+    free(state->instance);
+    free(state->claimDirectory);
+    return 1;
+  }
+
+  if (pthread_cond_init(&state->wake, NULL) != 0) {
+    fprintf(stderr, "Failed to initialize claim condition variable\n");
+    pthread_mutex_destroy(&state->lock);
+    unlink(state->instancePath);
+    free(state->instancePath);
+    free(state->instance);
+    free(state->claimDirectory);
+    return 1;
+  }
+
+  if (pthread_create(&state->heartbeat, NULL, heartbeatClaims, state) != 0) {
+    fprintf(stderr, "Failed to start heartbeat thread\n");
+    pthread_cond_destroy(&state->wake);
+    pthread_mutex_destroy(&state->lock);
+    unlink(state->instancePath);
+    free(state->instancePath);
+    free(state->instance);
+    free(state->claimDirectory);
+    return 1;
+  }
+
+  return 0;
+}
+
+int touchInstanceFile(const char *path, time_t *modificationTime)
+{
+  int fd = open(path, O_WRONLY | O_CREAT, 0644);
+  if (fd < 0) {
+    perror("open");
+    return 1;
+  }
+
+  // without explicit times, the file system sets the current time, on NFS that of the server
+  struct stat fileStat;
+  bool failed = futimens(fd, NULL) != 0 || fstat(fd, &fileStat) != 0;
+
+  if (failed) {
+    perror("futimens");
+  }
+
+  close(fd);
+
+  if (failed) {
+    return 1;
+  }
+
+  *modificationTime = fileStat.st_mtime;
+
+  return 0;
+}
+
+int refreshProcessedEntries(stringList *list, const char *logFile)
+{
+  stringList *current = parseLogFile(logFile);
+  if (current == NULL) {
+    return 1;
+  }
+
+  // both lists are usually in the same order, thus searching continues after the last match
+  stringList *start = current;
+
+  for (stringList *ptr = list; ptr != NULL; ptr = ptr->next) {
+    if (strcmp("DOWNLOADED", ptr->status) != 0) {
+      continue;
+    }
+
+    stringList *candidate = start;
+
+    do {
+      if (strcmp(candidate->string, ptr->string) == 0) {
+        break;
+      }
+      candidate = candidate->next != NULL ? candidate->next : current;
+    } while (candidate != start);
+
+    if (strcmp(candidate->string, ptr->string) != 0) {
+      continue;
+    }
+
+    start = candidate;
+
+    if (strcmp("PROCESSED", candidate->status) == 0) {
+      char *msg = strdup("PROCESSED");
+      if (msg == NULL) {
+        perror("strdup");
+        freeStringList(current);
+        return 1;
+      }
+
+      free(ptr->status);
+      ptr->status = msg;
+    }
+  }
+
+  freeStringList(current);
+
+  return 0;
+}
+
+void destroyClaimState(claimState *state)
+{
+  pthread_mutex_lock(&state->lock);
+  state->stop = true;
+  pthread_cond_signal(&state->wake);
+  pthread_mutex_unlock(&state->lock);
+
+  pthread_join(state->heartbeat, NULL);
+
+  // claims still held at this point belong to entries that were never completed
+  for (size_t i = 0; i < state->heldCount; i++) {
+    unlink(state->held[i]);
+    free(state->held[i]);
+  }
+
+  unlink(state->instancePath);
+
+  free(state->held);
+  free(state->instancePath);
+  free(state->instance);
+  free(state->claimDirectory);
+  pthread_cond_destroy(&state->wake);
+  pthread_mutex_destroy(&state->lock);
+}
+
+int trackClaim(claimState *state, char *path)
+{
+  pthread_mutex_lock(&state->lock);
+
+  if (state->heldCount == state->heldCapacity) {
+    size_t newCapacity = state->heldCapacity == 0 ? 4 : state->heldCapacity * 2;
+    char **newHeld = realloc(state->held, newCapacity * sizeof(char *));
+    if (newHeld == NULL) {
+      perror("realloc");
+      pthread_mutex_unlock(&state->lock);
+      return 1;
+    }
+    state->held = newHeld;
+    state->heldCapacity = newCapacity;
+  }
+
+  state->held[state->heldCount++] = path;
+
+  pthread_mutex_unlock(&state->lock);
+
+  return 0;
+}
+
+char *untrackClaim(claimState *state, const char *path)
+{
+  char *tracked = NULL;
+
+  pthread_mutex_lock(&state->lock);
+
+  for (size_t i = 0; i < state->heldCount; i++) {
+    if (strcmp(state->held[i], path) == 0) {
+      tracked = state->held[i];
+      state->held[i] = state->held[state->heldCount - 1];
+      state->heldCount--;
+      break;
+    }
+  }
+
+  pthread_mutex_unlock(&state->lock);
+
+  return tracked;
+}
+
+int createClaim(const char *path, const char *instance, const char *datasetPath)
+{
+  int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    return 1;
+  }
+
+  // content is informative only, ownership is determined by the existence of the file
+  FILE *f = fdopen(fd, "w");
+  if (f == NULL) {
+    close(fd);
+    return 0;
+  }
+
+  fprintf(f, "%s\n%s\n", instance, datasetPath);
+  fclose(f);
+
+  return 0;
+}
+
+int tryClaim(claimState *state, const char *datasetPath)
+{
+  char *donePath = claimPath(state->claimDirectory, datasetPath, "done");
+  char *path = claimPath(state->claimDirectory, datasetPath, "claim");
+
+  if (donePath == NULL || path == NULL) {
+    fprintf(stderr, "Failed to construct path of claim file\n");
+    free(donePath);
+    free(path);
+    return 1;
+  }
+
+  struct stat fileStat;
+  bool done = stat(donePath, &fileStat) == 0;
+  free(donePath);
+
+  if (done) {
+    free(path);
+    return 1;
+  }
+
+  if (createClaim(path, state->instance, datasetPath) == 0) {
+    if (trackClaim(state, path)) {
+      unlink(path);
+      free(path);
+      return 1;
+    }
+    return 0;
+  }
+
+  // claims are refreshed with the clock of the file system, thus it's compared against that clock
+  time_t now;
+
+  if (errno != EEXIST || stat(path, &fileStat) != 0 || touchInstanceFile(state->instancePath, &now)
+      || difftime(now, fileStat.st_mtime) <= (double) state->expiry) {
+    free(path);
+    return 1;
+  }
+
+  // stale claim: rename is atomic, thus only one instance gets to remove it
+  char *stalePath = constructFilePath("%s.stale.%s", path, state->instance);
+  if (stalePath == NULL) {
+    free(path);
+    return 1;
+  }
+
+  if (rename(path, stalePath) != 0) {
+    free(stalePath);
+    free(path);
+    return 1;
+  }
+
+  // another instance may have taken over the same claim between stat and rename, in which case its
+  // fresh claim was renamed; link doesn't replace claims created in the meantime
+  if (stat(stalePath, &fileStat) != 0 || touchInstanceFile(state->instancePath, &now)
+      || difftime(now, fileStat.st_mtime) <= (double) state->expiry) {
+    if (link(stalePath, path) != 0) {
+      fprintf(stderr, "Failed to restore claim for %s, it may be processed twice\n", datasetPath);
+    }
+
+    unlink(stalePath);
+    free(stalePath);
+    free(path);
+    return 1;
+  }
+
+  fprintf(stderr, "Taking over stale claim for %s\n", datasetPath);
+  unlink(stalePath);
+  free(stalePath);
+
+  if (createClaim(path, state->instance, datasetPath) == 0) {
+    if (trackClaim(state, path)) {
+      unlink(path);
+      free(path);
+      return 1;
+    }
+    return 0;
+  }
+
+  free(path);
+  return 1;
+}
+
+stringList *nextClaimedEntry(entryProvider *provider)
+{
+  claimState *state = (claimState *) provider->state;
+
+  while (state->cursor != NULL) {
+    stringList *entry = state->cursor;
+    state->cursor = entry->next;
+
+    if (strcmp("DOWNLOADED", entry->status) == 0 && tryClaim(state, entry->string) == 0) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+void completeClaimedEntry(entryProvider *provider, stringList *entry, bool success)
+{
+  claimState *state = (claimState *) provider->state;
+
+  markEntry(provider, entry, success);
+
+  char *path = claimPath(state->claimDirectory, entry->string, "claim");
+  if (path == NULL) {
+    fprintf(stderr, "Failed to construct path of claim file for %s\n", entry->string);
+    return;
+  }
+
+  free(untrackClaim(state, path));
+
+#ifndef DEBUG
+  if (success) {
+    char *donePath = claimPath(state->claimDirectory, entry->string, "done");
+    if (donePath == NULL || rename(path, donePath) != 0) {
+      fprintf(stderr, "Failed to mark claim of %s as done\n", entry->string);
+      unlink(path);
+    }
+    free(donePath);
+    free(path);
+    return;
+  }
+#endif
+
+  // release claim, so that other instances may retry
+  unlink(path);
+  free(path);
+}
+
+void *heartbeatClaims(void *arg)
+{
+  claimState *state = (claimState *) arg;
+  int interval = state->expiry / 3 > 0 ? state->expiry / 3 : 1;
+
+  pthread_mutex_lock(&state->lock);
+
+  while (!state->stop) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += interval;
+
+    while (!state->stop
+           && pthread_cond_timedwait(&state->wake, &state->lock, &deadline) != ETIMEDOUT)
+      ;
+
+    if (state->stop) {
+      break;
+    }
+
+    for (size_t i = 0; i < state->heldCount; i++) {
+      if (utimensat(AT_FDCWD, state->held[i], NULL, 0) != 0) {
+        fprintf(stderr, "Failed to refresh claim %s\n", state->held[i]);
+      }
+    }
+
+    time_t now;
+    if (touchInstanceFile(state->instancePath, &now)) {
+      fprintf(stderr, "Failed to refresh instance %s\n", state->instancePath);
+    }
+  }
+
+  pthread_mutex_unlock(&state->lock);
+
+  return NULL;
+}
+
+bool otherInstancesActive(claimState *state)
+{
+  time_t now;
+  if (touchInstanceFile(state->instancePath, &now)) {
+    return true;
+  }
+
+  DIR *directory = opendir(state->claimDirectory);
+  if (directory == NULL) {
+    perror("opendir");
+    return true;
+  }
+
+  bool active = false;
+  struct dirent *entry;
+
+  while (!active && (entry = readdir(directory)) != NULL) {
+    const char *suffix = strrchr(entry->d_name, '.');
+    if (suffix == NULL || strcmp(suffix, ".instance") != 0) {
+      continue;
+    }
+
+    char *path = constructFilePath("%s/%s", state->claimDirectory, entry->d_name);
+    if (path == NULL) {
+      active = true;
+      break;
+    }
+
+    struct stat fileStat;
+
+    if (strcmp(path, state->instancePath) != 0 && stat(path, &fileStat) == 0) {
+      // crashed instances stop refreshing their file
+      if (difftime(now, fileStat.st_mtime) <= (double) state->expiry) {
+        active = true;
+      } else {
+        unlink(path);
+      }
+    }
+
+    free(path);
+  }
+
+  closedir(directory);
+
+  return active;
+}
+
+int removeDoneMarkers(stringList *list, const char *claimDirectory)
+{
+  size_t count = 0;
+
+  for (stringList *ptr = list; ptr != NULL; ptr = ptr->next) {
+    count += strcmp("PROCESSED", ptr->status) == 0;
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t *hashes = malloc(count * sizeof(uint64_t));
+  if (hashes == NULL) {
+    perror("malloc");
+    return 1;
+  }
+
+  // markers are named after the hash of the dataset path, see claimPath()
+  size_t index = 0;
+
+  for (stringList *ptr = list; ptr != NULL; ptr = ptr->next) {
+    if (strcmp("PROCESSED", ptr->status) == 0) {
+      hashes[index++] = fnv1a(ptr->string, strlen(ptr->string), FNV1A_OFFSET_BASIS);
+    }
+  }
+
+  qsort(hashes, count, sizeof(uint64_t), uint64cmp);
+
+  DIR *directory = opendir(claimDirectory);
+  if (directory == NULL) {
+    perror("opendir");
+    free(hashes);
+    return 1;
+  }
+
+  int status = 0;
+  struct dirent *entry;
+
+  while ((entry = readdir(directory)) != NULL) {
+    char *end;
+    uint64_t hash = (uint64_t) strtoull(entry->d_name, &end, 16);
+
+    if (end - entry->d_name != 16 || strcmp(end, ".done") != 0
+        || bsearch(&hash, hashes, count, sizeof(uint64_t), uint64cmp) == NULL) {
+      continue;
+    }
+
+    char *path = constructFilePath("%s/%s", claimDirectory, entry->d_name);
+    if (path == NULL || (unlink(path) != 0 && errno != ENOENT)) {
+      status = 1;
+    }
+    free(path);
+  }
+
+  closedir(directory);
+  free(hashes);
+
+  return status;
+}
+
+int mergeClaimsIntoLogFile(const char *logFile, claimState *state)
+{
+  const char *claimDirectory = state->claimDirectory;
+
+  int lockFd = lockLogFile(logFile);
+  if (lockFd < 0) {
+    return 1;
+  }
+
+  stringList *list = parseLogFile(logFile);
+  if (list == NULL) {
+    unlockLogFile(lockFd);
+    return 1;
+  }
+
+  struct stat fileStat;
+
+  for (stringList *ptr = list; ptr != NULL; ptr = ptr->next) {
+    if (strcmp("DOWNLOADED", ptr->status) != 0) {
+      continue;
+    }
+
+    char *donePath = claimPath(claimDirectory, ptr->string, "done");
+    if (donePath == NULL) {
+      fprintf(stderr, "Failed to construct path of claim file for %s\n", ptr->string);
+      continue;
+    }
+
+    if (stat(donePath, &fileStat) == 0) {
+      char *msg = strdup("PROCESSED");
+      if (msg == NULL) {
+        fprintf(stderr, "Failed to allocate memory for new message. Not marking %s as processed\n",
+                ptr->string);
+      } else {
+        free(ptr->status);
+        ptr->status = msg;
+      }
+    }
+
+    free(donePath);
+  }
+
+  int status = writeUpdatedLogFile(list, logFile);
+
+  if (status == 0) {
+    // journal was replayed by parseLogFile and is part of the log file now
+    char *journalPath = journalPathFromLogFile(logFile);
+    if (journalPath == NULL || (unlink(journalPath) != 0 && errno != ENOENT)) {
+      fprintf(stderr, "Failed to remove journal of %s\n", logFile);
+      status = 1;
+    }
+    free(journalPath);
+  }
+
+  // markers only keep instances with an outdated list of entries from processing datasets again,
+  // instances registering later read the updated log file
+  if (status == 0 && !otherInstancesActive(state) && removeDoneMarkers(list, claimDirectory)) {
+    fprintf(stderr, "Failed to remove done markers from %s\n", claimDirectory);
+  }
+
+  freeStringList(list);
+  unlockLogFile(lockFd);
+
+  return status;
+}
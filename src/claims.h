@@ -0,0 +1,163 @@
+#ifndef CLAIMS_H
+#define CLAIMS_H
+/**
+ * @file claims.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for coordinating multiple haze instances via claim files.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup claims Sharded Processing via Claim Files
+ * @{
+ */
+
+#include "types.h"
+#include <stdbool.h>
+#include <time.h>
+
+/// Default number of seconds after which a claim without heartbeat is considered stale
+#define DEFAULT_CLAIM_EXPIRY 600
+
+/**
+ * @brief Construct path of the claim file of a log file entry
+ *
+ * @details Claim files are named after the FNV-1a hash of the dataset path, thus all instances
+ *          agree on the name without further coordination.
+ *
+ * @note After the function returns, the caller owns the returned object and must free it after use.
+ *
+ * @param claimDirectory Directory containing claim files.
+ * @param datasetPath Path of dataset as stored in the log file.
+ * @param suffix Suffix of claim file, e.g. "claim" or "done".
+ * @return char* Reference to heap-allocated path, NULL on error.
+ */
+char *claimPath(const char *claimDirectory, const char *datasetPath, const char *suffix);
+
+/**
+ * @brief Initialize claim state and start heartbeat thread
+ *
+ * @details The instance registers itself with a file `<host>.<pid>.instance` in the claim
+ *          directory. Afterwards, entries marked as processed in the log file in the meantime are
+ *          marked as processed in `list` as well.
+ *
+ * @note The claim directory `<logfile>.claims` is created if it doesn't exist yet.
+ *
+ * @param state Reference to uninitialized claim state.
+ * @param list Linked list of log file entries.
+ * @param logFile Path to log file.
+ * @param expiry Number of seconds after which claims without heartbeat are taken over.
+ * @return int 0 on success, 1 on error.
+ */
+int initClaimState(claimState *state, stringList *list, const char *logFile, int expiry);
+
+/**
+ * @brief Touch an instance file and return its new modification time
+ *
+ * @details Modification times are set by the file system, thus they're comparable to those of
+ *          claim files even if the clocks of the nodes sharing the file system differ.
+ *
+ * @param path Path of instance file, it's created if it doesn't exist.
+ * @param modificationTime Output parameter of the modification time.
+ * @return int 0 on success, 1 on error.
+ */
+int touchInstanceFile(const char *path, time_t *modificationTime);
+
+/**
+ * @brief Mark entries processed according to the log file as processed
+ *
+ * @param list Linked list of log file entries to update.
+ * @param logFile Path to log file.
+ * @return int 0 on success, 1 on error.
+ */
+int refreshProcessedEntries(stringList *list, const char *logFile);
+
+/**
+ * @brief Stop heartbeat thread, release claims still held and free claim state
+ *
+ * @param state Reference to initialized claim state.
+ */
+void destroyClaimState(claimState *state);
+
+/**
+ * @brief Try to claim a dataset for this instance
+ *
+ * @details A claim is created with `O_CREAT | O_EXCL`, thus only a single instance succeeds.
+ *          Existing claims whose modification time is older than the expiry are taken over by first
+ *          renaming them to a name unique to this instance, which again only a single instance
+ *          succeeds at, and retrying. If the renamed claim turns out to be fresh, another instance
+ *          took over the stale claim first and its claim is linked back into place. Modification
+ *          times are compared against the clock of the file system. Datasets with a "done" marker
+ *          are never claimed.
+ *
+ * @param state Reference to initialized claim state.
+ * @param datasetPath Path of dataset as stored in the log file.
+ * @return int 0 if the dataset was claimed, 1 otherwise.
+ */
+int tryClaim(claimState *state, const char *datasetPath);
+
+/**
+ * @brief Entry provider callback returning the next log file entry this instance managed to claim
+ *
+ * @param provider Provider whose state is a reference to claimState.
+ * @return stringList* Next entry to process, NULL if no entry is left to claim.
+ */
+stringList *nextClaimedEntry(entryProvider *provider);
+
+/**
+ * @brief Entry provider callback marking an entry as done on success and releasing the claim otherwise
+ *
+ * @note In debug builds, claims are always released, as entries are never marked as processed.
+ *
+ * @param provider Provider whose state is a reference to claimState.
+ * @param entry Log file entry which finished processing.
+ * @param success Whether all tables of the dataset were computed and written.
+ */
+void completeClaimedEntry(entryProvider *provider, stringList *entry, bool success);
+
+/**
+ * @brief Thread function regularly touching all claims held by this instance
+ *
+ * @param arg Reference to claimState.
+ * @return void* Always NULL.
+ */
+void *heartbeatClaims(void *arg);
+
+/**
+ * @brief Check whether any other instance is registered in the claim directory
+ *
+ * @details Instance files not refreshed within the expiry belong to crashed instances and are
+ *          removed.
+ *
+ * @param state Reference to initialized claim state.
+ * @return true If another instance is running or the directory couldn't be read.
+ * @return false Otherwise.
+ */
+bool otherInstancesActive(claimState *state);
+
+/**
+ * @brief Remove "done" markers of entries marked as processed
+ *
+ * @param list Linked list of log file entries.
+ * @param claimDirectory Directory containing claim files.
+ * @return int 0 on success, 1 if any marker couldn't be removed.
+ */
+int removeDoneMarkers(stringList *list, const char *claimDirectory);
+
+/**
+ * @brief Mark all entries of the log file with a "done" marker as processed
+ *
+ * @details The log file is re-read (including its journal) while holding the lock returned by
+ *          lockLogFile(), thus statuses written by other instances in the meantime are preserved.
+ *          The journal is removed afterwards. If no other instance is running, "done" markers of
+ *          processed entries are removed.
+ *
+ * @param logFile Path to log file.
+ * @param state Reference to initialized claim state.
+ * @return int 0 on success, 1 on error.
+ */
+int mergeClaimsIntoLogFile(const char *logFile, claimState *state);
+
+/** @} */ // end of group
+#endif // CLAIMS_H
@@ -0,0 +1,429 @@
+#define _POSIX_C_SOURCE 200809L
+#include "climatology.h"
+#include "math-utils.h"
+#include "output-store.h"
+#include "paths.h"
+#include "table-writer.h"
+#include "types.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <gdal/ogr_core.h>
+
+[[nodiscard]] char *climatologyPath(const char *outputDirectory)
+{
+  return constructFilePath("%s/" CLIMATOLOGY_FILE, outputDirectory);
+}
+
+off_t climatologyBitmapOffset(uint64_t featureCount)
+{
+  return (off_t) (sizeof(struct storeHeader) + featureCount * sizeof(struct storeFeature));
+}
+
+off_t climatologyCellsOffset(uint64_t featureCount, int slot)
+{
+  return climatologyBitmapOffset(featureCount) + CLIMATOLOGY_BITMAP_SIZE
+         + (off_t) ((uint64_t) slot * featureCount * sizeof(struct climatologyCell));
+}
+
+int createClimatology(const char *path, uint64_t featureCount, uint64_t features)
+{
+  struct storeHeader header = {
+    .year = 0,
+    .daySlots = STORE_DAY_SLOTS,
+    .featureCount = featureCount,
+    .features = features
+  };
+  memcpy(header.magic, CLIMATOLOGY_MAGIC, STORE_MAGIC_SIZE);
+
+  struct storeFeature *table = malloc((featureCount > 0 ? featureCount : 1) * sizeof(struct storeFeature));
+  if (table == NULL) {
+    perror("malloc");
+    return 1;
+  }
+
+  for (uint64_t i = 0; i < featureCount; i++) {
+    table[i] = (struct storeFeature) {.fid = OGRNullFID, .x = NAN, .y = NAN};
+  }
+
+  char *temporaryPath = constructFilePath("%s.%d.tmp", path, (int) getpid());
+  if (temporaryPath == NULL) {
+    fprintf(stderr, "Failed to construct path of temporary climatology accumulator\n");
+    free(table);
+    return 1;
+  }
+
+  int fd = open(temporaryPath, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    perror("open");
+    free(temporaryPath);
+    free(table);
+    return 1;
+  }
+
+  // bitmap and cells stay holes of zeros, i.e. no day accumulated and all sums empty
+  bool failed = pwriteFully(fd, &header, sizeof(struct storeHeader), 0)
+                || pwriteFully(fd, table, featureCount * sizeof(struct storeFeature),
+                               (off_t) sizeof(struct storeHeader))
+                || ftruncate(fd, climatologyCellsOffset(featureCount, STORE_DAY_SLOTS)) != 0;
+
+  free(table);
+
+  if (close(fd) != 0 || failed) {
+    fprintf(stderr, "Failed to write climatology accumulator %s\n", path);
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  // unlike rename, link never replaces an accumulator another process created in the meantime
+  if (link(temporaryPath, path) != 0 && errno != EEXIST) {
+    perror("link");
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  unlink(temporaryPath);
+  free(temporaryPath);
+
+  return 0;
+}
+
+int readClimatologyHeader(int fd, const char *path, struct storeHeader *header)
+{
+  if (preadFully(fd, header, sizeof(struct storeHeader), 0)
+      || memcmp(header->magic, CLIMATOLOGY_MAGIC, STORE_MAGIC_SIZE) != 0
+      || header->daySlots != STORE_DAY_SLOTS) {
+    fprintf(stderr, "'%s' is not a climatology accumulator of this version\n", path);
+    return 1;
+  }
+
+  return 0;
+}
+
+int openClimatology(const char *path, uint64_t featureCount, uint64_t features)
+{
+  int fd = open(path, O_RDWR);
+
+  if (fd < 0 && errno == ENOENT) {
+    if (createClimatology(path, featureCount, features)) {
+      return -1;
+    }
+
+    fd = open(path, O_RDWR);
+  }
+
+  if (fd < 0) {
+    perror("open");
+    return -1;
+  }
+
+  struct storeHeader header;
+
+  if (readClimatologyHeader(fd, path, &header)) {
+    close(fd);
+    return -1;
+  }
+
+  if (header.featureCount != featureCount || header.features != features) {
+    fprintf(stderr, "Climatology accumulator %s was written for a different AOI, use another output directory\n",
+            path);
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+int accumulateClimatology(const char *outputDirectory, const meanVector *values)
+{
+  int slot = storeSlot(values->month, values->day);
+  int year = values->year - CLIMATOLOGY_FIRST_YEAR;
+
+  if (slot < 0 || year < 0 || year >= CLIMATOLOGY_YEARS) {
+    fprintf(stderr, "Date %.4d-%.2d-%.2d is out of range of the climatology accumulator\n",
+            values->year, values->month, values->day);
+    return 1;
+  }
+
+  char *path = climatologyPath(outputDirectory);
+  if (path == NULL) {
+    fprintf(stderr, "Failed to construct path of climatology accumulator\n");
+    return 1;
+  }
+
+  uint64_t featureCount = values->featureCount;
+  int fd = openClimatology(path, featureCount, values->provenance.features);
+  if (fd < 0) {
+    free(path);
+    return 1;
+  }
+
+  // the whole file is locked, reading and updating a day's cells must not interleave with other
+  // processes adding the same day of year
+  struct flock lock = {.l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0};
+
+  while (fcntl(fd, F_SETLKW, &lock) != 0) {
+    if (errno == EINTR) {
+      continue;
+    }
+    perror("fcntl");
+    close(fd);
+    free(path);
+    return 1;
+  }
+
+  size_t bit = (size_t) year * STORE_DAY_SLOTS + (size_t) slot;
+  off_t bitmapByteOffset = climatologyBitmapOffset(featureCount) + (off_t) (bit / 8);
+  unsigned char bitmapByte = 0;
+
+  bool failed = preadFully(fd, &bitmapByte, 1, bitmapByteOffset) != 0;
+
+  struct storeFeature *table = NULL;
+  struct climatologyCell *cells = NULL;
+
+  if (!failed && (bitmapByte & (1u << (bit % 8))) == 0) {
+    size_t allocationCount = featureCount > 0 ? featureCount : 1;
+    table = malloc(allocationCount * sizeof(struct storeFeature));
+    cells = malloc(allocationCount * sizeof(struct climatologyCell));
+
+    if (table == NULL || cells == NULL) {
+      perror("malloc");
+      failed = true;
+    } else {
+      failed = preadFully(fd, table, featureCount * sizeof(struct storeFeature),
+                          (off_t) sizeof(struct storeHeader))
+               || preadFully(fd, cells, featureCount * sizeof(struct climatologyCell),
+                             climatologyCellsOffset(featureCount, slot));
+    }
+
+    bool tableChanged = false;
+
+    for (size_t i = 0; i < values->size && !failed; i++) {
+      const struct m *entry = &values->entries[i];
+
+      if (entry->order >= featureCount) {
+        fprintf(stderr, "Feature %lld is not part of climatology accumulator %s\n", (long long) entry->fid,
+                path);
+        failed = true;
+        break;
+      }
+
+      if (isnan(entry->value)) {
+        continue;
+      }
+
+      cells[entry->order].sum += entry->value;
+      cells[entry->order].sumOfSquares += entry->value * entry->value;
+      cells[entry->order].count++;
+
+      if (table[entry->order].fid != entry->fid) {
+        table[entry->order] = (struct storeFeature) {.fid = entry->fid, .x = entry->x, .y = entry->y};
+        tableChanged = true;
+      }
+    }
+
+    // the bit is set last; should the process die in between, the day is counted again on the
+    // next run, which is less harmful than silently losing it
+    bitmapByte |= (unsigned char) (1u << (bit % 8));
+
+    failed = failed
+             || pwriteFully(fd, cells, featureCount * sizeof(struct climatologyCell),
+                            climatologyCellsOffset(featureCount, slot))
+             || (tableChanged && pwriteFully(fd, table, featureCount * sizeof(struct storeFeature),
+                                             (off_t) sizeof(struct storeHeader)))
+             || pwriteFully(fd, &bitmapByte, 1, bitmapByteOffset);
+  }
+
+  free(table);
+  free(cells);
+
+  lock.l_type = F_UNLCK;
+  fcntl(fd, F_SETLK, &lock);
+
+  if (close(fd) != 0 || failed) {
+    fprintf(stderr, "Failed to add %.4d-%.2d-%.2d to climatology accumulator %s\n", values->year,
+            values->month, values->day, path);
+    free(path);
+    return 1;
+  }
+
+  free(path);
+
+  return 0;
+}
+
+[[nodiscard]] char *formatClimatologyTable(const struct storeFeature *table,
+    const struct climatologyCell *cells, uint64_t featureCount, size_t *length)
+{
+  // rows hold one more value than those of daily tables and a count of at most 20 digits
+  const size_t rowMax = TABLE_ROW_MAX + FIXED_FORMAT_MAX + 24;
+  size_t capacity = (featureCount + 1) * (TABLE_ROW_ESTIMATE + 16) + rowMax;
+  char *buffer = malloc(capacity);
+  if (buffer == NULL) {
+    perror("malloc");
+    return NULL;
+  }
+
+  size_t size = 0;
+
+  for (uint64_t i = 0; i < featureCount; i++) {
+    if (cells[i].count == 0) {
+      continue;
+    }
+
+    if (capacity - size < rowMax) {
+      char *grown = realloc(buffer, capacity * 2);
+      if (grown == NULL) {
+        perror("realloc");
+        free(buffer);
+        return NULL;
+      }
+
+      buffer = grown;
+      capacity *= 2;
+    }
+
+    double n = (double) cells[i].count;
+    double mean = cells[i].sum / n;
+    // sample variance; rounding may push it slightly below zero for nearly constant values
+    double variance = cells[i].count > 1
+                      ? (cells[i].sumOfSquares - cells[i].sum * mean) / (n - 1.0)
+                      : 0.0;
+    double deviation = sqrt(variance > 0.0 ? variance : 0.0);
+
+    size += formatFixed(table[i].x, 4, buffer + size);
+    buffer[size++] = ' ';
+    size += formatFixed(table[i].y, 4, buffer + size);
+    buffer[size++] = ' ';
+    size += formatFixed(kgsqmTocow(mean), 10, buffer + size);
+    buffer[size++] = ' ';
+    size += formatFixed(kgsqmTocow(deviation), 10, buffer + size);
+    size += (size_t) snprintf(buffer + size, capacity - size, " %lu\n", cells[i].count);
+  }
+
+  *length = size;
+
+  return buffer;
+}
+
+int writeClimatologyTables(const char *outputDirectory)
+{
+  char *path = climatologyPath(outputDirectory);
+  if (path == NULL) {
+    fprintf(stderr, "Failed to construct path of climatology accumulator\n");
+    return 1;
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    int status = errno == ENOENT ? 0 : 1;
+
+    if (status != 0) {
+      perror("open");
+    }
+
+    free(path);
+    return status;
+  }
+
+  struct storeHeader header;
+
+  if (readClimatologyHeader(fd, path, &header)) {
+    close(fd);
+    free(path);
+    return 1;
+  }
+
+  uint64_t featureCount = header.featureCount;
+  size_t allocationCount = featureCount > 0 ? featureCount : 1;
+  struct storeFeature *table = malloc(allocationCount * sizeof(struct storeFeature));
+  struct climatologyCell *cells = malloc(allocationCount * sizeof(struct climatologyCell));
+  unsigned char *bitmap = malloc(CLIMATOLOGY_BITMAP_SIZE);
+
+  bool failed = table == NULL || cells == NULL || bitmap == NULL;
+
+  if (failed) {
+    perror("malloc");
+  } else if (preadFully(fd, table, featureCount * sizeof(struct storeFeature),
+                        (off_t) sizeof(struct storeHeader))
+             || preadFully(fd, bitmap, CLIMATOLOGY_BITMAP_SIZE, climatologyBitmapOffset(featureCount))) {
+    fprintf(stderr, "Failed to read climatology accumulator %s\n", path);
+    failed = true;
+  }
+
+  int written = 0;
+
+  for (int slot = 0; slot < STORE_DAY_SLOTS && !failed; slot++) {
+    bool accumulated = false;
+
+    for (size_t year = 0; year < CLIMATOLOGY_YEARS && !accumulated; year++) {
+      size_t bit = year * STORE_DAY_SLOTS + (size_t) slot;
+      accumulated = bitmap[bit / 8] & (1u << (bit % 8));
+    }
+
+    // the cells of days of year no table was added for are never read, they are holes anyways
+    if (!accumulated) {
+      continue;
+    }
+
+    if (preadFully(fd, cells, featureCount * sizeof(struct climatologyCell),
+                   climatologyCellsOffset(featureCount, slot))) {
+      fprintf(stderr, "Failed to read climatology accumulator %s\n", path);
+      failed = true;
+      break;
+    }
+
+    size_t length = 0;
+    char *buffer = formatClimatologyTable(table, cells, featureCount, &length);
+    if (buffer == NULL) {
+      failed = true;
+      break;
+    }
+
+    if (length == 0) {
+      free(buffer);
+      continue;
+    }
+
+    char *tablePath = constructFilePath("%s/WVP_0000-%.2d-%.2d.txt", outputDirectory, slot / 31 + 1,
+                                        slot % 31 + 1);
+    if (tablePath == NULL) {
+      fprintf(stderr, "Failed to construct file path for climatology table\n");
+      free(buffer);
+      failed = true;
+      break;
+    }
+
+    if (writeFileAtomically(tablePath, buffer, length) != 0) {
+      fprintf(stderr, "Encountered error while writing climatology table '%s'\n", tablePath);
+      failed = true;
+    } else {
+      written++;
+    }
+
+    free(tablePath);
+    free(buffer);
+  }
+
+  if (!failed) {
+    printf("Wrote %d climatology tables to %s\n", written, outputDirectory);
+  }
+
+  close(fd);
+  free(table);
+  free(cells);
+  free(bitmap);
+  free(path);
+
+  return failed ? 1 : 0;
+}
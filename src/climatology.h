@@ -0,0 +1,145 @@
+#ifndef CLIMATOLOGY_H
+#define CLIMATOLOGY_H
+/**
+ * @file climatology.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for accumulating a day-of-year climatology
+ *        while output tables are computed and writing its tables.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup climatology Climatology
+ * @{
+ */
+
+#include "output-store.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/// Magic bytes at the start of a climatology accumulator, the last byte being the format version
+#define CLIMATOLOGY_MAGIC "HAZECLI\001"
+
+/// File name of the climatology accumulator within the output directory
+#define CLIMATOLOGY_FILE "WVP_CLIMATOLOGY.hzc"
+
+/// First year days of which can be accumulated
+#define CLIMATOLOGY_FIRST_YEAR 1940
+
+/// Number of years days of which can be accumulated
+#define CLIMATOLOGY_YEARS 100
+
+/// Number of bytes of the bitmap of accumulated days, one bit per year and day slot
+#define CLIMATOLOGY_BITMAP_SIZE ((CLIMATOLOGY_YEARS * STORE_DAY_SLOTS + 7) / 8)
+
+/**
+ * @brief Construct the path of the climatology accumulator of an output directory
+ *
+ * @note The caller must free the returned string.
+ *
+ * @param outputDirectory Directory output is written to.
+ * @return char* Path of the accumulator, NULL on error.
+ */
+[[nodiscard]] char *climatologyPath(const char *outputDirectory);
+
+/**
+ * @brief Compute the offset of the bitmap of accumulated days of a climatology accumulator
+ *
+ * @param featureCount Number of features of the accumulator.
+ * @return off_t Offset of the first byte of the bitmap.
+ */
+off_t climatologyBitmapOffset(uint64_t featureCount);
+
+/**
+ * @brief Compute the offset of the cells of a day slot of a climatology accumulator
+ *
+ * @param featureCount Number of features of the accumulator.
+ * @param slot Day slot, see storeSlot().
+ * @return off_t Offset of the cell of the first feature on that day slot.
+ */
+off_t climatologyCellsOffset(uint64_t featureCount, int slot);
+
+/**
+ * @brief Create an empty climatology accumulator unless it exists already
+ *
+ * @details The header and the features table are written to a temporary file, which is extended
+ *          to the full size of the accumulator and linked to its final path afterwards. If another
+ *          process created the accumulator in the meantime, that one is kept.
+ *
+ * @param path Path to accumulator.
+ * @param featureCount Number of AOI features.
+ * @param features Digest of AOI features.
+ * @return int 0 on success, 1 on error.
+ */
+int createClimatology(const char *path, uint64_t featureCount, uint64_t features);
+
+/**
+ * @brief Read and validate the header of a climatology accumulator
+ *
+ * @param fd File descriptor of the accumulator.
+ * @param path Path to accumulator, used for error messages.
+ * @param header Set to the header of the accumulator.
+ * @return int 0 on success, 1 if the file is not an accumulator.
+ */
+int readClimatologyHeader(int fd, const char *path, struct storeHeader *header);
+
+/**
+ * @brief Open a climatology accumulator for writing, creating it if necessary
+ *
+ * @details Accumulators written for different AOI features are rejected.
+ *
+ * @param path Path to accumulator.
+ * @param featureCount Number of AOI features.
+ * @param features Digest of AOI features.
+ * @return int File descriptor of the accumulator, -1 on error.
+ */
+int openClimatology(const char *path, uint64_t featureCount, uint64_t features);
+
+/**
+ * @brief Add a day table to the climatology accumulator of an output directory
+ *
+ * @details Sum, sum of squares and count of each feature with a value are updated on the day slot
+ *          of the table. The accumulator is locked while it is updated and each day is added at
+ *          most once, thus workers and repeated runs may add days in any order.
+ *
+ * @param outputDirectory Directory output is written to.
+ * @param values Table of a single day, rows are placed by their `order`.
+ * @return int 0 on success, also if the day was added before, 1 on error.
+ */
+int accumulateClimatology(const char *outputDirectory, const meanVector *values);
+
+/**
+ * @brief Format the climatology table of a day slot
+ *
+ * @details Each row holds longitude and latitude with 4 decimals, mean and standard deviation of
+ *          the water column height with 10 decimals and the number of accumulated days. Features
+ *          without accumulated days are left out.
+ *
+ * @note The caller must free the returned buffer.
+ *
+ * @param table Features table of the accumulator.
+ * @param cells Cells of the day slot.
+ * @param featureCount Number of features.
+ * @param length Set to the number of characters of the table, 0 if no feature has a value.
+ * @return char* Table, not null-terminated, NULL on error.
+ */
+[[nodiscard]] char *formatClimatologyTable(const struct storeFeature *table,
+    const struct climatologyCell *cells, uint64_t featureCount, size_t *length);
+
+/**
+ * @brief Write the climatology tables of the accumulator of an output directory
+ *
+ * @details A table 'WVP_0000-MM-DD.txt' is written for each day of year any value was accumulated
+ *          for. If nothing was accumulated yet, no tables are written.
+ *
+ * @param outputDirectory Directory output is written to.
+ * @return int 0 on success, 1 on error.
+ */
+int writeClimatologyTables(const char *outputDirectory);
+
+/** @} */ // end of group
+#endif // CLIMATOLOGY_H
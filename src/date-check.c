@@ -1,4 +1,6 @@
 #include "date-check.h"
+#include <stdio.h>
+#include <string.h>
 
 bool isValidDate(int year, int month, int day)
 {
@@ -12,4 +14,17 @@ bool isValidDate(int year, int month, int day)
                              daysPerMonth[month - 1]);
 
   return validYear && validMonth && validDay;
+}
+
+int parseDate(const char *dateString, int *year, int *month, int *day)
+{
+  int consumed = 0;
+
+  if (strlen(dateString) != 10
+      || sscanf(dateString, "%4d-%2d-%2d%n", year, month, day, &consumed) != 3
+      || consumed != 10) {
+    return 1;
+  }
+
+  return isValidDate(*year, *month, *day) ? 0 : 1;
 }
\ No newline at end of file
@@ -34,5 +34,16 @@
  */
 bool isValidDate(int year, int month, int day);
 
+/**
+ * @brief Parse a date given as YYYY-MM-DD
+ *
+ * @param dateString String representation of date.
+ * @param year Set to the year of the date.
+ * @param month Set to the month of the date.
+ * @param day Set to the day of the date.
+ * @return int 0 on success, 1 if the string is malformed or not a valid date.
+ */
+int parseDate(const char *dateString, int *year, int *month, int *day);
+
 /** @} */ // end of group
 #endif
\ No newline at end of file
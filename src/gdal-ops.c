@@ -7,6 +7,7 @@
 #include <gdal/ogr_srs_api.h>
 #include <gdal/cpl_string.h>
 #include <geos_c.h>
+#include <math.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -100,6 +101,35 @@ int getRasterMetadata(GDALDatasetH raster, struct geoTransform *geoTransformatio
   return 0;
 }
 
+int getRasterExtent(const char *filePath, OGREnvelope *extent, double *pixelSize)
+{
+  GDALDatasetH raster = openRasterDataset(filePath);
+  if (raster == NULL) {
+    return 1;
+  }
+
+  struct geoTransform transform;
+  if (getRasterMetadata(raster, &transform) || transform.rowRotation != 0.0
+      || transform.colRotation != 0.0) {
+    fprintf(stderr, "Failed to get north up geotransformation of %s\n", filePath);
+    closeGDALDataset(raster);
+    return 1;
+  }
+
+  double xEnd = transform.xOrigin + transform.pixelWidth * GDALGetRasterXSize(raster);
+  double yEnd = transform.yOrigin + transform.pixelHeight * GDALGetRasterYSize(raster);
+
+  extent->MinX = MIN(transform.xOrigin, xEnd);
+  extent->MaxX = MAX(transform.xOrigin, xEnd);
+  extent->MinY = MIN(transform.yOrigin, yEnd);
+  extent->MaxY = MAX(transform.yOrigin, yEnd);
+  *pixelSize = MIN(fabs(transform.pixelWidth), fabs(transform.pixelHeight));
+
+  closeGDALDataset(raster);
+
+  return 0;
+}
+
 CRS_TYPE getCRSType(const char *Wkt)
 {
   OGRSpatialReferenceH spatialRef = OSRNewSpatialReference(Wkt);
@@ -95,6 +95,18 @@ int getRasterMetadata(GDALDatasetH raster, struct geoTransform *geoTransformatio
  */
 CRS_TYPE getCRSType(const char *Wkt);
 
+/**
+ * @brief Get the extent of a raster dataset from its geotransformation and dimensions.
+ *
+ * @note Rotated rasters are not supported.
+ *
+ * @param filePath Path to raster dataset.
+ * @param extent Envelope to store the extent in.
+ * @param pixelSize Set to the smaller of pixel width and height.
+ * @return int 0 on success, 1 on failure.
+ */
+int getRasterExtent(const char *filePath, OGREnvelope *extent, double *pixelSize);
+
 /**
  * @brief Return the dataset/layer CRS as WKT
  *
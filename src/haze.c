@@ -9,7 +9,21 @@
 #include "date-check.h"
 #include "numeric-conversions.h"
 #include "area.h"
+#include "pipeline.h"
+#include "workers.h"
+#include "claims.h"
+#include "journal.h"
+#include "fscheck.h"
+#include "manifest.h"
+#include "aoi-cache.h"
+#include "polygon-store.h"
+#include "table-writer.h"
+#include "output-store.h"
+#include "climatology.h"
+#include "variables.h"
+#include "intersection-export.h"
 #include <dirent.h>
+#include <errno.h>
 #include <bits/posix2_lim.h>
 #include <geos_c.h>
 #include <limits.h>
@@ -30,6 +44,7 @@
 #include <gdal/ogr_api.h>
 #include <gdal/ogr_srs_api.h>
 #include <gdal/ogr_api.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 void freeRawData(struct rawData *data)
@@ -44,7 +59,13 @@ void freeAverageData(struct averagedData *data)
 
 int readRasterDataset(GDALDatasetH raster, struct rawData *dataBuffer)
 {
-  dataBuffer->bands = GDALGetRasterCount(raster);
+  return readRasterDatasetBands(raster, dataBuffer, NULL, GDALGetRasterCount(raster));
+}
+
+int readRasterDatasetBands(GDALDatasetH raster, struct rawData *dataBuffer, int *bandMap,
+                           int bandCount)
+{
+  dataBuffer->bands = (size_t) bandCount;
   GDALRasterBandH layer = openRasterBand(raster, 1);
 
   if (layer == NULL) {
@@ -70,12 +91,13 @@ int readRasterDataset(GDALDatasetH raster, struct rawData *dataBuffer)
   // data seems to be BSQ? Or at least it saved into the buffer one scanline at a time
   // could be helpful to manually transform to PIL
   // Doesn't GDAL hide this from me? When requesting bands, I get a band no matter how the underlying data is interleaved! I.e., data returned is always BSQ
+  // bands not listed in bandMap are never decoded
   CPLErr readErr = GDALDatasetRasterIOEx(
                      raster, GF_Read, 0, 0,
                      (int) dataBuffer->columns, (int) dataBuffer->rows,
                      (void *) dataBuffer->data, (int) dataBuffer->columns,
                      (int) dataBuffer->rows, dType,
-                     dataBuffer->bands, NULL, 0, 0, 0, NULL);
+                     bandCount, bandMap, 0, 0, 0, NULL);
 
   if (readErr == CE_Failure) {
     fprintf(stderr, "%s\n", CPLGetLastErrorMsg());
@@ -113,7 +135,7 @@ int averageRawData(const struct rawData *data, struct averagedData *average)
 }
 
 int averageRawDataWithSizeOffset(const struct rawData *data, struct averagedData *average,
-                                 const size_t size, const size_t offset)
+                                 const size_t size, const size_t offset, const bool compensated)
 {
   // now, daily averages can be calculated by setting the size to number of observations per day (see query) and offset to nObservations * `day of interest (0-based)`
   size_t startBand = offset;
@@ -137,18 +159,23 @@ int averageRawDataWithSizeOffset(const struct rawData *data, struct averagedData
     for (size_t column = 0; column < data->columns; column++) {
       size_t columnOffset = column;
       double sum = 0.0;
+      double compensation = 0.0;
       for (size_t band = startBand; band < boundary; band++) {
         size_t bandOffset = band * data->columns * data->rows;
-        sum += data->data[columnOffset + rowOffset + bandOffset];
+        if (compensated) {
+          compensatedAdd(&sum, &compensation, data->data[columnOffset + rowOffset + bandOffset]);
+        } else {
+          sum += data->data[columnOffset + rowOffset + bandOffset];
+        }
       }
-      average->data[rowOffset + columnOffset] = sum / (double) data->bands;
+      average->data[rowOffset + columnOffset] = (sum + compensation) / (double) (boundary - startBand);
     }
   }
   return 0;
 }
 
 int averagePILRawDataWithSizeOffset(const struct rawData *data, struct averagedData *average,
-                                    const size_t size, const size_t offset)
+                                    const size_t size, const size_t offset, const bool compensated)
 {
   // now, daily averages can be calculated by setting the size to number of observations per day (see query) and offset to nObservations * `day of interest (0-based)`
   size_t startBand = offset;
@@ -172,10 +199,15 @@ int averagePILRawDataWithSizeOffset(const struct rawData *data, struct averagedD
     for (size_t column = 0; column < data->columns; column++) {
       size_t columnOffset = column * data->bands;
       double sum = 0.0;
+      double compensation = 0.0;
       for (size_t band = startBand; band < boundary; band++) {
-        sum += data->data[rowOffset + columnOffset + band];
+        if (compensated) {
+          compensatedAdd(&sum, &compensation, data->data[rowOffset + columnOffset + band]);
+        } else {
+          sum += data->data[rowOffset + columnOffset + band];
+        }
       }
-      average->data[column + row * data->columns] = sum / (double) data->bands;
+      average->data[column + row * data->columns] = (sum + compensation) / (double) (boundary - startBand);
     }
   }
   return 0;
@@ -395,7 +427,8 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
 
 [[nodiscard]] meanVector *calculateAreaWeightedMean(intersectionVector *intersections,
     const char *rasterWkt, const bool geometriesAreFootprints,
-    const bool useFastGeodesicAreaCalculation, bool usePrecomputedCentroid)
+    const bool useFastGeodesicAreaCalculation, bool usePrecomputedCentroid, bool deterministic,
+    weightTable *recordedWeights, intersectionExport *exporter)
 {
   meanVector *means = malloc(sizeof(meanVector));
 
@@ -407,6 +440,10 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
   means->entries = malloc(intersections->size * sizeof(struct m));
   means->capcity = means->size =
                      intersections->size; // capcity == size for means but semantically, they're still different
+  means->provenance.input = 0;
+  means->provenance.features = 0;
+  means->recordManifest = false;
+  means->variable = VARIABLE_TOTAL_COLUMN_WATER_VAPOUR;
 
   if (means->entries == NULL) {
     fprintf(stderr, "Failed to allocate memory for array of mean values\n");
@@ -414,6 +451,18 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
     return NULL;
   }
 
+  if (recordedWeights != NULL) {
+    recordedWeights->size = 0;
+    recordedWeights->entries = calloc(intersections->size > 0 ? intersections->size : 1,
+                                      sizeof(struct featureWeights));
+
+    if (recordedWeights->entries == NULL) {
+      perror("calloc");
+      freeWeightedMeans(means);
+      return NULL;
+    }
+  }
+
   OGRSpatialReferenceH spatialRef = OSRNewSpatialReference(rasterWkt);
   if (spatialRef == NULL) {
     fprintf(stderr, "Could not create new OGRSpatialReferenceH from WKT\n");
@@ -435,77 +484,9 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
     return NULL;
   }
 
-#ifdef DEBUG
-  char pwd[PATH_MAX];
-  if (getcwd(pwd, sizeof(pwd)) == NULL) {
-    fprintf(stderr, "Failed to get current working directory\n");
-    freeWeightedMeans(means);
-    return NULL;
-  }
-
-  const char *debugOutputPath = constructFilePath("%s/debug-%ld.gpkg", pwd, time(NULL));
-  const char *debugOutputLayerName = "intersections";
-
-  fprintf(stderr, "Exporting intersecting geometries in debug mode at %s\n", debugOutputPath);
-
-  GDALDriverH *debugOutputDriver = GDALGetDriverByName("GPKG");
-  if (debugOutputDriver == NULL) {
-    fprintf(stderr, "Failed to get GPKG driver. Aborting.\n");
-    freeWeightedMeans(means);
-    free((char *) debugOutputPath);
-    return NULL;
-  }
-
-  GDALDatasetH debugOutputDataset = GDALCreate(debugOutputDriver, debugOutputPath, 0, 0, 0,
-                                    GDT_Unknown, NULL);
-  if (debugOutputDataset == NULL) {
-    fprintf(stderr, "Failed to create output dataset %s. Aborting.\n", debugOutputPath);
-    /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-    freeWeightedMeans(means);
-    free((char *) debugOutputPath);
-    return NULL;
-  }
-
-  OGRLayerH debugOutputLayer = GDALDatasetCreateLayer(debugOutputDataset, debugOutputLayerName,
-                               spatialRef, wkbMultiPolygon, NULL);
-  if (debugOutputLayer == NULL) {
-    fprintf(stderr, "Failed to create output layer. Aborting\n");
-    GDALClose(debugOutputDataset);
-    /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-    freeWeightedMeans(means);
-    unlink(debugOutputPath);
-    free((char *) debugOutputPath);
-    return NULL;
-  }
-
-  OGRFieldDefnH parentIdDefinition = OGR_Fld_Create("parentFID", OFTInteger64);
-  if (OGR_L_CreateField(debugOutputLayer, parentIdDefinition, true) != OGRERR_NONE) {
-    fprintf(stderr, "Failed to create field\n");
-    OGR_Fld_Destroy(parentIdDefinition);
-    GDALClose(debugOutputDataset);
-    /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-    freeWeightedMeans(means);
-    unlink(debugOutputPath);
-    free((char *) debugOutputPath);
-    return NULL;
-  }
-
-  OGR_Fld_Destroy(parentIdDefinition);
-
-  OGRFieldDefnH valueDefinition = OGR_Fld_Create("waterVapor", OFTReal);
-  if (OGR_L_CreateField(debugOutputLayer, valueDefinition, true) != OGRERR_NONE) {
-    fprintf(stderr, "Failed to create field\n");
-    OGR_Fld_Destroy(valueDefinition);
-    GDALClose(debugOutputDataset);
-    /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-    freeWeightedMeans(means);
-    unlink(debugOutputPath);
-    free((char *) debugOutputPath);
-    return NULL;
-  }
-
-  OGR_Fld_Destroy(valueDefinition);
-#endif
+  // shifted coordinates of footprints are kept in a buffer reused for all features
+  double *footprintScratch = NULL;
+  size_t footprintScratchSize = 0;
 
   for (size_t referenceIndex = 0; referenceIndex < intersections->size; referenceIndex ++) {
     OGRGeometryH centroid = OGR_G_CreateGeometry(wkbPoint);
@@ -513,36 +494,33 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
       fprintf(stderr, "Failed to create empty centroid\n");
       OSRDestroySpatialReference(spatialRef);
       freeWeightedMeans(means);
-#ifdef DEBUG
-      GDALClose(debugOutputDataset);
-      /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-      unlink(debugOutputPath);
-      free((char *) debugOutputPath);
-#endif
+      free(footprintScratch);
       return NULL;
     }
 
-    OGRwkbGeometryType referenceGeometryType = OGR_G_GetGeometryType(
-          intersections->entries[referenceIndex].reference);
+    const compactPolygon *reference = intersections->entries[referenceIndex].reference;
+    double centroidX;
+    double centroidY;
+
+    if (geometriesAreFootprints && reference->isMulti && reference->partCount > 1
+        && compactFootprintCentroid(reference, &footprintScratch, &footprintScratchSize, &centroidX,
+                                    &centroidY) == 0) {
+      OGR_G_SetPoint_2D(centroid, 0, centroidX, centroidY);
+    } else if (geometriesAreFootprints && reference->isMulti && reference->partCount > 1) {
+      // overlapping parts need to be merged, which relies on OGR, thus the OGR geometry is only built here
+      OGRGeometryH referenceAsOGR = compactPolygonToOGR(reference, spatialRef);
+      OGRGeometryH shiftedPolygon = referenceAsOGR == NULL ? NULL : mergeFootprintSplitAtDateline(
+                                      referenceAsOGR);
 
-    if (geometriesAreFootprints
-        && (referenceGeometryType == wkbMultiPolygon || referenceGeometryType == wkbMultiPolygon25D)
-        && OGR_G_GetGeometryCount(intersections->entries[referenceIndex].reference) > 1) {
-      OGRGeometryH shiftedPolygon = mergeFootprintSplitAtDateline(
-                                      intersections->entries[referenceIndex].reference);
+      OGR_G_DestroyGeometry(referenceAsOGR);
 
       if (shiftedPolygon == NULL) {
         fprintf(stderr, "Failed to merge split multipolygon into polygon\n");
         OGR_G_DestroyGeometry(centroid);
         OSRDestroySpatialReference(spatialRef);
         freeWeightedMeans(means);
+        free(footprintScratch);
         OGR_G_DestroyGeometry(centroid);
-#ifdef DEBUG
-        GDALClose(debugOutputDataset);
-        /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-        unlink(debugOutputPath);
-        free((char *) debugOutputPath);
-#endif
         return NULL;
       }
 
@@ -552,54 +530,60 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
         OGR_G_DestroyGeometry(centroid);
         OSRDestroySpatialReference(spatialRef);
         freeWeightedMeans(means);
+        free(footprintScratch);
         OGR_G_DestroyGeometry(centroid);
-#ifdef DEBUG
-        GDALClose(debugOutputDataset);
-        /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-        unlink(debugOutputPath);
-        free((char *) debugOutputPath);
-#endif
         return NULL;
       }
 
       OGR_G_DestroyGeometry(shiftedPolygon);
+    } else if (compactPolygonCentroid(reference, &centroidX, &centroidY) == 0) {
+      OGR_G_SetPoint_2D(centroid, 0, centroidX, centroidY);
     } else {
-      if (OGR_G_Centroid(intersections->entries[referenceIndex].reference, centroid) == OGRERR_FAILURE) {
+      // polygons without area are left to OGR, which falls back to the centroid of their boundary
+      OGRGeometryH referenceAsOGR = compactPolygonToOGR(reference, spatialRef);
+
+      if (referenceAsOGR == NULL || OGR_G_Centroid(referenceAsOGR, centroid) == OGRERR_FAILURE) {
         fprintf(stderr, "Failed to calculate centroid\n");
+        OGR_G_DestroyGeometry(referenceAsOGR);
         OSRDestroySpatialReference(spatialRef);
         freeWeightedMeans(means);
+        free(footprintScratch);
         OGR_G_DestroyGeometry(centroid);
-#ifdef DEBUG
-        GDALClose(debugOutputDataset);
-        /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-        unlink(debugOutputPath);
-        free((char *) debugOutputPath);
-#endif
         return NULL;
       }
+
+      OGR_G_DestroyGeometry(referenceAsOGR);
     }
 
     double referenceArea;
 
     if (useFastGeodesicAreaCalculation) {
-      referenceArea = fastGeodesicArea(intersections->entries[referenceIndex].reference, spatialRef);
+      // did we REALLY get a valid geometry? GEOS geometry was already built during the tree query
+      if (GEOSisValid(intersections->entries[referenceIndex].referenceASGEOS) != 1) {
+        fprintf(stderr, "Input geometry is not valid\n");
+        referenceArea = -1.0;
+      } else {
+        referenceArea = fastCompactGeodesicArea(reference, spatialRef);
+      }
     } else {
-      referenceArea = CRSType == CRS_GEOGRAPHIC ? OGR_G_GeodesicArea(
-                        intersections->entries[referenceIndex].reference) : OGR_G_Area(
-                        intersections->entries[referenceIndex].reference);
+      OGRGeometryH referenceAsOGR = compactPolygonToOGR(reference, spatialRef);
+
+      if (referenceAsOGR == NULL) {
+        referenceArea = -1.0;
+      } else {
+        referenceArea = CRSType == CRS_GEOGRAPHIC ? OGR_G_GeodesicArea(referenceAsOGR) : OGR_G_Area(
+                          referenceAsOGR);
+      }
+
+      OGR_G_DestroyGeometry(referenceAsOGR);
     }
 
     if (referenceArea == -1.0) {
       fprintf(stderr, "Failed to calculate reference area\n");
       OSRDestroySpatialReference(spatialRef);
       freeWeightedMeans(means);
+      free(footprintScratch);
       OGR_G_DestroyGeometry(centroid);
-#ifdef DEBUG
-      GDALClose(debugOutputDataset);
-      /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-      unlink(debugOutputPath);
-      free((char *) debugOutputPath);
-#endif
       return NULL;
     }
 
@@ -608,13 +592,8 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
       perror("calloc");
       OSRDestroySpatialReference(spatialRef);
       freeWeightedMeans(means);
+      free(footprintScratch);
       OGR_G_DestroyGeometry(centroid);
-#ifdef DEBUG
-      GDALClose(debugOutputDataset);
-      /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-      unlink(debugOutputPath);
-      free((char *) debugOutputPath);
-#endif
       return NULL;
     }
 
@@ -623,14 +602,21 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
       perror("calloc");
       OSRDestroySpatialReference(spatialRef);
       freeWeightedMeans(means);
+      free(footprintScratch);
       OGR_G_DestroyGeometry(centroid);
       free(values);
-#ifdef DEBUG
-      GDALClose(debugOutputDataset);
-      /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-      unlink(debugOutputPath);
-      free((char *) debugOutputPath);
-#endif
+      return NULL;
+    }
+
+    size_t *cells = calloc(intersections->entries[referenceIndex].intersectionCount, sizeof(size_t));
+    if (cells == NULL) {
+      perror("calloc");
+      OSRDestroySpatialReference(spatialRef);
+      freeWeightedMeans(means);
+      free(footprintScratch);
+      OGR_G_DestroyGeometry(centroid);
+      free(values);
+      free(weights);
       return NULL;
     }
 
@@ -639,6 +625,7 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
     // iterate over all found intersections
     for (size_t i = 0; i < intersections->entries[referenceIndex].intersectionCount; i++) {
       values[i] = temp->entry->value; // shit, here I do copy data again...
+      cells[i] = temp->entry->index;
 
       GEOSGeometry *intersectionAsGEOS = GEOSIntersection(
                                            intersections->entries[referenceIndex].referenceASGEOS, temp->entry->geometry);
@@ -647,15 +634,11 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
         fprintf(stderr, "Failed to compute intersection geometry\n");
         OSRDestroySpatialReference(spatialRef);
         freeWeightedMeans(means);
+        free(footprintScratch);
         OGR_G_DestroyGeometry(centroid);
         free(values);
         free(weights);
-#ifdef DEBUG
-        GDALClose(debugOutputDataset);
-        /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-        unlink(debugOutputPath);
-        free((char *) debugOutputPath);
-#endif
+        free(cells);
         return NULL;
       }
 
@@ -695,15 +678,11 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
         fprintf(stderr, "Failed to convert GEOS geometry to OGR\n");
         OSRDestroySpatialReference(spatialRef);
         freeWeightedMeans(means);
+        free(footprintScratch);
         OGR_G_DestroyGeometry(centroid);
         free(values);
         free(weights);
-#ifdef DEBUG
-        GDALClose(debugOutputDataset);
-        /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-        unlink(debugOutputPath);
-        free((char *) debugOutputPath);
-#endif
+        free(cells);
         return NULL;
       }
 
@@ -713,30 +692,6 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
           || intersectionType == wkbPolygon25D
           || intersectionType == wkbMultiPolygon
           || intersectionType == wkbMultiPolygon25D) {
-#ifdef DEBUG
-        OGRFeatureH feature = OGR_F_Create(OGR_L_GetLayerDefn(debugOutputLayer));
-
-        OGR_F_SetFieldInteger(feature, OGR_F_GetFieldIndex(feature, "parentFID"),
-                              intersections->entries[referenceIndex].referenceFID);
-        OGR_F_SetFieldDouble(feature, OGR_F_GetFieldIndex(feature, "waterVapor"), values[i]);
-        OGR_F_SetGeometry(feature, intersection);
-
-        if (OGR_L_CreateFeature(debugOutputLayer, feature) != OGRERR_NONE) {
-          OSRDestroySpatialReference(spatialRef);
-          freeWeightedMeans(means);
-          OGR_G_DestroyGeometry(centroid);
-          OGR_G_DestroyGeometry(intersection);
-          free(values);
-          free(weights);
-          GDALClose(debugOutputDataset);
-          /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-          unlink(debugOutputPath);
-          free((char *) debugOutputPath);
-          return NULL;
-        }
-
-        OGR_F_Destroy(feature);
-#endif
         double intersectingArea;
 
         if (useFastGeodesicAreaCalculation) {
@@ -752,12 +707,32 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
           OGR_G_DestroyGeometry(intersection);
           OSRDestroySpatialReference(spatialRef);
           freeWeightedMeans(means);
+          free(footprintScratch);
           OGR_G_DestroyGeometry(centroid);
           free(values);
           free(weights);
+          free(cells);
+          return NULL;
         }
 
         weights[i] = intersectingArea / referenceArea;
+
+        // the export takes ownership of the geometry, which is converted and written by its thread
+        if (exporter != NULL && exportIntersection(exporter,
+            intersections->entries[referenceIndex].referenceFID, (GIntBig) cells[i], values[i], weights[i],
+            intersection)) {
+          fprintf(stderr, "Failed to export intersection\n");
+          OSRDestroySpatialReference(spatialRef);
+          freeWeightedMeans(means);
+          free(footprintScratch);
+          OGR_G_DestroyGeometry(centroid);
+          free(values);
+          free(weights);
+          free(cells);
+          return NULL;
+        }
+
+        intersection = exporter != NULL ? NULL : intersection;
       } else if (intersectionType == wkbPoint || intersectionType == wkbPoint25D) {
 #ifdef DEBUG
         fprintf(stderr, "Intersection resulted in point geometry. Setting both value and weight to 0.\n");
@@ -773,8 +748,18 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
       OGR_G_DestroyGeometry(intersection);
     }
 
-    means->entries[referenceIndex].value = calculateWeightedAverage(values, weights,
-                                           intersections->entries[referenceIndex].intersectionCount);
+    // order of intersecting cells depends on the tree query, fix the reduction order if requested
+    if (deterministic) {
+      means->entries[referenceIndex].value = calculateOrderedWeightedAverage(values, weights, cells,
+                                             intersections->entries[referenceIndex].intersectionCount);
+    } else {
+      means->entries[referenceIndex].value = calculateWeightedAverage(values, weights,
+                                             intersections->entries[referenceIndex].intersectionCount);
+    }
+    means->entries[referenceIndex].fid = intersections->entries[referenceIndex].referenceFID;
+    means->entries[referenceIndex].hash = intersections->entries[referenceIndex].referenceHash;
+    means->entries[referenceIndex].order = intersections->entries[referenceIndex].referenceOrder;
+
     if (usePrecomputedCentroid) {
       means->entries[referenceIndex].x = intersections->entries[referenceIndex].precomutedLongitude;
       means->entries[referenceIndex].y = intersections->entries[referenceIndex].precomputedLatitude;
@@ -790,262 +775,1683 @@ int reorderToBandInterleavedByPixel(struct rawData *data)
       means->entries[referenceIndex].x += 360.0;
     }
 
+    if (recordedWeights != NULL) {
+      // cells without weight may hold non-finite values in other rasters, exclude them entirely
+      for (size_t i = 0; i < intersections->entries[referenceIndex].intersectionCount; i++) {
+        if (weights[i] == 0.0) {
+          cells[i] = SIZE_MAX;
+        }
+      }
+
+      recordedWeights->entries[referenceIndex] = (struct featureWeights) {
+        .count = intersections->entries[referenceIndex].intersectionCount,
+        .cells = cells,
+        .weights = weights
+      };
+      recordedWeights->size = referenceIndex + 1;
+    } else {
+      free(weights);
+      free(cells);
+    }
+
     free(values);
-    free(weights);
     OGR_G_DestroyGeometry(centroid);
   }
 
-#ifdef DEBUG
-  GDALClose(debugOutputDataset);
-  /// NOTE: Destroying the output driver crashes `GDALDestroy`, thus leaving it.
-  free((char *) debugOutputPath);
-#endif
-
+  free(footprintScratch);
   OSRDestroySpatialReference(spatialRef);
 
   return means;
 }
 
-int writeWeightedMeans(meanVector *values, const char *filePath)
+[[nodiscard]] meanVector *weightedMeansFromGrid(const meanVector *template, const weightTable *weights,
+    const double *grid, bool deterministic)
 {
-  if (values == NULL || filePath == NULL) {
-    return 1;
+  if (weights->size != template->size) {
+    fprintf(stderr, "Weights don't match rows of table\n");
+    return NULL;
   }
 
-  FILE *outFile = fopen(filePath, "wt");
-  if (outFile == NULL) {
-    perror("fopen");
-    return 1;
+  size_t maximumCount = 1;
+
+  for (size_t i = 0; i < weights->size; i++) {
+    maximumCount = weights->entries[i].count > maximumCount ? weights->entries[i].count : maximumCount;
   }
 
-  for (size_t i = 0; i < values->size; i++) {
-    /// NOTE: after checking the calling code, this path shouldn't be taken, but who knows;
-    // throw it in for good measure
-    if (isnan(values->entries[i].value)) {
-      // unfeasable to compute number of characters beforehand, but we can check for errors
-      if (fprintf(outFile, "%.4lf %.4lf 9999 TBD\n", values->entries[i].x, values->entries[i].y) < 0) {
-        fclose(outFile);
-        return 1;
-      }
-    } else {
-      // unfeasable to compute number of characters beforehand, but we can check for errors
-      if (fprintf(outFile, "%.4lf %.4lf %.10lf ERA\n", values->entries[i].x, values->entries[i].y,
-                  kgsqmTocow(values->entries[i].value)) < 0) {
-        fclose(outFile);
-        return 1;
-      }
-    }
+  meanVector *means = malloc(sizeof(meanVector));
+  double *values = malloc(maximumCount * sizeof(double));
+
+  if (means == NULL || values == NULL) {
+    perror("malloc");
+    free(means);
+    free(values);
+    return NULL;
   }
 
-  fclose(outFile);
-  return 0;
+  *means = *template;
+  means->entries = malloc((template->size > 0 ? template->size : 1) * sizeof(struct m));
+
+  if (means->entries == NULL) {
+    perror("malloc");
+    free(means);
+    free(values);
+    return NULL;
+  }
+
+  for (size_t row = 0; row < template->size; row++) {
+    means->entries[row] = template->entries[row];
+    means->entries[row].value = weightedMeanOfCells(&weights->entries[row], grid, values, deterministic);
+  }
+
+  free(values);
+
+  return means;
 }
 
-double coordinateFromCell(double origin, double axisOfInterest, double pixelExtent,
-                          double complementaryAxis, double rotation)
+double weightedMeanOfCells(const struct featureWeights *feature, const double *grid, double *values,
+                           bool deterministic)
 {
-  // axisOfInterest is the axis for which coordinate should be caclulated
-  return origin + axisOfInterest * pixelExtent + complementaryAxis * rotation;
+  for (size_t i = 0; i < feature->count; i++) {
+    values[i] = feature->cells[i] == SIZE_MAX ? 0.0 : grid[feature->cells[i]];
+  }
+
+  return deterministic
+         ? calculateOrderedWeightedAverage(values, feature->weights, feature->cells, feature->count)
+         : calculateWeightedAverage(values, feature->weights, feature->count);
 }
 
-stringList *parseLogFile(const char *filePath)
+void bracketingHours(const int *hours, size_t hourCount, double hour, size_t *lower, size_t *upper,
+                     double *fraction)
 {
-  stringList *out = NULL, *tail;
+  *lower = 0;
+  *upper = 0;
+  *fraction = 0.0;
 
-  if (filePath == NULL) {
-    return NULL;
+  if (hourCount == 0 || hour <= hours[0]) {
+    return;
   }
 
-  FILE *f = fopen(filePath, "r");
-  if (f == NULL) {
-    return NULL;
+  // bands of the following day are not part of this day's bands, later times keep the last hour
+  if (hour >= hours[hourCount - 1]) {
+    *lower = hourCount - 1;
+    *upper = hourCount - 1;
+    return;
   }
 
-  char *lineptr = NULL;
-  size_t n = 0;
+  while (*lower + 1 < hourCount && hours[*lower + 1] <= hour) {
+    (*lower)++;
+  }
 
-  while (getline(&lineptr, &n, f) != -1) {
-    // remove newline
-    size_t length = strlen(lineptr);
+  *upper = *lower + 1;
+  *fraction = (hour - hours[*lower]) / (double) (hours[*upper] - hours[*lower]);
+}
 
-    if (lineptr[length - 1] == '\n') {
-      lineptr[length - 1] = '\0';
-    }
+int interpolateAcquisitionTimes(const struct loadedDataset *dataset, meanVector *weightedMeans,
+                                const weightTable *weights, const vectorGeometryVector *areasOfInterest,
+                                const option_t *options, size_t bandOffset)
+{
+  size_t hoursPerDay = dataset->temporal.hoursElements;
+  size_t cellCount = dataset->data.rows * dataset->data.columns;
 
-    const char *downloadedFile = strtok(lineptr, "\t");
-    const char *status = strtok(NULL, "\t");
+  if (weights->size != weightedMeans->size) {
+    fprintf(stderr, "Weights don't match rows of table\n");
+    return 1;
+  }
 
-    if (downloadedFile == NULL || status == NULL) {
-      fprintf(stderr, "Failed to parse line in log file\n");
-      freeStringList(out);
-      free(lineptr);
-      fclose(f);
-      return NULL;
-    }
+  if (hoursPerDay == 0 || bandOffset + hoursPerDay > dataset->data.bands) {
+    fprintf(stderr, "Bands of day exceed dataset %s\n", dataset->entry->string);
+    return 1;
+  }
 
-    stringList *node = calloc(1, sizeof(stringList));
-    if (node == NULL) {
-      fprintf(stderr, "Failed to allocate memory for stringList node\n");
-      freeStringList(out);
-      free(lineptr);
-      fclose(f);
-      return NULL;
+  // rows only know the layer order of their feature, possibly of a subset of all features
+  size_t orderCount = 1;
+  size_t maximumCount = 1;
+
+  for (size_t i = 0; i < areasOfInterest->size; i++) {
+    if (areasOfInterest->entries[i].order >= orderCount) {
+      orderCount = areasOfInterest->entries[i].order + 1;
     }
+  }
 
-    node->string = strdup(downloadedFile);
-    node->status = strdup(status);
+  for (size_t i = 0; i < weights->size; i++) {
+    maximumCount = weights->entries[i].count > maximumCount ? weights->entries[i].count : maximumCount;
+  }
 
-    if (node->string == NULL || node->status == NULL) {
-      fprintf(stderr, "Failed to store fields in node\n");
-      free(node->string);
-      free(node->status);
-      freeStringList(out);
-      free(lineptr);
-      fclose(f);
-      return NULL;
-    }
+  double *hourOfOrder = malloc(orderCount * sizeof(double));
+  double *values = malloc(maximumCount * sizeof(double));
 
-    if (out == NULL) {
-      out = tail = node;
-    } else {
-      tail->next = node;
-      tail = node;
-    }
+  if (hourOfOrder == NULL || values == NULL) {
+    perror("malloc");
+    free(hourOfOrder);
+    free(values);
+    return 1;
+  }
 
-    free(lineptr);
-    n = 0;
+  for (size_t i = 0; i < orderCount; i++) {
+    hourOfOrder[i] = NAN;
   }
 
-  if (!feof(f)) {
-    fprintf(stderr, "An error occurred while reading %s\n", filePath);
-    freeStringList(out);
-    out = NULL;
+  for (size_t i = 0; i < areasOfInterest->size; i++) {
+    hourOfOrder[areasOfInterest->entries[i].order] = areasOfInterest->entries[i].acquisitionHour;
   }
 
-  free(lineptr);
-  fclose(f);
+  for (size_t row = 0; row < weightedMeans->size; row++) {
+    struct m *entry = &weightedMeans->entries[row];
+    double hour = entry->order < orderCount ? hourOfOrder[entry->order] : NAN;
 
-  return out;
-}
+    // features without acquisition time keep the daily mean
+    if (isnan(hour)) {
+      continue;
+    }
 
-int writeUpdatedLogFile(stringList *list, const char *filePath)
-{
-  if (list == NULL || filePath == NULL) {
-    return 1;
-  }
+    size_t lower;
+    size_t upper;
+    double fraction;
 
-  FILE *f = fopen(filePath, "w");
-  if (f == NULL) {
-    fprintf(stderr, "Failed to open log file for writing\n");
-    return 1;
-  }
+    bracketingHours(dataset->temporal.hours, hoursPerDay, hour, &lower, &upper, &fraction);
 
-  for (stringList *ptr = list; ptr != NULL; ptr = ptr->next) {
-    if (fprintf(f, "%s\t%s\n", ptr->string, ptr->status) < 0) {
-      fprintf(stderr,
-              "Encountered error while writing updated log file. Start all over at this point...\n");
-      fclose(f);
-      return 1;
+    const double *lowerGrid = dataset->data.data + (bandOffset + lower) * cellCount;
+    double value = weightedMeanOfCells(&weights->entries[row], lowerGrid, values, options->deterministic);
+
+    if (upper != lower && fraction > 0.0) {
+      const double *upperGrid = dataset->data.data + (bandOffset + upper) * cellCount;
+      double upperValue = weightedMeanOfCells(&weights->entries[row], upperGrid, values, options->deterministic);
+      value += fraction * (upperValue - value);
     }
+
+    entry->value = value;
   }
 
-  fclose(f);
+  free(hourOfOrder);
+  free(values);
 
   return 0;
 }
 
-int backFillOptions(option_t *options, GDALDatasetH dataset)
+[[nodiscard]] meanVector *extremeOfTables(meanVector *const *tables, size_t count, bool maximum)
 {
-  // make sure to start fresh options for new file
-  memset(options->years, 0, sizeof(int) * options->yearsElements);
-  memset(options->months, 0, sizeof(int) * options->monthsElements);
-  memset(options->days, 0, sizeof(int) * options->daysElements);
-  memset(options->hours, 0, sizeof(int) * options->hoursElements);
-  options->daysElements = 0;
-  options->hoursElements = 0;
-
-  const int nLayers = GDALGetRasterCount(dataset);
+  meanVector *extremes = malloc(sizeof(meanVector));
+  if (extremes == NULL) {
+    perror("malloc");
+    return NULL;
+  }
 
-  // back-fill fields of options struct with one strong assumptions: only ever fill back hours and potentially days;
-  // each file is thus assumed to only contain data for either an entire day or entire month
-  options->yearsElements = 1;
-  options->monthsElements = 1;
-  struct tm time;
-  struct tm *timePointer;
+  *extremes = *tables[0];
+  extremes->entries = malloc((tables[0]->size > 0 ? tables[0]->size : 1) * sizeof(struct m));
 
-  int daysHistogram[31] = {0};
-  int hoursHistogram[24] = {0};
+  if (extremes->entries == NULL) {
+    perror("malloc");
+    free(extremes);
+    return NULL;
+  }
 
-  for (int i = 1; i <= nLayers; i++) {
-    GDALRasterBandH band = openRasterBand(dataset, i);
+  for (size_t row = 0; row < tables[0]->size; row++) {
+    extremes->entries[row] = tables[0]->entries[row];
 
-    if (band == NULL) {
-      return 1;
+    // fmin and fmax ignore NaN unless both arguments are NaN
+    for (size_t i = 1; i < count; i++) {
+      double value = tables[i]->entries[row].value;
+      extremes->entries[row].value = maximum
+                                     ? fmax(extremes->entries[row].value, value)
+                                     : fmin(extremes->entries[row].value, value);
     }
+  }
+
+  return extremes;
+}
+
+int computeAggregations(const struct loadedDataset *dataset, const meanVector *dailyMean,
+                        const weightTable *weights, const option_t *options, size_t bandOffset,
+                        struct dayProducts *products)
+{
+  size_t hoursPerDay = dataset->temporal.hoursElements;
+  size_t cellCount = dataset->data.rows * dataset->data.columns;
+
+  products->entries = calloc(hoursPerDay + 2, sizeof(struct aggregatedTable));
+  products->size = 0;
+
+  if (products->entries == NULL) {
+    perror("calloc");
+    return 1;
+  }
+
+  if (hoursPerDay == 0 || bandOffset + hoursPerDay > dataset->data.bands) {
+    fprintf(stderr, "Bands of day exceed dataset %s\n", dataset->entry->string);
+    return 1;
+  }
+
+  // extremes are taken over hourly means, thus these are computed for either aggregation
+  meanVector **hourly = calloc(hoursPerDay, sizeof(meanVector *));
+  if (hourly == NULL) {
+    perror("calloc");
+    return 1;
+  }
+
+  bool failed = false;
+
+  for (size_t hour = 0; hour < hoursPerDay && !failed; hour++) {
+    const double *grid = dataset->data.data + (bandOffset + hour) * cellCount;
+    hourly[hour] = weightedMeansFromGrid(dailyMean, weights, grid, options->deterministic);
+    failed = hourly[hour] == NULL;
+  }
+
+  unsigned int extremes[2] = {AGGREGATION_DAILY_MIN, AGGREGATION_DAILY_MAX};
+
+  for (size_t i = 0; i < 2 && !failed; i++) {
+    if (!(options->aggregations & extremes[i])) {
+      continue;
+    }
+
+    meanVector *extreme = extremeOfTables(hourly, hoursPerDay, extremes[i] == AGGREGATION_DAILY_MAX);
+    if (extreme == NULL) {
+      failed = true;
+      break;
+    }
+
+    restoreRowOrder(extreme);
+    products->entries[hoursPerDay + i] = (struct aggregatedTable) {
+      .values = extreme,
+      .aggregation = extremes[i],
+      .variable = VARIABLE_TOTAL_COLUMN_WATER_VAPOUR
+    };
+  }
+
+  // hourly tables are handed on, or dropped if they were only needed for the extremes
+  for (size_t hour = 0; hour < hoursPerDay; hour++) {
+    if (hourly[hour] == NULL) {
+      continue;
+    }
+
+    if (failed || !(options->aggregations & AGGREGATION_HOURLY)) {
+      freeWeightedMeans(hourly[hour]);
+      continue;
+    }
+
+    restoreRowOrder(hourly[hour]);
+    products->entries[hour] = (struct aggregatedTable) {
+      .values = hourly[hour],
+      .aggregation = AGGREGATION_HOURLY,
+      .hour = dataset->temporal.hours[hour],
+      .variable = VARIABLE_TOTAL_COLUMN_WATER_VAPOUR
+    };
+  }
+
+  free(hourly);
+
+  // compact tables into the order they're written in
+  for (size_t i = 0; i < hoursPerDay + 2; i++) {
+    if (products->entries[i].values != NULL) {
+      products->entries[products->size] = products->entries[i];
+      products->size++;
+    }
+  }
+
+  return failed ? 1 : 0;
+}
+
+[[nodiscard]] char *aggregationTablePath(const char *outputDirectory, unsigned int variable, int year,
+    int month, int day, unsigned int aggregation, int hour)
+{
+  const char *prefix = variablePrefix(variable);
+  if (prefix == NULL) {
+    return NULL;
+  }
+
+  switch (aggregation) {
+    case AGGREGATION_DAILY_MIN:
+      return constructFilePath("%s/%s_%.4d-%.2d-%.2d_MIN.txt", outputDirectory, prefix, year, month, day);
+    case AGGREGATION_DAILY_MAX:
+      return constructFilePath("%s/%s_%.4d-%.2d-%.2d_MAX.txt", outputDirectory, prefix, year, month, day);
+    case AGGREGATION_HOURLY:
+      return constructFilePath("%s/%s_%.4d-%.2d-%.2dT%.2d.txt", outputDirectory, prefix, year, month, day,
+                               hour);
+    default:
+      return constructFilePath("%s/%s_%.4d-%.2d-%.2d.txt", outputDirectory, prefix, year, month, day);
+  }
+}
+
+int computeVariables(const struct loadedDataset *dataset, const meanVector *dailyMean,
+                     const weightTable *weights, const option_t *options, size_t bandOffset,
+                     struct dayProducts *products)
+{
+  size_t hoursPerDay = dataset->temporal.hoursElements;
+  size_t bandsPerVariable = (size_t) dataset->layerCount;
+  size_t extraCount = (size_t) dataset->variableCount - 1;
+
+  struct aggregatedTable *grown = realloc(products->entries,
+                                          (products->size + extraCount) * sizeof(struct aggregatedTable));
+  if (grown == NULL) {
+    perror("realloc");
+    return 1;
+  }
+
+  products->entries = grown;
+
+  // bands are grouped by variable, water vapor being the first group, see loadDataset()
+  for (int i = 1; i < dataset->variableCount; i++) {
+    struct averagedData average = {0};
+
+    if (averageRawDataWithSizeOffset(&dataset->data, &average, hoursPerDay,
+                                     (size_t) i * bandsPerVariable + bandOffset, options->deterministic)) {
+      fprintf(stderr, "Failed to compute averages of variable %s\n",
+              variableRequestName(nthVariable(options->variables, i)));
+      freeAverageData(&average);
+      return 1;
+    }
+
+    meanVector *means = weightedMeansFromGrid(dailyMean, weights, average.data, options->deterministic);
+    freeAverageData(&average);
+
+    if (means == NULL) {
+      return 1;
+    }
+
+    means->variable = nthVariable(options->variables, i);
+    restoreRowOrder(means);
+
+    products->entries[products->size] = (struct aggregatedTable) {
+      .values = means,
+      .aggregation = AGGREGATION_DAILY_MEAN,
+      .variable = means->variable
+    };
+    products->size++;
+  }
+
+  return 0;
+}
+
+unsigned int completionAggregation(unsigned int aggregations)
+{
+  if (aggregations & AGGREGATION_DAILY_MEAN) {
+    return AGGREGATION_DAILY_MEAN;
+  }
+
+  if (aggregations & AGGREGATION_DAILY_MAX) {
+    return AGGREGATION_DAILY_MAX;
+  }
+
+  if (aggregations & AGGREGATION_DAILY_MIN) {
+    return AGGREGATION_DAILY_MIN;
+  }
+
+  return AGGREGATION_HOURLY;
+}
+
+int rowOrderCmp(const void *a, const void *b)
+{
+  const struct m *first = (const struct m *) a;
+  const struct m *second = (const struct m *) b;
+
+  if (first->order != second->order) {
+    return first->order < second->order ? -1 : 1;
+  }
+
+  return 0;
+}
+
+void restoreRowOrder(meanVector *values)
+{
+  qsort(values->entries, values->size, sizeof(struct m), rowOrderCmp);
+}
+
+[[nodiscard]] meanVector *copyWeightedMeans(const meanVector *values)
+{
+  meanVector *copy = malloc(sizeof(meanVector));
+  struct m *entries = malloc((values->size > 0 ? values->size : 1) * sizeof(struct m));
+
+  if (copy == NULL || entries == NULL) {
+    perror("malloc");
+    free(copy);
+    free(entries);
+    return NULL;
+  }
+
+  *copy = *values;
+  memcpy(entries, values->entries, values->size * sizeof(struct m));
+  copy->entries = entries;
+  copy->capcity = values->size;
+
+  return copy;
+}
+
+int writeWeightedMeans(meanVector *values, const char *filePath)
+{
+  if (values == NULL || filePath == NULL) {
+    return 1;
+  }
+
+  // the whole table is formatted in memory and written at once, no stdio involved
+  size_t length;
+  char *table = formatWeightedMeans(values, &length);
+  if (table == NULL) {
+    return 1;
+  }
+
+  int status = writeFileAtomically(filePath, table, length);
+
+  free(table);
+
+  return status;
+}
+
+double coordinateFromCell(double origin, double axisOfInterest, double pixelExtent,
+                          double complementaryAxis, double rotation)
+{
+  // axisOfInterest is the axis for which coordinate should be caclulated
+  return origin + axisOfInterest * pixelExtent + complementaryAxis * rotation;
+}
+
+stringList *parseLogFile(const char *filePath)
+{
+  stringList *out = NULL, *tail = NULL;
+
+  if (filePath == NULL) {
+    return NULL;
+  }
+
+  FILE *f = fopen(filePath, "r");
+  if (f == NULL) {
+    return NULL;
+  }
+
+  char *lineptr = NULL;
+  size_t n = 0;
+
+  while (getline(&lineptr, &n, f) != -1) {
+    // remove newline
+    size_t length = strlen(lineptr);
+
+    if (lineptr[length - 1] == '\n') {
+      lineptr[length - 1] = '\0';
+    }
+
+    const char *downloadedFile = strtok(lineptr, "\t");
+    const char *status = strtok(NULL, "\t");
+    const char *completedDays = strtok(NULL, "\t");
+
+    if (downloadedFile == NULL || status == NULL) {
+      fprintf(stderr, "Failed to parse line in log file\n");
+      freeStringList(out);
+      free(lineptr);
+      fclose(f);
+      return NULL;
+    }
+
+    stringList *node = calloc(1, sizeof(stringList));
+    if (node == NULL) {
+      fprintf(stderr, "Failed to allocate memory for stringList node\n");
+      freeStringList(out);
+      free(lineptr);
+      fclose(f);
+      return NULL;
+    }
+
+    node->string = strdup(downloadedFile);
+    node->status = strdup(status);
+    node->completedDays = completedDays == NULL ? 0 : parseCompletedDays(completedDays);
+
+    if (node->string == NULL || node->status == NULL) {
+      fprintf(stderr, "Failed to store fields in node\n");
+      free(node->string);
+      free(node->status);
+      freeStringList(out);
+      free(lineptr);
+      fclose(f);
+      return NULL;
+    }
+
+    if (out == NULL) {
+      out = tail = node;
+    } else {
+      tail->next = node;
+      tail = node;
+    }
+
+    free(lineptr);
+    n = 0;
+  }
+
+  if (!feof(f)) {
+    fprintf(stderr, "An error occurred while reading %s\n", filePath);
+    freeStringList(out);
+    out = NULL;
+  } else if (replayJournal(&out, filePath)) {
+    fprintf(stderr, "An error occurred while replaying journal of %s\n", filePath);
+    freeStringList(out);
+    out = NULL;
+  }
+
+  free(lineptr);
+  fclose(f);
+
+  return out;
+}
+
+int writeUpdatedLogFile(stringList *list, const char *filePath)
+{
+  if (list == NULL || filePath == NULL) {
+    return 1;
+  }
+
+  // write to a temporary file next to the log file and move it into place afterwards, thus
+  // readers never see a partially written log file
+  char *temporaryPath = constructFilePath("%s.%d.tmp", filePath, (int) getpid());
+  if (temporaryPath == NULL) {
+    fprintf(stderr, "Failed to construct path of temporary log file\n");
+    return 1;
+  }
+
+  FILE *f = fopen(temporaryPath, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Failed to open log file for writing\n");
+    free(temporaryPath);
+    return 1;
+  }
+
+  for (stringList *ptr = list; ptr != NULL; ptr = ptr->next) {
+    // days are only of interest until the entire dataset is processed
+    bool writeDays = ptr->completedDays != 0 && strcmp("PROCESSED", ptr->status) != 0;
+
+    if (fprintf(f, "%s\t%s", ptr->string, ptr->status) < 0
+        || (writeDays && writeCompletedDays(f, ptr->completedDays))
+        || fputc('\n', f) == EOF) {
+      fprintf(stderr,
+              "Encountered error while writing updated log file. Start all over at this point...\n");
+      fclose(f);
+      unlink(temporaryPath);
+      free(temporaryPath);
+      return 1;
+    }
+  }
+
+  if (fflush(f) != 0 || fsync(fileno(f)) != 0) {
+    perror("fsync");
+    fclose(f);
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  if (fclose(f) != 0) {
+    perror("fclose");
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  if (rename(temporaryPath, filePath) != 0) {
+    perror("rename");
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  free(temporaryPath);
+
+  return 0;
+}
+
+unsigned int parseCompletedDays(const char *field)
+{
+  unsigned int days = 0;
+  const char *position = field;
+
+  while (*position != '\0') {
+    char *end;
+    long day = strtol(position, &end, 10);
+
+    if (end == position) {
+      // skip garbage up to the next separator
+      end = strchr(position, ',');
+      if (end == NULL) {
+        break;
+      }
+    } else if (day >= 1 && day <= MAXDAY) {
+      days |= 1u << (day - 1);
+    }
+
+    position = *end == ',' ? end + 1 : end;
+  }
+
+  return days;
+}
+
+int writeCompletedDays(FILE *f, unsigned int days)
+{
+  bool first = true;
+
+  for (int day = 1; day <= MAXDAY; day++) {
+    if (!(days & (1u << (day - 1)))) {
+      continue;
+    }
+
+    if (fprintf(f, first ? "\t%d" : ",%d", day) < 0) {
+      return 1;
+    }
+
+    first = false;
+  }
+
+  return 0;
+}
+
+bool isDayCompleted(const stringList *entry, const option_t *options, int year, int month, int day)
+{
+  if (day < 1 || day > MAXDAY || !(entry->completedDays & (1u << (day - 1)))) {
+    return false;
+  }
+
+  unsigned int aggregation = completionAggregation(options->aggregations);
+
+  // hourly tables depend on the hours of the dataset, rely on the log file alone
+  if (!options->store && aggregation == AGGREGATION_HOURLY) {
+    return true;
+  }
+
+  // the log file may claim a day whose table was removed afterwards, recompute it in that case
+  char *tablePath = options->store
+                    ? storePathOfYear(options->outputDirectory, year)
+                    : aggregationTablePath(options->outputDirectory, VARIABLE_TOTAL_COLUMN_WATER_VAPOUR, year,
+                                           month, day, aggregation, 0);
+  if (tablePath == NULL) {
+    return false;
+  }
+
+  bool exists = options->store ? isStoreDayWritten(tablePath, month, day) : fileExists(tablePath);
+  free(tablePath);
+
+  return exists;
+}
+
+int backFillOptions(option_t *options, GDALDatasetH dataset, const int *bands, int bandCount)
+{
+  // make sure to start fresh options for new file
+  memset(options->years, 0, sizeof(int) * options->yearsElements);
+  memset(options->months, 0, sizeof(int) * options->monthsElements);
+  memset(options->days, 0, sizeof(int) * options->daysElements);
+  memset(options->hours, 0, sizeof(int) * options->hoursElements);
+  options->daysElements = 0;
+  options->hoursElements = 0;
+
+  // back-fill fields of options struct with one strong assumptions: only ever fill back hours and potentially days;
+  // each file is thus assumed to only contain data for either an entire day or entire month
+  options->yearsElements = 1;
+  options->monthsElements = 1;
+  struct tm time;
+  struct tm *timePointer;
+
+  int daysHistogram[31] = {0};
+  int hoursHistogram[24] = {0};
+
+  for (int i = 0; i < bandCount; i++) {
+    GDALRasterBandH band = openRasterBand(dataset, bands[i]);
+
+    if (band == NULL) {
+      return 1;
+    }
+
+    const char *refTime = GDALGetMetadataItem(band, "GRIB_REF_TIME", NULL);
+    if (refTime == NULL) {
+      return 1;
+    }
+
+    if (sizeof(time_t) != sizeof(long)) {
+      return 1;
+    }
+
+    bool error = false;
+    time_t epoch = (time_t) convertLongSafely(refTime, &error);
+
+    if (error) {
+      fprintf(stderr, "Error: Overflow/Underflow while parsing 'GRIB_REF_TIME'=%s to long\n", refTime);
+      return 1;
+    }
+
+    if ((timePointer = gmtime(&epoch)) == NULL) {
+      return 1;
+    }
+
+    time = *timePointer;
+
+    options->years[0] = time.tm_year + 1900;
+    options->months[0] = time.tm_mon + 1;
+    daysHistogram[time.tm_mday - 1] += 1;
+    hoursHistogram[time.tm_hour] += 1;
+  }
+
+  for (int i = 0; i < 31; i++) {
+    if (daysHistogram[i]) {
+      options->days[options->daysElements] = i + 1;
+      options->daysElements += 1;
+    }
+  }
+
+  for (int i = 0; i < 24; i++) {
+    if (hoursHistogram[i]) {
+      options->hours[options->hoursElements] = i;
+      options->hoursElements += 1;
+    }
+  }
+
+  return 0;
+}
+
+bool isDayUpToDate(const stringList *entry, const vectorGeometryVector *areasOfInterest,
+                   const option_t *options, const option_t *temporal, int day)
+{
+  struct tableProvenance expected = {.features = areasOfInterest->digest};
+
+  if (hashInput(entry->string, temporal, day, options, &expected.input)) {
+    return false;
+  }
+
+  char *tablePath = constructFilePath("%s/WVP_%.4d-%.2d-%.2d.txt", options->outputDirectory,
+                                      temporal->years[0], temporal->months[0], day);
+  if (tablePath == NULL) {
+    return false;
+  }
+
+  bool upToDate = isTableUpToDate(tablePath, &expected);
+  free(tablePath);
+
+  return upToDate;
+}
+
+int *selectPendingBands(const stringList *entry, const vectorGeometryVector *areasOfInterest,
+                        const option_t *options, option_t *temporal, int layerCount, int *bandCount)
+{
+  int *bandMap = calloc(layerCount > 0 ? (size_t) layerCount : 1, sizeof(int));
+  if (bandMap == NULL) {
+    perror("calloc");
+    return NULL;
+  }
+
+  // same layout as assumed by computeDataset: bands are ordered by day, each day has hoursElements bands
+  int hoursPerDay = (int) temporal->hoursElements;
+  size_t pendingDays = 0;
+  *bandCount = 0;
+
+  for (size_t i = 0; i < temporal->daysElements && (int) i * hoursPerDay < layerCount; i++) {
+    int day = temporal->days[i];
+
+    // incremental runs revisit written days, thus only skip them if their inputs didn't change
+    bool skip = options->incremental
+                ? isDayUpToDate(entry, areasOfInterest, options, temporal, day)
+                : isDayCompleted(entry, options, temporal->years[0], temporal->months[0], day);
+
+    if (skip) {
+#ifdef DEBUG
+      printf("Skipping already written day %.4d-%.2d-%.2d: %s\n", temporal->years[0],
+             temporal->months[0], day, entry->string);
+#endif
+      continue;
+    }
+
+    for (int hour = 0; hour < hoursPerDay && (int) i * hoursPerDay + hour < layerCount; hour++) {
+      // GDAL band numbers start at 1
+      bandMap[*bandCount] = (int) i * hoursPerDay + hour + 1;
+      *bandCount += 1;
+    }
+
+    temporal->days[pendingDays] = day;
+    pendingDays++;
+  }
+
+  temporal->daysElements = pendingDays;
+
+  return bandMap;
+}
+
+int *bandsOfVariables(GDALDatasetH dataset, unsigned int variables, int *bandsPerVariable)
+{
+  int layerCount = GDALGetRasterCount(dataset);
+  int count = variableCount(variables);
+  int *bands = calloc((size_t) count * (size_t) (layerCount > 0 ? layerCount : 1), sizeof(int));
+  int *found = calloc((size_t) count, sizeof(int));
+
+  if (bands == NULL || found == NULL) {
+    perror("calloc");
+    free(bands);
+    free(found);
+    return NULL;
+  }
+
+  bool failed = false;
+
+  for (int i = 1; i <= layerCount && !failed; i++) {
+    GDALRasterBandH band = openRasterBand(dataset, i);
+    const char *element = band == NULL ? NULL : GDALGetMetadataItem(band, "GRIB_ELEMENT", NULL);
+
+    if (element == NULL) {
+      fprintf(stderr, "Band %d has no 'GRIB_ELEMENT'\n", i);
+      failed = true;
+      break;
+    }
+
+    // bands of variables which were downloaded but aren't processed are left out
+    for (int variable = 0; variable < count; variable++) {
+      if (strcmp(element, variableElement(nthVariable(variables, variable))) == 0) {
+        bands[variable * layerCount + found[variable]] = i;
+        found[variable]++;
+        break;
+      }
+    }
+  }
+
+  // each variable must cover the same days and hours, water vapor's layout is assumed for all
+  for (int variable = 1; variable < count && !failed; variable++) {
+    if (found[variable] != found[0]) {
+      fprintf(stderr, "Dataset holds %d bands of %s but %d bands of %s\n", found[0],
+              variableRequestName(nthVariable(variables, 0)), found[variable],
+              variableRequestName(nthVariable(variables, variable)));
+      failed = true;
+    }
+  }
+
+  if (!failed && found[0] == 0) {
+    fprintf(stderr, "Dataset holds no bands of %s\n", variableRequestName(nthVariable(variables, 0)));
+    failed = true;
+  }
+
+  if (failed) {
+    free(bands);
+    free(found);
+    return NULL;
+  }
+
+  *bandsPerVariable = found[0];
+
+  for (int variable = 1; variable < count; variable++) {
+    memmove(bands + variable * found[0], bands + variable * layerCount, (size_t) found[0] * sizeof(int));
+  }
+
+  free(found);
+
+  return bands;
+}
+
+int *variableBandMap(const int *variableBands, int bandsPerVariable, int variableCount, const int *bandMap,
+                     int bandCount)
+{
+  int *combined = calloc((size_t) variableCount * (size_t) (bandCount > 0 ? bandCount : 1), sizeof(int));
+  if (combined == NULL) {
+    perror("calloc");
+    return NULL;
+  }
+
+  // positions selected by bandMap are relative to the bands of a single variable
+  for (int variable = 0; variable < variableCount; variable++) {
+    for (int i = 0; i < bandCount; i++) {
+      int position = bandMap == NULL ? i : bandMap[i] - 1;
+      combined[variable * bandCount + i] = variableBands[variable * bandsPerVariable + position];
+    }
+  }
+
+  return combined;
+}
+
+int loadDataset(stringList *entry, const vectorGeometryVector *areasOfInterest,
+                const option_t *options, struct loadedDataset *dataset)
+{
+  dataset->entry = entry;
+  // temporal fields are back-filled per dataset, thus work on a private copy of the options
+  dataset->temporal = *options;
+
+#ifdef DEBUG
+  printf("Processing file %s\n", entry->string);
+#endif
+  GDALDatasetH ds = openRasterDataset(entry->string);
+
+  if (ds == NULL)
+    return 1;
+
+  dataset->variableCount = variableCount(options->variables);
+
+  // bands are always selected by variable, thus bands of variables which were downloaded but
+  // aren't processed never end up in water vapor tables; from here on, layers are counted per
+  // variable
+  int *variableBands = bandsOfVariables(ds, options->variables, &dataset->layerCount);
+
+  if (variableBands == NULL) {
+    fprintf(stderr, "Failed to assign bands of %s to variables\n", entry->string);
+    closeGDALDataset(ds);
+    return 1;
+  }
+
+  // the layout of days and hours is taken from water vapor, which all variables share
+  if (backFillOptions(&dataset->temporal, ds, variableBands, dataset->layerCount)) {
+    fprintf(stderr, "Failed to extract temporal information from dataset\n");
+    free(variableBands);
+    closeGDALDataset(ds);
+    return 1;
+  }
+
+  int bandsPerVariable = dataset->layerCount;
+  int *bandMap = NULL;
+  int bandCount = dataset->layerCount;
+
+  if (entry->completedDays != 0 || options->incremental) {
+    bandMap = selectPendingBands(entry, areasOfInterest, options, &dataset->temporal,
+                                 dataset->layerCount, &bandCount);
+
+    if (bandMap == NULL) {
+      free(variableBands);
+      closeGDALDataset(ds);
+      return 1;
+    }
+
+    dataset->layerCount = bandCount;
+  }
+
+  int *combined = variableBandMap(variableBands, bandsPerVariable, dataset->variableCount, bandMap,
+                                  bandCount);
+
+  free(variableBands);
+  free(bandMap);
+
+  if (combined == NULL) {
+    closeGDALDataset(ds);
+    return 1;
+  }
+
+  bandMap = combined;
+  bandCount *= dataset->variableCount;
+
+  if (bandCount == 0) {
+    // all days were written during an earlier run
+    dataset->data.data = NULL;
+  } else if (readRasterDatasetBands(ds, &dataset->data, bandMap, bandCount)) {
+    dataset->data.data = NULL;
+    free(bandMap);
+    closeGDALDataset(ds);
+    return 1;
+  }
+
+  free(bandMap);
+
+  if (getRasterMetadata(ds, &dataset->transform)) {
+    fprintf(stderr, "Failed to get geo transformation from dataset %s\n", entry->string);
+    closeGDALDataset(ds);
+    freeRawData(&dataset->data);
+    dataset->data.data = NULL;
+    return 1;
+  }
+
+  closeGDALDataset(ds);
+
+  return 0;
+}
+
+int prepareDayGrid(const struct loadedDataset *dataset, const option_t *options, size_t bandOffset,
+                   struct dayGrid *grid)
+{
+  size_t hoursPerDay = dataset->temporal.hoursElements;
+
+  *grid = (struct dayGrid) {0};
+
+#ifdef DEBUG
+  printf("Averaging bands %lu to %lu\n", bandOffset, bandOffset + hoursPerDay);
+#endif
+
+  if (averageRawDataWithSizeOffset(&dataset->data, &grid->average, hoursPerDay, bandOffset,
+                                   options->deterministic)) {
+    fprintf(stderr, "Failed to compute averages\n");
+    freeDayGrid(grid);
+    return 1;
+  }
+
+  // same SRS as passed to calculateAreaWeightedMean()
+  grid->tree = buildSTRTreefromRaster(&grid->average, &dataset->transform,
+                                      getCRSType(SRS_WKT_WGS84_LAT_LONG), &grid->cells);
+
+  if (grid->cells == NULL || grid->tree == NULL) {
+    fprintf(stderr, "Failed to construct STRTree from raster file %s", dataset->entry->string);
+    freeDayGrid(grid);
+    return 1;
+  }
+
+  return 0;
+}
+
+void freeDayGrid(struct dayGrid *grid)
+{
+  if (grid->tree != NULL) {
+    GEOSSTRtree_destroy(grid->tree);
+  }
+
+  if (grid->cells != NULL) {
+    freeCellGeometryList(grid->cells);
+  }
+
+  freeAverageData(&grid->average);
+
+  *grid = (struct dayGrid) {0};
+}
+
+[[nodiscard]] meanVector *computeDayTableOnGrid(const struct loadedDataset *dataset,
+    const struct dayGrid *grid, vectorGeometryVector *areasOfInterest, const option_t *options,
+    size_t bandOffset, struct dayProducts *products)
+{
+  // a function to query the tree constructed by buildSTRTreefromRaster which somehow gets me for each polygon in areasOfInterest
+  // the intersecting polygons of the tree so I can calculate the area-weighted average
+  intersectionVector *intersections = querySTRTree(areasOfInterest, grid->tree,
+                                      options->usePrecomputedCentroid);
+  if (intersections == NULL) {
+    fprintf(stderr, "No intersections found\n"); // this is not treated as an error
+    // not pretty, but: areasOfInterest and grid are not freed here but by the caller
+    return NULL;
+  }
+
+  // a functions that (should be split up into smaller pieces)
+  // 1. converts GEOSGeometry back to OGRGeometry (via WKBExport)
+  // 2. given two OGRGeometries (Polygons) computes the intersection
+  // 3. a) depending on the CRS being geodesic or not, calculating the appropriate area
+  // 3. b) query a WKT/dataset for property
+  // 4. calculate area-weighted average
+  // 5. get centroid of polygon
+  // intersections are only computed once per day, other aggregations reuse their weights
+  weightTable weights = {0};
+  bool aggregate = products != NULL && (options->aggregations & ~AGGREGATION_DAILY_MEAN) != 0;
+  bool interpolate = options->acquisitionTimeField != NULL;
+  bool extraVariables = products != NULL && dataset->variableCount > 1;
+
+  meanVector *weightedMeans = calculateAreaWeightedMean(intersections, SRS_WKT_WGS84_LAT_LONG,
+                              options->footprint, true, options->usePrecomputedCentroid, options->deterministic,
+                              aggregate || interpolate || extraVariables ? &weights : NULL, options->intersectionExport);
+  // the climatology is documented to hold daily means, not values at acquisition times
+  bool keepDailyMean = interpolate && products != NULL && options->climatology;
+
+  if (weightedMeans == NULL) {
+    fprintf(stderr, "Failed to calculate weighted means\n");
+  } else if (keepDailyMean && (products->dailyMean = copyWeightedMeans(weightedMeans)) == NULL) {
+    freeWeightedMeans(weightedMeans);
+    weightedMeans = NULL;
+  } else if (interpolate && interpolateAcquisitionTimes(dataset, weightedMeans, &weights, areasOfInterest,
+             options, bandOffset)) {
+    fprintf(stderr, "Failed to interpolate values at acquisition times\n");
+    if (products != NULL) {
+      freeDayProducts(products);
+    }
+    freeWeightedMeans(weightedMeans);
+    weightedMeans = NULL;
+  } else if (aggregate && computeAggregations(dataset, weightedMeans, &weights, options, bandOffset,
+             products)) {
+    fprintf(stderr, "Failed to calculate temporal aggregations\n");
+    freeDayProducts(products);
+    freeWeightedMeans(weightedMeans);
+    weightedMeans = NULL;
+  } else if (extraVariables && computeVariables(dataset, weightedMeans, &weights, options, bandOffset,
+             products)) {
+    fprintf(stderr, "Failed to calculate means of further variables\n");
+    freeDayProducts(products);
+    freeWeightedMeans(weightedMeans);
+    weightedMeans = NULL;
+  } else {
+    restoreRowOrder(weightedMeans);
+  }
+
+  freeWeightTable(&weights);
+
+  freeIntersections(intersections);
+
+  return weightedMeans;
+}
+
+[[nodiscard]] meanVector *computeDayTable(const struct loadedDataset *dataset,
+    vectorGeometryVector *areasOfInterest, const option_t *options, size_t bandOffset,
+    struct dayProducts *products)
+{
+  struct dayGrid grid;
+
+  if (prepareDayGrid(dataset, options, bandOffset, &grid)) {
+    return NULL;
+  }
+
+  meanVector *weightedMeans = computeDayTableOnGrid(dataset, &grid, areasOfInterest, options,
+                              bandOffset, products);
+
+  freeDayGrid(&grid);
+
+  return weightedMeans;
+}
+
+[[nodiscard]] meanVector *computeIncrementalTable(const struct loadedDataset *dataset,
+    vectorGeometryVector *areasOfInterest, const option_t *options, size_t bandOffset,
+    const char *tablePath, const struct tableProvenance *provenance)
+{
+  char *manifestPath = manifestPathFromTable(tablePath);
+  if (manifestPath == NULL) {
+    fprintf(stderr, "Failed to construct path of manifest\n");
+    return NULL;
+  }
+
+  tableManifest manifest;
+  bool reuse = fileExists(tablePath) && readManifest(manifestPath, &manifest) == 0;
+
+  free(manifestPath);
+
+  if (reuse && manifest.provenance.input != provenance->input) {
+    // dataset was replaced or options changed, every row is affected
+    freeManifest(&manifest);
+    reuse = false;
+  }
+
+  if (!reuse) {
+    return computeDayTable(dataset, areasOfInterest, options, bandOffset, NULL);
+  }
+
+  vectorGeometryVector changed;
+
+  if (selectChangedFeatures(&manifest, areasOfInterest, &changed)) {
+    freeManifest(&manifest);
+    return NULL;
+  }
+
+#ifdef DEBUG
+  printf("Recomputing %lu of %lu features for %s\n", changed.size, areasOfInterest->size, tablePath);
+#endif
+
+  meanVector *weightedMeans;
+
+  if (changed.size == 0) {
+    // features were only removed, rows of remaining ones are taken from the manifest
+    weightedMeans = calloc(1, sizeof(meanVector));
+    if (weightedMeans == NULL) {
+      perror("calloc");
+    }
+  } else {
+    weightedMeans = computeDayTable(dataset, &changed, options, bandOffset, NULL);
+  }
+
+  free(changed.entries);
+
+  if (weightedMeans != NULL && spliceManifestRows(weightedMeans, &manifest, areasOfInterest)) {
+    fprintf(stderr, "Failed to reuse rows of manifest for %s\n", tablePath);
+    freeWeightedMeans(weightedMeans);
+    weightedMeans = NULL;
+  }
+
+  freeManifest(&manifest);
+
+  return weightedMeans;
+}
+
+void setTableMetadata(meanVector *values, const struct tableProvenance *provenance,
+                      size_t featureCount, int year, int month, int day, bool completesDay)
+{
+  values->provenance = *provenance;
+  values->featureCount = featureCount;
+  values->year = year;
+  values->month = month;
+  values->day = day;
+  values->completesDay = completesDay;
+}
+
+int computeAoiDay(const struct loadedDataset *dataset, const struct dayGrid *grid,
+                  vectorGeometryVector *areasOfInterest, const option_t *options, int day, size_t bandOffset,
+                  bool completesDay, tableSink sink, void *sinkData)
+{
+  const option_t *temporal = &dataset->temporal;
+  int currentYear = temporal->years[0];
+  int currentMonth = temporal->months[0];
+
+  // all days of a year share a single store
+  char *outputFilePath = options->store
+                         ? storePathOfYear(options->outputDirectory, currentYear)
+                         : constructFilePath("%s/WVP_%.4d-%.2d-%.2d.txt", options->outputDirectory,
+                                             currentYear, currentMonth, day);
+
+  if (outputFilePath == NULL) {
+    fprintf(stderr, "Failed to construct file path for output file\n");
+    return 1;
+  }
+
+  struct tableProvenance provenance = {.features = areasOfInterest->digest};
+
+  if (hashInput(dataset->entry->string, temporal, day, options, &provenance.input)) {
+    fprintf(stderr, "Failed to hash inputs of %s\n", outputFilePath);
+    free(outputFilePath);
+    return 1;
+  }
+
+  struct dayProducts products = {0};
+
+  if (options->intersectionExport != NULL) {
+    setIntersectionExportContext(options->intersectionExport, options->areaOfInterest, currentYear,
+                                 currentMonth, day);
+  }
+
+  meanVector *weightedMeans = grid == NULL
+                              ? computeIncrementalTable(dataset, areasOfInterest, options, bandOffset, outputFilePath,
+                                  &provenance)
+                              : computeDayTableOnGrid(dataset, grid, areasOfInterest, options, bandOffset, &products);
+
+  if (weightedMeans == NULL) {
+    free(outputFilePath);
+    return 1;
+  }
+
+  bool writeDailyMean = options->aggregations & AGGREGATION_DAILY_MEAN;
+
+  setTableMetadata(weightedMeans, &provenance, areasOfInterest->size, currentYear, currentMonth, day,
+                   completesDay);
 
-    const char *refTime = GDALGetMetadataItem(band, "GRIB_REF_TIME", NULL);
-    if (refTime == NULL) {
+  // only tables of incremental runs are revisited, which excludes all but the daily mean
+  weightedMeans->recordManifest = options->incremental;
+
+  // the daily mean is accumulated even if it's not written; days skipped as completed were added
+  // by the run which completed them
+  meanVector *dailyMean = products.dailyMean != NULL ? products.dailyMean : weightedMeans;
+
+  if (products.dailyMean != NULL) {
+    setTableMetadata(products.dailyMean, &provenance, areasOfInterest->size, currentYear, currentMonth,
+                     day, false);
+  }
+
+  if (options->climatology && accumulateClimatology(options->outputDirectory, dailyMean)) {
+    freeDayProducts(&products);
+    freeWeightedMeans(weightedMeans);
+    free(outputFilePath);
+    return 1;
+  }
+
+  bool someErrors = false;
+
+  // tables of further aggregations are written first, such that the day is only completed by
+  // its last table
+  for (size_t j = 0; j < products.size && !someErrors; j++) {
+    struct aggregatedTable *table = &products.entries[j];
+    char *tablePath = aggregationTablePath(options->outputDirectory, table->variable, currentYear,
+                                           currentMonth, day, table->aggregation, table->hour);
+
+    if (tablePath == NULL) {
+      fprintf(stderr, "Failed to construct file path for output text file\n");
+      someErrors = true;
+      break;
+    }
+
+    setTableMetadata(table->values, &provenance, areasOfInterest->size, currentYear, currentMonth, day,
+                     completesDay && !writeDailyMean && j == products.size - 1);
+
+    meanVector *values = table->values;
+    table->values = NULL;
+
+    if (sink(values, tablePath, dataset->entry, day, sinkData) != 0) {
+      someErrors = true;
+    }
+  }
+
+  freeDayProducts(&products);
+
+  if (someErrors || !writeDailyMean) {
+    freeWeightedMeans(weightedMeans);
+    free(outputFilePath);
+
+    return someErrors ? 1 : 0;
+  }
+
+  // 6. write tuple (centroid coordinates, average value, ERA5) to a file; ownership of both
+  //    the table and the file path is passed on to the sink
+  return sink(weightedMeans, outputFilePath, dataset->entry, day, sinkData) != 0 ? 1 : 0;
+}
+
+int computeDataset(const struct loadedDataset *dataset, vectorGeometryVector *areasOfInterest,
+                   const option_t *options, tableSink sink, void *sinkData)
+{
+  bool someErrors = false;
+
+  const option_t *temporal = &dataset->temporal;
+  const int nLayers = dataset->layerCount;
+
+  size_t hoursPerDay = temporal->hoursElements;
+  size_t processedDays = 0;
+
+  int currentYear = temporal->years[0];
+  int currentMonth = temporal->months[0];
+
+  for (size_t i = 0; i < temporal->daysElements
+       && (int) (processedDays * hoursPerDay) < nLayers; i++, processedDays++) {
+    int day = temporal->days[i];
+#ifdef DEBUG
+    printf("%lu/%u\n", processedDays * hoursPerDay, nLayers);
+#endif
+
+    if (!isValidDate(currentYear, currentMonth, day)) {
+#ifdef DEBUG
+      printf("Skipping invalid date %.4d-%.2d-%.2d: %s\n", currentYear, currentMonth, day,
+             dataset->entry->string);
+#endif
+      continue;
+    }
+
+    size_t bandOffset = processedDays * hoursPerDay;
+
+    // the averaged grid is shared by all AOIs, incremental runs only recompute changed features
+    // and average within computeIncrementalTable
+    struct dayGrid grid = {0};
+
+    if (!options->incremental && prepareDayGrid(dataset, options, bandOffset, &grid)) {
+      someErrors = true;
+      break;
+    }
+
+    const struct dayGrid *sharedGrid = options->incremental ? NULL : &grid;
+
+    // the day is completed by the last table of the last AOI
+    someErrors = computeAoiDay(dataset, sharedGrid, areasOfInterest, options, day, bandOffset,
+                               options->aoiSetCount == 0, sink, sinkData) != 0;
+
+    for (size_t j = 0; j < options->aoiSetCount && !someErrors; j++) {
+      const struct aoiSet *set = &options->aoiSets[j];
+
+      someErrors = computeAoiDay(dataset, sharedGrid, set->areasOfInterest, &set->options, day,
+                                 bandOffset, j == options->aoiSetCount - 1, sink, sinkData) != 0;
+    }
+
+    freeDayGrid(&grid);
+
+    if (someErrors) {
+      break;
+    }
+  }
+
+  return someErrors ? 1 : 0;
+}
+
+int writeTable(meanVector *values, char *filePath, stringList *entry, int day, void *sinkData)
+{
+  entryProvider *provider = (entryProvider *) sinkData;
+  int status = 0;
+
+  // stores are only read by 'export', which doesn't need manifests
+  if (isStorePath(filePath)) {
+    status = writeStoreDay(filePath, values);
+
+    if (status == 0 && values->completesDay && provider != NULL && provider->completeDay != NULL) {
+      provider->completeDay(provider, entry, day);
+    }
+
+    freeWeightedMeans(values);
+    free(filePath);
+
+    return status;
+  }
+
+  char *manifestPath = manifestPathFromTable(filePath);
+
+  // a manifest left from an earlier incremental run no longer describes the table written now
+  if (manifestPath == NULL || (unlink(manifestPath) != 0 && errno != ENOENT)) {
+    fprintf(stderr, "Failed to remove manifest of '%s'\n", filePath);
+    status = 1;
+  } else if (writeWeightedMeans(values, filePath) != 0) {
+    // tables are replaced atomically, thus a previous table is left intact
+    fprintf(stderr, "Encountered error while writing output table '%s'\n", filePath);
+    status = 1;
+  } else {
+    // manifests are optional, without one an incremental run recomputes the entire table
+    if (values->recordManifest && writeManifest(manifestPath, values) != 0) {
+      unlink(manifestPath);
+    }
+
+    if (values->completesDay && provider != NULL && provider->completeDay != NULL) {
+      provider->completeDay(provider, entry, day);
+    }
+  }
+
+  free(manifestPath);
+
+  freeWeightedMeans(values);
+  free(filePath);
+
+  return status;
+}
+
+stringList *nextDownloadedEntry(entryProvider *provider)
+{
+  stringList **cursor = (stringList **) provider->state;
+
+  while (*cursor != NULL) {
+    stringList *entry = *cursor;
+    *cursor = entry->next;
+
+    if (strcmp("DOWNLOADED", entry->status) == 0) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+stringList *nextIncrementalEntry(entryProvider *provider)
+{
+  stringList **cursor = (stringList **) provider->state;
+
+  while (*cursor != NULL) {
+    stringList *entry = *cursor;
+    *cursor = entry->next;
+
+    if (strcmp("DOWNLOADED", entry->status) == 0 || strcmp("PROCESSED", entry->status) == 0) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+void markEntry(entryProvider *provider, stringList *entry, bool success)
+{
+  if (success) {
+#ifndef DEBUG
+    char *msg = strdup("PROCESSED");
+    if (msg == NULL) {
+      fprintf(stderr, "Failed to allocate memory for new message. Not marking %s as processed\n",
+              entry->string);
+    } else {
+      free(entry->status);
+      entry->status = msg;
+      entry->completedDays = 0;
+      fprintf(stderr, "Processsed file %s\n", entry->string);
+
+      if (provider->journal != NULL && journalAppend(provider->journal, entry->string, msg)) {
+        fprintf(stderr, "Failed to record status of %s in journal\n", entry->string);
+      }
+    }
+#else
+    (void) provider;
+#endif
+  } else {
+    fprintf(stderr, "Encountered errors while processing %s. Not marking dataset as processed.\n",
+            entry->string);
+  }
+}
+
+void markDay(entryProvider *provider, stringList *entry, int day)
+{
+#ifndef DEBUG
+  if (day < 1 || day > MAXDAY) {
+    return;
+  }
+
+  entry->completedDays |= 1u << (day - 1);
+
+  if (provider->journal != NULL) {
+    char record[16];
+    snprintf(record, sizeof(record), "%s\t%d", JOURNAL_DAY_STATUS, day);
+
+    if (journalAppend(provider->journal, entry->string, record)) {
+      fprintf(stderr, "Failed to record day %d of %s in journal\n", day, entry->string);
+    }
+  }
+#else
+  (void) provider;
+  (void) entry;
+  (void) day;
+#endif
+}
+
+int extentOfLogEntries(const stringList *list, bool includeProcessed, OGREnvelope *extent,
+                       double *pixelSize)
+{
+  bool found = false;
+
+  for (const stringList *entry = list; entry != NULL; entry = entry->next) {
+    if (strcmp("DOWNLOADED", entry->status) != 0
+        && !(includeProcessed && strcmp("PROCESSED", entry->status) == 0)) {
+      continue;
+    }
+
+    OGREnvelope rasterExtent;
+    double rasterPixelSize;
+    if (getRasterExtent(entry->string, &rasterExtent, &rasterPixelSize)) {
+      continue;
+    }
+
+    if (found) {
+      extent->MinX = MIN(extent->MinX, rasterExtent.MinX);
+      extent->MaxX = MAX(extent->MaxX, rasterExtent.MaxX);
+      extent->MinY = MIN(extent->MinY, rasterExtent.MinY);
+      extent->MaxY = MAX(extent->MaxY, rasterExtent.MaxY);
+      *pixelSize = MIN(*pixelSize, rasterPixelSize);
+    } else {
+      *extent = rasterExtent;
+      *pixelSize = rasterPixelSize;
+      found = true;
+    }
+  }
+
+  return found ? 0 : 1;
+}
+
+int processEntries(entryProvider *provider, vectorGeometryVector *areasOfInterest,
+                   const option_t *options)
+{
+  stringList *entry;
+
+  while ((entry = provider->next(provider)) != NULL) {
+    struct loadedDataset dataset = {0};
+
+    if (loadDataset(entry, areasOfInterest, options, &dataset)) {
+      provider->complete(provider, entry, false);
+      continue;
+    }
+
+    bool someErrors = computeDataset(&dataset, areasOfInterest, options, writeTable, provider) != 0;
+
+    freeRawData(&dataset.data);
+
+    provider->complete(provider, entry, !someErrors);
+  }
+
+  return 0;
+}
+
+int loadAoiSets(option_t *options, const OGREnvelope *spatialFilter, double simplifyTolerance)
+{
+  for (size_t i = 0; i < options->aoiSetCount; i++) {
+    struct aoiSet *set = &options->aoiSets[i];
+
+    set->outputDirectory = constructFilePath("%s/%s", options->outputDirectory, set->name);
+    set->aoiCache = options->aoiCache == NULL ? NULL : constructFilePath("%s.%s", options->aoiCache,
+                    set->name);
+
+    if (set->outputDirectory == NULL || (options->aoiCache != NULL && set->aoiCache == NULL)) {
+      fprintf(stderr, "Failed to construct paths of additional AOI '%s'\n", set->name);
       return 1;
     }
 
-    if (sizeof(time_t) != sizeof(long)) {
+    if (mkdir(set->outputDirectory, 0755) != 0 && errno != EEXIST) {
+      perror("mkdir");
       return 1;
     }
 
-    bool error = false;
-    time_t epoch = (time_t) convertLongSafely(refTime, &error);
+    set->areasOfInterest = set->aoiCache != NULL
+                           ? buildGEOSGeometriesCached(set->filePath, set->layerName, SRS_WKT_WGS84_LAT_LONG,
+                               options->usePrecomputedCentroid, options->threads, spatialFilter, simplifyTolerance,
+                               set->aoiCache)
+                           : buildGEOSGeometriesFromFile(set->filePath, set->layerName, SRS_WKT_WGS84_LAT_LONG,
+                               options->usePrecomputedCentroid, options->threads, spatialFilter, simplifyTolerance);
 
-    if (error) {
-      fprintf(stderr, "Error: Overflow/Underflow while parsing 'GRIB_REF_TIME'=%s to long\n", refTime);
+    if (set->areasOfInterest == NULL) {
+      fprintf(stderr, "Failed to process additional AOI '%s'\n", set->name);
       return 1;
     }
 
-    if ((timePointer = gmtime(&epoch)) == NULL) {
+    if (sortFeaturesAlongHilbertCurve(set->areasOfInterest)) {
+      fprintf(stderr, "Failed to sort additional AOI '%s'\n", set->name);
       return 1;
     }
 
-    time = *timePointer;
+    if (digestAreaOfInterest(set->filePath, set->layerName, options->usePrecomputedCentroid,
+                             simplifyTolerance, NULL, &set->areasOfInterest->digest)) {
+      fprintf(stderr, "Failed to compute digest of additional AOI '%s'\n", set->name);
+      return 1;
+    }
 
-    options->years[0] = time.tm_year + 1900;
-    options->months[0] = time.tm_mon + 1;
-    daysHistogram[time.tm_mday - 1] += 1;
-    hoursHistogram[time.tm_hour] += 1;
+    // acquisition times are only read for the main AOI
+    set->options = *options;
+    set->options.areaOfInterest = set->filePath;
+    set->options.aoiName = set->layerName;
+    set->options.outputDirectory = set->outputDirectory;
+    set->options.aoiCache = set->aoiCache;
+    set->options.acquisitionTimeField = NULL;
+    set->options.aoiSets = NULL;
+    set->options.aoiSetCount = 0;
   }
 
-  for (int i = 0; i < 31; i++) {
-    if (daysHistogram[i]) {
-      options->days[options->daysElements] = i + 1;
-      options->daysElements += 1;
-    }
+  return 0;
+}
+
+int detachIntersectionExport(option_t *options)
+{
+  if (options->intersectionExport == NULL) {
+    return 0;
   }
 
-  for (int i = 0; i < 24; i++) {
-    if (hoursHistogram[i]) {
-      options->hours[options->hoursElements] = i;
-      options->hoursElements += 1;
-    }
+  int status = closeIntersectionExport(options->intersectionExport);
+
+  options->intersectionExport = NULL;
+
+  for (size_t i = 0; i < options->aoiSetCount; i++) {
+    options->aoiSets[i].options.intersectionExport = NULL;
   }
 
-  return 0;
+  return status;
 }
 
 int process(option_t *options)
 {
-  bool someErrors;
-
   stringList *logFileList = parseLogFile(options->logFile);
 
   if (logFileList == NULL) {
     return 1;
   }
 
+  // features outside of all rasters to process can't intersect anything, thus they're not read at
+  // all; stores and climatologies hold every feature across runs and need all of them
+  bool filterFeatures = options->spatialFilter && !options->store && !options->climatology;
+  OGREnvelope rasterExtent;
+  double pixelSize = 0.0;
+  bool extentFound = (filterFeatures || options->simplifyTolerance > 0.0)
+                     && extentOfLogEntries(logFileList, options->incremental, &rasterExtent, &pixelSize) == 0;
+  const OGREnvelope *spatialFilter = filterFeatures && extentFound ? &rasterExtent : NULL;
+
+  // without any raster to process there's nothing the tolerance could be relative to
+  double simplifyTolerance = options->simplifyTolerance * pixelSize;
+
+  if (options->simplifyTolerance > 0.0 && !extentFound) {
+    fprintf(stderr, "Warning: No raster to derive the pixel size from, features are not simplified\n");
+  }
+
   // WKT of ERA5 is assumed to be set to WGS84 and won't change over time; former information from:
   // https://confluence.ecmwf.int/display/CKB/ERA5%3A+data+documentation#heading-SpatialreferencesystemsandEarthmodel and
   // https://gis.stackexchange.com/a/380251
-  vectorGeometryVector *areasOfInterest = buildGEOSGeometriesFromFile(options->areaOfInterest,
-                                          options->aoiName,
-                                          SRS_WKT_WGS84_LAT_LONG,
-                                          options->usePrecomputedCentroid);
+  vectorGeometryVector *areasOfInterest = options->aoiCache != NULL
+                                          ? buildGEOSGeometriesCached(options->areaOfInterest, options->aoiName,
+                                              SRS_WKT_WGS84_LAT_LONG, options->usePrecomputedCentroid, options->threads,
+                                              spatialFilter, simplifyTolerance, options->aoiCache)
+                                          : buildGEOSGeometriesFromFile(options->areaOfInterest, options->aoiName,
+                                              SRS_WKT_WGS84_LAT_LONG, options->usePrecomputedCentroid, options->threads,
+                                              spatialFilter, simplifyTolerance);
 
   if (areasOfInterest == NULL) {
     fprintf(stderr, "Failed to process area of interest\n");
@@ -1053,199 +2459,164 @@ int process(option_t *options)
     return 1;
   }
 
-  for (stringList *ptr = logFileList; ptr != NULL; ptr = ptr->next) {
-    someErrors = false;
-
-    if (strcmp("DOWNLOADED", ptr->status) != 0) {
-      continue;
-    }
-
-#ifdef DEBUG
-    printf("Processing file %s\n", ptr->string);
-#endif
-    GDALDatasetH ds = openRasterDataset(ptr->string);
+  if (sortFeaturesAlongHilbertCurve(areasOfInterest)) {
+    fprintf(stderr, "Failed to sort area of interest\n");
+    freeVectorGeometryList(areasOfInterest);
+    freeStringList(logFileList);
+    return 1;
+  }
 
-    if (ds == NULL)
-      continue;
+  // times are read on every run, they're not part of the AOI cache
+  if (options->acquisitionTimeField != NULL
+      && readAcquisitionTimes(options->areaOfInterest, options->aoiName, options->acquisitionTimeField,
+                              areasOfInterest)) {
+    fprintf(stderr, "Failed to read acquisition times of area of interest\n");
+    freeVectorGeometryList(areasOfInterest);
+    freeStringList(logFileList);
+    return 1;
+  }
 
-    const int nLayers = GDALGetRasterCount(ds);
+  if (digestAreaOfInterest(options->areaOfInterest, options->aoiName, options->usePrecomputedCentroid,
+                           simplifyTolerance, options->acquisitionTimeField, &areasOfInterest->digest)) {
+    fprintf(stderr, "Failed to compute digest of area of interest\n");
+    freeVectorGeometryList(areasOfInterest);
+    freeStringList(logFileList);
+    return 1;
+  }
 
-    if (backFillOptions(options, ds)) {
-      fprintf(stderr, "Failed to extract temporal information from dataset\n");
-      closeGDALDataset(ds);
-      continue;
-    }
+  // the export is opened by the process computing the first intersection, thus workers write
+  // files of their own; options of additional AOIs share it
+  intersectionExport exporter;
 
-    struct rawData data = {0};
-    if (readRasterDataset(ds, &data)) {
-      closeGDALDataset(ds);
-      continue;
+  if (options->intersectionExportPath != NULL) {
+    if (initIntersectionExport(&exporter, options->intersectionExportPath,
+                               options->jobs > 1 || options->shardClaim)) {
+      freeVectorGeometryList(areasOfInterest);
+      freeStringList(logFileList);
+      return 1;
     }
 
-    struct geoTransform transform = {0};
-    if (getRasterMetadata(ds, &transform)) {
-      fprintf(stderr, "Failed to get geo transformation from dataset %s\n", ptr->string);
-      closeGDALDataset(ds);
-      freeRawData(&data);
-      continue;
-    }
+    options->intersectionExport = &exporter;
+  }
 
-    closeGDALDataset(ds);
+  // geometries of additional AOIs are owned by the options and freed with them
+  if (loadAoiSets(options, spatialFilter, simplifyTolerance)) {
+    detachIntersectionExport(options);
+    freeVectorGeometryList(areasOfInterest);
+    freeStringList(logFileList);
+    return 1;
+  }
 
-    size_t hoursPerDay = options->hoursElements;
-    size_t processedDays = 0;
+  statusJournal journal;
 
-    int currentYear = options->years[0];
-    int currentMonth = options->months[0];
+  if (journalOpen(&journal, options->logFile, JOURNAL_SYNC_INTERVAL)) {
+    detachIntersectionExport(options);
+    freeVectorGeometryList(areasOfInterest);
+    freeStringList(logFileList);
+    return 1;
+  }
 
-    for (size_t i = 0; i < options->daysElements
-         && (int) (processedDays * hoursPerDay) < nLayers; i++, processedDays++) {
-      int day = options->days[i];
-#ifdef DEBUG
-      printf("%lu/%u\n", processedDays * hoursPerDay, nLayers);
-#endif
+  stringList *cursor = logFileList;
 
-      if (!isValidDate(currentYear, currentMonth, day)) {
-#ifdef DEBUG
-        printf("Skipping invalid date %.4d-%.2d-%.2d: %s\n", currentYear, currentMonth, day, ptr->string);
-#endif
-        continue;
-      }
+  entryProvider provider = {
+    .next = options->incremental ? nextIncrementalEntry : nextDownloadedEntry,
+    .complete = markEntry,
+    .completeDay = markDay,
+    .state = (void *) &cursor,
+    .journal = &journal
+  };
 
-      struct averagedData average = {0};
+  claimState claims;
 
-#ifdef DEBUG
-      printf("Averaging bands %lu to %lu\n", processedDays * hoursPerDay,
-             processedDays * hoursPerDay + hoursPerDay);
-#endif
+  if (options->shardClaim) {
+    if (initClaimState(&claims, logFileList, options->logFile, options->claimExpiry)) {
+      journalClose(&journal, false);
+      detachIntersectionExport(options);
+      freeVectorGeometryList(areasOfInterest);
+      freeStringList(logFileList);
+      return 1;
+    }
 
-      if (averageRawDataWithSizeOffset(&data, &average, hoursPerDay, processedDays * hoursPerDay)) {
-        fprintf(stderr, "Failed to compute averages\n");
-        freeAverageData(&average);
-        someErrors = true;
-        break;
-      }
+    provider.next = nextClaimedEntry;
+    provider.complete = completeClaimedEntry;
+    provider.state = (void *) &claims;
+  }
 
-      cellGeometryList *rasterCellsAsGEOS = NULL;
+  int status;
+  bool isWorker = false;
 
-      GEOSSTRtree *rasterTree = buildSTRTreefromRaster(&average, &transform, &rasterCellsAsGEOS);
+  if (options->jobs > 1) {
+    status = runWorkers(&provider, areasOfInterest, options, &isWorker);
+  } else if (options->pipeline) {
+    status = runPipeline(&provider, areasOfInterest, options);
+  } else {
+    status = processEntries(&provider, areasOfInterest, options);
+  }
 
-      if (rasterCellsAsGEOS == NULL) {
-        fprintf(stderr, "Failed to construct STRTree from raster file %s", ptr->string);
-        freeAverageData(&average);
-        GEOSSTRtree_destroy(rasterTree);
-        someErrors = true;
-        break;
-      }
+  if (isWorker) {
+    // the log file is owned by the parent process
+    journalClose(&journal, false);
 
-      if (rasterTree == NULL) {
-        fprintf(stderr, "Failed to construct STRTree from raster file %s", ptr->string);
-        freeAverageData(&average);
-        freeCellGeometryList(rasterCellsAsGEOS);
-        someErrors = true;
-        break;
-      }
+    if (detachIntersectionExport(options)) {
+      status = 1;
+    }
 
-      // a function to query the tree constructed by buildSTRTreefromRaster which somehow gets me for each polygon in areasOfInterest
-      // the intersecting polygons of the tree so I can calculate the area-weighted average
-      intersectionVector *intersections = querySTRTree(areasOfInterest, rasterTree,
-                                          options->usePrecomputedCentroid);
-      if (intersections == NULL) {
-        fprintf(stderr, "No intersections found\n"); // this is not treated as an error
-        // not pretty, but: areasOfInterest, data and rasterWKT are not freed here but after for-loop
-        freeAverageData(&average);
-        freeCellGeometryList(rasterCellsAsGEOS);
-        GEOSSTRtree_destroy(rasterTree);
-        someErrors = true;
-        break;
-      }
+    freeVectorGeometryList(areasOfInterest);
+    freeStringList(logFileList);
+    return status;
+  }
 
-      // a functions that (should be split up into smaller pieces)
-      // 1. converts GEOSGeometry back to OGRGeometry (via WKBExport)
-      // 2. given two OGRGeometries (Polygons) computes the intersection
-      // 3. a) depending on the CRS being geodesic or not, calculating the appropriate area
-      // 3. b) query a WKT/dataset for property
-      // 4. calculate area-weighted average
-      // 5. get centroid of polygon
-      meanVector *weightedMeans = calculateAreaWeightedMean(intersections, SRS_WKT_WGS84_LAT_LONG,
-                                  options->footprint, true, options->usePrecomputedCentroid);
-      if (weightedMeans == NULL) {
-        fprintf(stderr, "Failed to calculate weighted means\n");
-        freeAverageData(&average);
-        freeCellGeometryList(rasterCellsAsGEOS);
-        GEOSSTRtree_destroy(rasterTree);
-        freeIntersections(intersections);
-        someErrors = true;
-        break;
-      }
+  if (status) {
+    fprintf(stderr, "Processing did not finish cleanly, affected datasets are left untouched\n");
+  }
 
-      char *textOutputFilePath = constructFilePath("%s/WVP_%.4d-%.2d-%.2d.txt", options->outputDirectory,
-                                 currentYear, currentMonth, day);
+  // workers share the accumulator, thus tables are written once by the parent; other instances
+  // using '--shard-claim' write them again, each time including all days added so far
+  if (options->climatology && writeClimatologyTables(options->outputDirectory)) {
+    fprintf(stderr, "Failed to write climatology tables\n");
+    status = 1;
+  }
 
-      if (textOutputFilePath == NULL) {
-        fprintf(stderr, "Failed to construct file path for output text file\n");
-        freeAverageData(&average);
-        freeCellGeometryList(rasterCellsAsGEOS);
-        GEOSSTRtree_destroy(rasterTree);
-        freeIntersections(intersections);
-        someErrors = true;
-        break;
-      }
+  for (size_t i = 0; i < options->aoiSetCount && options->climatology; i++) {
+    if (writeClimatologyTables(options->aoiSets[i].outputDirectory)) {
+      fprintf(stderr, "Failed to write climatology tables of additional AOI '%s'\n",
+              options->aoiSets[i].name);
+      status = 1;
+    }
+  }
 
-      // 6. write tuple (centroid coordinates, average value, ERA5) to a file
-      if (writeWeightedMeans(weightedMeans, textOutputFilePath) != 0) {
-        fprintf(stderr, "Encountered error while writing output table '%s'. Deleting partial file.\n",
-                textOutputFilePath);
-        freeAverageData(&average);
-        freeCellGeometryList(rasterCellsAsGEOS);
-        GEOSSTRtree_destroy(rasterTree);
-        freeIntersections(intersections);
-        unlink(textOutputFilePath);
-        free(textOutputFilePath);
-        someErrors = true;
-        break;
-      }
+  if (detachIntersectionExport(options)) {
+    status = 1;
+  }
 
-      freeCellGeometryList(rasterCellsAsGEOS);
-      freeIntersections(intersections);
-      freeWeightedMeans(weightedMeans);
+  freeVectorGeometryList(areasOfInterest);
 
-      GEOSSTRtree_destroy(rasterTree);
+  // remaining buffered records are folded into the log file by compaction below
+  bool journalFailed = journalClose(&journal, true) != 0;
 
-      freeAverageData(&average);
-      free(textOutputFilePath);
-    }
+  if (options->shardClaim) {
+    // other instances may have updated the log file in the meantime, thus the local list is stale
+    int mergeStatus = mergeClaimsIntoLogFile(options->logFile, &claims);
 
-    freeRawData(&data);
+    destroyClaimState(&claims);
+    freeStringList(logFileList);
 
-    if (!someErrors) {
-#ifndef DEBUG
-      char *msg = strdup("PROCESSED");
-      if (msg == NULL) {
-        fprintf(stderr, "Failed to allocate memory for new message. Not marking %s as processed\n",
-                ptr->string);
-      } else {
-        free(ptr->status);
-        ptr->status = msg;
-        fprintf(stderr, "Processsed file %s\n", ptr->string);
-      }
-#endif
-    } else {
-      fprintf(stderr, "Encountered errors while processing %s. Not marking dataset as processed.\n",
-              ptr->string);
+    if (mergeStatus) {
+      fprintf(stderr,
+              "Failed to update log file. Statuses are still recorded in the claim directory, rerun to merge them\n");
+      return 1;
     }
+
+    return status;
   }
 
-  freeVectorGeometryList(areasOfInterest);
+  freeStringList(logFileList);
 
-  if (writeUpdatedLogFile(logFileList, options->logFile)) {
+  if (journalFailed || compactLogFile(options->logFile)) {
     fprintf(stderr,
             "Failed to update log file. Log file and output directory are inconsistent now, clean up manually\n");
-    freeStringList(logFileList);
     return 1;
   }
 
-  freeStringList(logFileList);
-
-  return 0;
+  return status;
 }
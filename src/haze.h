@@ -22,6 +22,12 @@
 #include <stdio.h>
 #include <gdal/gdal.h>
 
+/// Temporal aggregations, combined as bit flags
+#define AGGREGATION_DAILY_MEAN 1u
+#define AGGREGATION_DAILY_MIN 2u
+#define AGGREGATION_DAILY_MAX 4u
+#define AGGREGATION_HOURLY 8u
+
 /**
  * @brief Free encapsulated fields of raw data struct
  *
@@ -50,6 +56,23 @@ void freeAverageData(struct averagedData *data);
  */
 int readRasterDataset(GDALDatasetH raster, struct rawData *dataBuffer);
 
+/**
+ * @brief Read a subset of bands of an GDAL raster dataset into a buffer
+ *
+ * @note This function returns an error if inputs are not of type double/GDT_FLOAT64.
+ *
+ * @note After the function returns, the dataBuffer object contains a heap-allocated buffer
+ *       and the caller musst free it after use.
+ *
+ * @param raster Opened raster dataset.
+ * @param dataBuffer Reference to raw data buffer.
+ * @param bandMap Band numbers (starting at 1) to read in the order they're stored in the buffer, NULL reads the first `bandCount` bands.
+ * @param bandCount Number of bands to read.
+ * @return 0 on success, 1 on error.
+ */
+int readRasterDatasetBands(GDALDatasetH raster, struct rawData *dataBuffer, int *bandMap,
+                           int bandCount);
+
 /**
  * @brief Compute arithmetic mean pixel values across raster band dimension for all bands
  *
@@ -77,10 +100,11 @@ int averageRawData(const struct rawData *data, struct averagedData *average);
  * @param average Indirect reference to structure where averaged values are stored.
  * @param size Size of window to use for arithmetic mean calculation.
  * @param offset Starting band.
+ * @param compensated Use compensated summation, see compensatedAdd().
  * @return int 0 on success, 1 on error.
  */
 int averageRawDataWithSizeOffset(const struct rawData *data, struct averagedData *average,
-                                 const size_t size, const size_t offset);
+                                 const size_t size, const size_t offset, const bool compensated);
 
 /**
  * @brief Compute arithmetic mean pixel values across raster band dimension for a subset of bands
@@ -96,10 +120,11 @@ int averageRawDataWithSizeOffset(const struct rawData *data, struct averagedData
  * @param average Indirect reference to structure where averaged values are stored.
  * @param size Size of window to use for arithmetic mean calculation.
  * @param offset Starting band.
+ * @param compensated Use compensated summation, see compensatedAdd().
  * @return int 0 on success, 1 on error.
  */
 int averagePILRawDataWithSizeOffset(const struct rawData *data, struct averagedData *average,
-                                    const size_t size, const size_t offset);
+                                    const size_t size, const size_t offset, const bool compensated);
 
 /**
  * @brief Transpose data tensor from band sequential to band interleaved by pixel
@@ -121,6 +146,9 @@ int reorderToBandInterleavedByPixel(struct rawData *data);
  *          is < 0° by +360° and computing the unsion of the new sub-geometries to
  *          obtain a "normal" polygon.
  *
+ * @remark Only used if parts overlap after shifting, otherwise compactFootprintCentroid() computes
+ *         the centroid directly.
+ *
  * @param splitFootprint Const reference to geometry object.
  * @return Reference to newly created, merged geometry (extending beyond +180°), NULL on error.
  */
@@ -149,7 +177,8 @@ int reorderToBandInterleavedByPixel(struct rawData *data);
  *
  * @note After the function returns, the caller owns the returned object and musst free it.
  *
- * @note Outputs intersection geometries in debug builds in a GeoPackage in the current working directory.
+ * @note If `exporter` is given, polygonal intersections are handed to it together with their FID,
+ *       cell, value and weight, see exportIntersection().
  *
  * @param intersections Vector containing AOI features and all vectorized raster cells that intersect a given feature.
  * @param rasterWkt CRS in WKT representation of raster dataset.
@@ -158,15 +187,199 @@ int reorderToBandInterleavedByPixel(struct rawData *data);
  *        that input geometries are already in a CRS that directly allows geodesic caclulations.
  *        See fastGeodesicArea() for further details on the imposed limitations.
  * @param usePrecomputedCentroid Set centroid coordinates previously read from input AOI instead of those computed during execution.
+ * @param deterministic Sum contributions ordered by raster cell with compensated summation, see calculateOrderedWeightedAverage().
+ * @param recordedWeights If not NULL, set to the cells and area weights of each row such that
+ *        further aggregations can be computed with weightedMeansFromGrid(). The caller must free it
+ *        with freeWeightTable(), also on error.
+ * @param exporter Export intersections are written to, NULL if they aren't exported.
  * @return mean_t* Reference to vector containing centroids of AOI geometries and associated water column value, NULL on error.
  */
 [[nodiscard]] meanVector *calculateAreaWeightedMean(intersectionVector *intersections,
     const char *rasterWkt, const bool geometriesAreFootprints,
-    const bool useFastGeodesicAreaCalculation, bool usePrecomputedCentroid);
+    const bool useFastGeodesicAreaCalculation, bool usePrecomputedCentroid, bool deterministic,
+    weightTable *recordedWeights, intersectionExport *exporter);
+
+/**
+ * @brief Compute area-weighted means of another raster with weights of an existing table
+ *
+ * @details No geometries are intersected, each row's value is computed from the cells and weights
+ *          recorded by calculateAreaWeightedMean(). Coordinates and identifiers are copied from the
+ *          template.
+ *
+ * @note The caller must free the returned table.
+ *
+ * @param template Table the weights were recorded for, its rows must not have been reordered.
+ * @param weights Weights of each row of `template`.
+ * @param grid Raster values, with the same dimensions as the raster weights were computed for.
+ * @param deterministic Sum contributions ordered by raster cell with compensated summation.
+ * @return meanVector* Table of area-weighted means, NULL on error.
+ */
+[[nodiscard]] meanVector *weightedMeansFromGrid(const meanVector *template, const weightTable *weights,
+    const double *grid, bool deterministic);
+
+/**
+ * @brief Compute the area-weighted mean of a single feature from recorded weights
+ *
+ * @param feature Cells and weights of the feature.
+ * @param grid Raster values, with the same dimensions as the raster weights were computed for.
+ * @param values Buffer of at least `feature->count` doubles.
+ * @param deterministic Sum contributions ordered by raster cell with compensated summation.
+ * @return double Area-weighted mean.
+ */
+double weightedMeanOfCells(const struct featureWeights *feature, const double *grid, double *values,
+                           bool deterministic);
+
+/**
+ * @brief Find the hours of a day bracketing a time
+ *
+ * @details Times before the first or after the last hour are assigned that hour alone.
+ *
+ * @param hours Ascending hours of the bands of a day.
+ * @param hourCount Number of hours.
+ * @param hour Fractional hour of day.
+ * @param lower Set to the index of the hour at or before `hour`.
+ * @param upper Set to the index of the hour after `hour`, equal to `lower` if there's none.
+ * @param fraction Set to the position of `hour` between both hours in range [0, 1).
+ */
+void bracketingHours(const int *hours, size_t hourCount, double hour, size_t *lower, size_t *upper,
+                     double *fraction);
+
+/**
+ * @brief Replace daily means of features with an acquisition time by values interpolated in time
+ *
+ * @details The area-weighted means of the two hourly bands bracketing a feature's acquisition time
+ *          are computed with the recorded weights and interpolated linearly. Rows of features
+ *          without acquisition time are left as they are.
+ *
+ * @param dataset Reference to loaded dataset.
+ * @param weightedMeans Table of the daily mean, its rows must not have been reordered.
+ * @param weights Weights of each row of `weightedMeans`.
+ * @param areasOfInterest Reference to vector of AOI geometries the table was computed for.
+ * @param options Reference to parsed options struct.
+ * @param bandOffset Index of the first band of the day.
+ * @return int 0 on success, 1 on error.
+ */
+int interpolateAcquisitionTimes(const struct loadedDataset *dataset, meanVector *weightedMeans,
+                                const weightTable *weights, const vectorGeometryVector *areasOfInterest,
+                                const option_t *options, size_t bandOffset);
+
+/**
+ * @brief Compute the row-wise minimum or maximum of several tables
+ *
+ * @details Rows whose values are NaN in some tables are reduced over the remaining ones.
+ *
+ * @note The caller must free the returned table.
+ *
+ * @param tables Tables with identical rows.
+ * @param count Number of tables, must be positive.
+ * @param maximum Compute the maximum instead of the minimum.
+ * @return meanVector* Table of extremes, NULL on error.
+ */
+[[nodiscard]] meanVector *extremeOfTables(meanVector *const *tables, size_t count, bool maximum);
+
+/**
+ * @brief Compute all temporal aggregations of a day besides the daily mean
+ *
+ * @details Each hour of the day is weighted with the weights of the daily mean, daily minima and
+ *          maxima are the extremes of these hourly means. Tables are added in the order hourly,
+ *          minimum, maximum and sorted into layer order.
+ *
+ * @param dataset Reference to loaded dataset.
+ * @param dailyMean Table of the daily mean, rows must not have been reordered.
+ * @param weights Weights recorded while computing `dailyMean`.
+ * @param options Reference to parsed options struct.
+ * @param bandOffset Index of the first band of the day.
+ * @param products Set to the computed tables, must be empty.
+ * @return int 0 on success, 1 on error.
+ */
+int computeAggregations(const struct loadedDataset *dataset, const meanVector *dailyMean,
+                        const weightTable *weights, const option_t *options, size_t bandOffset,
+                        struct dayProducts *products);
+
+/**
+ * @brief Compute the daily means of further variables with the weights of water vapor
+ *
+ * @details Bands of each variable are averaged per day and reduced with the recorded weights, no
+ *          geometries are intersected. The tables are appended to `products`.
+ *
+ * @param dataset Reference to loaded dataset, holding the bands of all variables.
+ * @param dailyMean Table of the daily mean of water vapor, its rows must not have been reordered.
+ * @param weights Weights of each row of `dailyMean`.
+ * @param options Reference to parsed options struct.
+ * @param bandOffset Index of the first band of the day within the bands of a single variable.
+ * @param products Tables of further variables are appended to it.
+ * @return int 0 on success, 1 on error.
+ */
+int computeVariables(const struct loadedDataset *dataset, const meanVector *dailyMean,
+                     const weightTable *weights, const option_t *options, size_t bandOffset,
+                     struct dayProducts *products);
+
+/**
+ * @brief Construct the path of the output table of a temporal aggregation
+ *
+ * @details Daily means are written to `WVP_YYYY-MM-DD.txt` as expected by FORCE, minima and maxima
+ *          to `WVP_YYYY-MM-DD_MIN.txt` and `WVP_YYYY-MM-DD_MAX.txt` and hourly means to
+ *          `WVP_YYYY-MM-DDTHH.txt`. Tables of other variables use their prefix instead of `WVP`.
+ *
+ * @note The caller must free the returned string.
+ *
+ * @param outputDirectory Directory output tables are written to.
+ * @param variable A single VARIABLE_* flag.
+ * @param year Year of the table.
+ * @param month Month of the table.
+ * @param day Day of the table.
+ * @param aggregation A single AGGREGATION_* flag.
+ * @param hour Hour of hourly tables, ignored otherwise.
+ * @return char* Path to table, NULL on error.
+ */
+[[nodiscard]] char *aggregationTablePath(const char *outputDirectory, unsigned int variable, int year,
+    int month, int day, unsigned int aggregation, int hour);
+
+/**
+ * @brief Select the aggregation whose table is written last for each day
+ *
+ * @details Writing this table completes the day, thus its existence marks a day as done.
+ *
+ * @param aggregations Selected AGGREGATION_* flags.
+ * @return unsigned int The daily mean if selected, otherwise the daily maximum, minimum or hourly means.
+ */
+unsigned int completionAggregation(unsigned int aggregations);
+
+/**
+ * @brief Callback function for `qsort` to order rows by the position of their features in the layer
+ *
+ * @param a Void-casted reference to first row of comparison.
+ * @param b Void-casted reference to second row of comparison.
+ * @return int Negative value if a < b, 0 if a = b, positive value if a > b.
+ */
+int rowOrderCmp(const void *a, const void *b);
+
+/**
+ * @brief Restore the layer order of rows
+ *
+ * @details Features are processed along a Hilbert curve, see sortFeaturesAlongHilbertCurve(). Rows
+ *          are sorted back such that tables list features in the same order as the layer does.
+ *
+ * @param values Rows to sort in place.
+ */
+void restoreRowOrder(meanVector *values);
+
+/**
+ * @brief Copy a table including its metadata
+ *
+ * @note After the function returns, the caller owns the returned object and must free it after use.
+ *
+ * @param values Table to copy.
+ * @return meanVector* Reference to heap-allocated copy, NULL on error.
+ */
+[[nodiscard]] meanVector *copyWeightedMeans(const meanVector *values);
 
 /**
  * @brief Write area weighted means to file in format usable by FORCE
  *
+ * @details The table is formatted with formatWeightedMeans() and written with a single call via a
+ *          temporary file, see writeFileAtomically().
+ *
  * @param values vector containing centroids of AOI geometries and associated water column value.
  * @param filePath Path to output file.
  * @return in 0 on success, 1 on error.
@@ -203,7 +416,8 @@ double coordinateFromCell(double origin, double axisOfInterest, double pixelExte
  *          the file path of respective ERA-5 dataset and processing status. It's
  *          assuming the format mentioned below.
  *          The order of lines in the log file are preserved in the returned linked list
- *          to keep diffs between program runs minimal.
+ *          to keep diffs between program runs minimal. Status changes recorded in the journal
+ *          `<logfile>.journal` since the last compaction are applied afterwards, see replayJournal().
  *
  * @note The log file's format is "<file path>\tSTATUS".
  *
@@ -215,6 +429,9 @@ stringList *parseLogFile(const char *filePath);
 /**
  * @brief Update logfile with new dataset statuses
  *
+ * @details The list is written to a temporary file in the same directory which then replaces
+ *          the log file atomically.
+ *
  * @note The log file's format is "<file path>\tSTATUS".
  *
  * @param list Linked list storing one line per node with file path of ERA-5 dataset and processing status.
@@ -227,7 +444,7 @@ int writeUpdatedLogFile(stringList *list, const char *filePath);
  * @brief Deduce temporal information from a given dataset
  *
  * @details This function deduces temoporal information (contained years, months, days and hours)
- *          of a given dataest by reading the metadata from all bands and counting observed
+ *          of a given dataest by reading the metadata from the given bands and counting observed
  *          values.
  *
  * @note The options struct is manipulated by this function; assumes files contain only a single
@@ -235,9 +452,375 @@ int writeUpdatedLogFile(stringList *list, const char *filePath);
  *
  * @param options Reference to parsed options, without temoporal information fields set.
  * @param dataset Opened GDAL dataset, from which temoporal information should be read.
+ * @param bands GDAL band numbers to read, e.g. those of water vapor, see bandsOfVariables().
+ * @param bandCount Number of bands.
  * @return 0 on success, 1 on error.
  */
-int backFillOptions(option_t *options, GDALDatasetH dataset);
+int backFillOptions(option_t *options, GDALDatasetH dataset, const int *bands, int bandCount);
+
+/**
+ * @brief Parse the completed days column of a log file entry
+ *
+ * @details The column is a comma-separated list of days of month. Invalid days are ignored.
+ *
+ * @param field Column to parse.
+ * @return unsigned int Bitmap of completed days, bit 0 being the first day of month.
+ */
+unsigned int parseCompletedDays(const char *field);
+
+/**
+ * @brief Write the completed days column of a log file entry, including the leading tab
+ *
+ * @param f File to write to.
+ * @param days Bitmap of completed days, must not be 0.
+ * @return int 0 on success, 1 on error.
+ */
+int writeCompletedDays(FILE *f, unsigned int days);
+
+/**
+ * @brief Check if a day of a dataset was written during an earlier run
+ *
+ * @details A day is considered complete only if it's recorded in the log file entry and its
+ *          output table still exists, or the day is present in the year's output store when using
+ *          '--store'.
+ *
+ * @param entry Log file entry.
+ * @param options Pointer to option_t struct, holding output directory and whether a store is used.
+ * @param year Year of day to check.
+ * @param month Month of day to check.
+ * @param day Day of month to check.
+ * @return true If the day doesn't need to be computed again.
+ * @return false Otherwise.
+ */
+bool isDayCompleted(const stringList *entry, const option_t *options, int year, int month, int day);
+
+/**
+ * @brief Check if the output table of a day is up to date with its dataset and the area of interest
+ *
+ * @param entry Log file entry referencing the dataset.
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @param temporal Temporal information back-filled from the dataset.
+ * @param day Day of month to check.
+ * @return true If the table doesn't need to be computed again.
+ * @return false Otherwise.
+ */
+bool isDayUpToDate(const stringList *entry, const vectorGeometryVector *areasOfInterest,
+                   const option_t *options, const option_t *temporal, int day);
+
+/**
+ * @brief Determine the bands of a dataset belonging to days which are not completed yet
+ *
+ * @details Completed days are removed from `temporal`, thus the remaining days line up with the
+ *          bands listed in the returned map. In incremental mode, days are considered complete if
+ *          they're up to date, otherwise if they're recorded in the log file entry.
+ *
+ * @note The caller must free the returned array.
+ *
+ * @param entry Log file entry referencing the dataset.
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @param temporal Temporal information back-filled from the dataset, updated in place.
+ * @param layerCount Number of bands in dataset.
+ * @param bandCount Set to the number of bands to read.
+ * @return int* Band numbers (starting at 1) to read, NULL on error.
+ */
+int *selectPendingBands(const stringList *entry, const vectorGeometryVector *areasOfInterest,
+                        const option_t *options, option_t *temporal, int layerCount, int *bandCount);
+
+/**
+ * @brief Find the bands of each selected variable of a dataset
+ *
+ * @details Bands are assigned by their 'GRIB_ELEMENT' metadata item and keep their order within each
+ *          variable. Bands of variables which are not selected are left out.
+ *
+ * @note The caller must free the returned array.
+ *
+ * @param dataset Raster dataset.
+ * @param variables Selected VARIABLE_* flags.
+ * @param bandsPerVariable Set to the number of bands of each variable.
+ * @return int* GDAL band numbers grouped by variable in ascending order of flags, NULL on error or
+ *         if variables have a different number of bands.
+ */
+int *bandsOfVariables(GDALDatasetH dataset, unsigned int variables, int *bandsPerVariable);
+
+/**
+ * @brief Combine the bands of each variable with a selection of pending bands
+ *
+ * @note The caller must free the returned array.
+ *
+ * @param variableBands Band numbers grouped by variable, see bandsOfVariables().
+ * @param bandsPerVariable Number of bands of each variable.
+ * @param variableCount Number of variables.
+ * @param bandMap 1-based positions within the bands of a single variable, NULL to select all.
+ * @param bandCount Number of selected positions.
+ * @return int* Band map of `variableCount` x `bandCount` entries grouped by variable, NULL on error.
+ */
+int *variableBandMap(const int *variableBands, int bandsPerVariable, int variableCount, const int *bandMap,
+                     int bandCount);
+
+/**
+ * @brief Read a downloaded ERA-5 dataset into memory
+ *
+ * @details Opens the dataset referenced by the log file entry, deduces its temporal information
+ *          and reads all bands of days not completed during an earlier run as well as the geo transformation. The dataset is closed before
+ *          the function returns, thus the result can be handed to another thread for computation.
+ *          If several variables are selected, bands are grouped by variable and `layerCount` counts
+ *          the bands of a single variable.
+ *
+ * @note Temporal information is written to a private copy of the options stored in `dataset`,
+ *       the options passed in are not modified. On success, the caller must free the raw data with freeRawData().
+ *
+ * @param entry Log file entry referencing the dataset to read.
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @param dataset Reference to object which is filled by this function.
+ * @return int 0 on success, 1 on error.
+ */
+int loadDataset(stringList *entry, const vectorGeometryVector *areasOfInterest,
+                const option_t *options, struct loadedDataset *dataset);
+
+/**
+ * @brief Average the bands of a single day and build the STRTree of its cells
+ *
+ * @param dataset Reference to loaded dataset.
+ * @param options Reference to parsed options struct.
+ * @param bandOffset Index of the first band of the day.
+ * @param grid Filled with the averaged grid and its STRTree, must be freed with freeDayGrid().
+ * @return int 0 on success, 1 on error.
+ */
+int prepareDayGrid(const struct loadedDataset *dataset, const option_t *options, size_t bandOffset,
+                   struct dayGrid *grid);
+
+/**
+ * @brief Free all objects of a day grid, the struct itself is reset
+ *
+ * @param grid Grid to free, may be zero-initialized.
+ */
+void freeDayGrid(struct dayGrid *grid);
+
+/**
+ * @brief Compute the area-weighted means of a single day from its averaged grid
+ *
+ * @details The cells of the grid are intersected with the area of interest. If further aggregations
+ *          are selected, they reuse the weights of the intersections, see computeAggregations().
+ *          So do values at acquisition times, which replace the daily mean of timed features, see
+ *          interpolateAcquisitionTimes(), and daily means of further variables, see computeVariables().
+ *          The grid is not modified, thus it can be shared by several AOIs.
+ *
+ * @param dataset Reference to loaded dataset.
+ * @param grid Averaged grid of the day, see prepareDayGrid().
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @param bandOffset Index of the first band of the day.
+ * @param products Set to tables of further aggregations, may be NULL if none are needed.
+ * @return meanVector* Table of the daily mean, NULL on error.
+ */
+[[nodiscard]] meanVector *computeDayTableOnGrid(const struct loadedDataset *dataset,
+    const struct dayGrid *grid, vectorGeometryVector *areasOfInterest, const option_t *options,
+    size_t bandOffset, struct dayProducts *products);
+
+/**
+ * @brief Compute the area-weighted means of a single day
+ *
+ * @details Bands of the day are averaged and vectorized, see prepareDayGrid(), and intersected
+ *          with the area of interest, see computeDayTableOnGrid().
+ *
+ * @param dataset Reference to loaded dataset.
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @param bandOffset Index of the first band of the day.
+ * @param products Set to tables of further aggregations, may be NULL if none are needed.
+ * @return meanVector* Table of the daily mean, NULL on error.
+ */
+[[nodiscard]] meanVector *computeDayTable(const struct loadedDataset *dataset,
+    vectorGeometryVector *areasOfInterest, const option_t *options, size_t bandOffset,
+    struct dayProducts *products);
+
+/**
+ * @brief Compute the area-weighted means of a single day reusing rows of an existing table
+ *
+ * @details If the manifest of the existing table was computed from the same dataset, only rows of
+ *          added or changed features are computed and rows of unchanged features are taken from
+ *          the manifest. Otherwise, the entire table is computed.
+ *
+ * @param dataset Reference to loaded dataset.
+ * @param areasOfInterest Reference to vector of hashed AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @param bandOffset Index of the first band of the day.
+ * @param tablePath Path to the existing output table.
+ * @param provenance Hashes of the current inputs.
+ * @return meanVector* Table of the day, NULL on error.
+ */
+[[nodiscard]] meanVector *computeIncrementalTable(const struct loadedDataset *dataset,
+    vectorGeometryVector *areasOfInterest, const option_t *options, size_t bandOffset,
+    const char *tablePath, const struct tableProvenance *provenance);
+
+/**
+ * @brief Set the metadata of a table handed to a table sink
+ *
+ * @param values Table to describe.
+ * @param provenance Hashes of the inputs the table was computed from.
+ * @param featureCount Number of AOI features.
+ * @param year Year of the table.
+ * @param month Month of the table.
+ * @param day Day of the table.
+ * @param completesDay Whether writing the table completes the day.
+ */
+void setTableMetadata(meanVector *values, const struct tableProvenance *provenance,
+                      size_t featureCount, int year, int month, int day, bool completesDay);
+
+/**
+ * @brief Compute and hand on all tables of a single day and AOI
+ *
+ * @details Tables of further aggregations are handed to `sink` before the daily mean. If the day
+ *          is accumulated into a climatology, this happens before any table is handed on.
+ *
+ * @param dataset Reference to loaded dataset.
+ * @param grid Averaged grid of the day, NULL in incremental mode, where only changed features are
+ *             recomputed, see computeIncrementalTable().
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to options of the AOI, determining the output directory.
+ * @param day Day of month.
+ * @param bandOffset Index of the first band of the day.
+ * @param completesDay Whether the last table handed on completes the day.
+ * @param sink Callback receiving ownership of each computed table and its output path.
+ * @param sinkData Opaque pointer passed on to `sink`.
+ * @return int 0 on success, 1 on error.
+ */
+int computeAoiDay(const struct loadedDataset *dataset, const struct dayGrid *grid,
+                  vectorGeometryVector *areasOfInterest, const option_t *options, int day, size_t bandOffset,
+                  bool completesDay, tableSink sink, void *sinkData);
+
+/**
+ * @brief Compute daily area-weighted means of a dataset previously read with loadDataset()
+ *
+ * @details For each day contained in the dataset, bands are averaged and vectorized once and
+ *          intersected with the area of interest and each additional AOI, in this order. The
+ *          resulting tables and their output paths are handed to `sink`. Tables of further
+ *          aggregations are handed to `sink` before, only the last table of the last AOI of a
+ *          day completes it.
+ *          In incremental mode, rows of unchanged features are reused from existing tables.
+ *          Processing of the dataset stops at the first error, including errors reported by the sink.
+ *
+ * @param dataset Reference to loaded dataset.
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @param sink Callback receiving ownership of each computed table and its output path.
+ * @param sinkData Opaque pointer passed on to `sink`.
+ * @return int 0 on success, 1 on error.
+ */
+int computeDataset(const struct loadedDataset *dataset, vectorGeometryVector *areasOfInterest,
+                   const option_t *options, tableSink sink, void *sinkData);
+
+/**
+ * @brief Table sink writing tables to disk immediately
+ *
+ * @details Next to tables of incremental runs, their manifest is written. An existing manifest is
+ *          removed before the table is written, failing to write the new one isn't an error. After
+ *          the table was written, the corresponding day is completed via the provider if the table
+ *          completes it.
+ *
+ * @note Partially written files are deleted. `values` and `filePath` are freed in any case.
+ *
+ * @param values Vector containing centroids of AOI geometries and associated water column value.
+ * @param filePath Path to output file.
+ * @param entry Log file entry the table belongs to.
+ * @param day Day of month the table belongs to.
+ * @param sinkData Reference to entry provider, possibly NULL.
+ * @return int 0 on success, 1 on error.
+ */
+int writeTable(meanVector *values, char *filePath, stringList *entry, int day, void *sinkData);
+
+/**
+ * @brief Entry provider callback returning the next log file entry with status DOWNLOADED
+ *
+ * @param provider Provider whose state is a reference to a cursor into the log file's linked list.
+ * @return stringList* Next entry to process, NULL if the list is exhausted.
+ */
+stringList *nextDownloadedEntry(entryProvider *provider);
+
+/**
+ * @brief Entry provider callback returning downloaded as well as processed entries
+ *
+ * @param provider Provider whose state is a reference to a cursor into the log file's linked list.
+ * @return stringList* Next entry to process, NULL if the list is exhausted.
+ */
+stringList *nextIncrementalEntry(entryProvider *provider);
+
+/**
+ * @brief Compute the union of extents of all rasters that will be processed
+ *
+ * @details Entries with status DOWNLOADED are considered, processed ones as well when processing
+ *          incrementally. Rasters that can't be opened are skipped since processing them fails anyway.
+ *
+ * @param list Parsed log file.
+ * @param includeProcessed Whether entries with status PROCESSED are considered.
+ * @param extent Set to the union of raster extents.
+ * @param pixelSize Set to the smallest pixel size of all rasters.
+ * @return int 0 on success, 1 if not a single raster extent could be determined.
+ */
+int extentOfLogEntries(const stringList *list, bool includeProcessed, OGREnvelope *extent,
+                       double *pixelSize);
+
+/**
+ * @brief Entry provider callback marking a log file entry as processed on success
+ *
+ * @details The status change is recorded in the provider's journal, if set.
+ *
+ * @note In debug builds, entries are never marked as processed.
+ *
+ * @param provider Unused.
+ * @param entry Log file entry which finished processing.
+ * @param success Whether all tables of the dataset were computed and written.
+ */
+void markEntry(entryProvider *provider, stringList *entry, bool success);
+
+/**
+ * @brief Entry provider callback recording a single written day of a log file entry
+ *
+ * @details The day is recorded in the provider's journal, if set, thus a later run only computes
+ *          the remaining days of the dataset.
+ *
+ * @note In debug builds, days are never recorded.
+ *
+ * @param provider Provider whose journal receives the record.
+ * @param entry Log file entry the day belongs to.
+ * @param day Day of month.
+ */
+void markDay(entryProvider *provider, stringList *entry, int day);
+
+/**
+ * @brief Sequentially read, compute and write all entries supplied by a provider
+ *
+ * @param provider Reference to entry provider.
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @return int 0 on success, 1 on error.
+ */
+int processEntries(entryProvider *provider, vectorGeometryVector *areasOfInterest,
+                   const option_t *options);
+
+/**
+ * @brief Read the geometries of all additional AOIs and derive their options
+ *
+ * @details The subdirectory of each AOI is created if needed. Geometries are read the same way as
+ *          those of the main AOI, caches are kept next to the one of the main AOI.
+ *
+ * @param options Reference to parsed options struct, whose AOI sets are filled.
+ * @param spatialFilter Extent features must intersect to be read, NULL to read all.
+ * @param simplifyTolerance Tolerance features are simplified with.
+ * @return int 0 on success, 1 on error.
+ */
+int loadAoiSets(option_t *options, const OGREnvelope *spatialFilter, double simplifyTolerance);
+
+/**
+ * @brief Close the intersection export of the options, if any, and detach it from them
+ *
+ * @param options Reference to parsed options struct, including the options of additional AOIs.
+ * @return int 0 on success, 1 if intersections failed to be exported.
+ */
+int detachIntersectionExport(option_t *options);
 
 /**
  * @brief Main procedure to process downloaded ERA-5 datasets
@@ -254,6 +837,9 @@ int backFillOptions(option_t *options, GDALDatasetH dataset);
  *       horizontally. Should this change in the future, this procedure would need to
  *       be updated.
  *
+ * @note If requested via options, reading, computation and writing of datasets are overlapped
+ *       in a pipeline, see runPipeline(), and/or distributed to multiple worker processes, see runWorkers().
+ *
  * @param options Reference to parsed options struct.
  * @return 0 on success, 1 on error.
  */
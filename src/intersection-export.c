@@ -0,0 +1,385 @@
+#define _POSIX_C_SOURCE 200809L
+#include "intersection-export.h"
+#include "fscheck.h"
+#include "paths.h"
+#include "queue.h"
+#include "types.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <gdal/gdal.h>
+#include <gdal/ogr_api.h>
+#include <gdal/ogr_core.h>
+#include <gdal/ogr_srs_api.h>
+
+const char *intersectionExportDriver(const char *path)
+{
+  const char *extension = strrchr(path, '.');
+
+  if (extension == NULL || strchr(extension, '/') != NULL) {
+    return NULL;
+  }
+
+  if (strcmp(extension, ".gpkg") == 0) {
+    return "GPKG";
+  }
+
+  if (strcmp(extension, ".fgb") == 0) {
+    return "FlatGeobuf";
+  }
+
+  return NULL;
+}
+
+[[nodiscard]] char *intersectionExportPath(const char *path, bool perProcess)
+{
+  if (!perProcess) {
+    return strdup(path);
+  }
+
+  char hostName[HOST_NAME_MAX + 1];
+
+  if (gethostname(hostName, sizeof(hostName)) != 0) {
+    perror("gethostname");
+    return NULL;
+  }
+
+  hostName[HOST_NAME_MAX] = '\0';
+
+  // the driver was chosen by the extension, thus it's kept at the end
+  const char *extension = strrchr(path, '.');
+
+  return constructFilePath("%.*s-%s-%d%s", (int) (extension - path), path, hostName, (int) getpid(),
+                           extension);
+}
+
+int initIntersectionExport(intersectionExport *exporter, const char *path, bool perProcess)
+{
+  *exporter = (intersectionExport) {.perProcess = perProcess};
+
+  exporter->path = strdup(path);
+  if (exporter->path == NULL) {
+    perror("strdup");
+    return 1;
+  }
+
+  if (pthread_mutex_init(&exporter->lock, NULL) != 0) {
+    fprintf(stderr, "Failed to initialize lock of intersection export\n");
+    free(exporter->path);
+    return 1;
+  }
+
+  return 0;
+}
+
+int openIntersectionExport(intersectionExport *exporter)
+{
+  char *path = intersectionExportPath(exporter->path, exporter->perProcess);
+  if (path == NULL) {
+    fprintf(stderr, "Failed to construct path of intersection export\n");
+    return 1;
+  }
+
+  if (fileExists(path)) {
+    fprintf(stderr, "Intersection export '%s' exists already\n", path);
+    free(path);
+    return 1;
+  }
+
+  GDALDriverH driver = GDALGetDriverByName(intersectionExportDriver(path));
+  if (driver == NULL) {
+    fprintf(stderr, "Failed to get driver for intersection export '%s'\n", path);
+    free(path);
+    return 1;
+  }
+
+  OGRSpatialReferenceH spatialRef = OSRNewSpatialReference(SRS_WKT_WGS84_LAT_LONG);
+  if (spatialRef == NULL) {
+    fprintf(stderr, "Could not create new OGRSpatialReferenceH from WKT\n");
+    free(path);
+    return 1;
+  }
+
+  OSRSetAxisMappingStrategy(spatialRef, OAMS_TRADITIONAL_GIS_ORDER);
+
+  exporter->dataset = GDALCreate(driver, path, 0, 0, 0, GDT_Unknown, NULL);
+  exporter->layer = exporter->dataset == NULL ? NULL : GDALDatasetCreateLayer(exporter->dataset,
+                    INTERSECTION_LAYER_NAME, spatialRef, wkbMultiPolygon, NULL);
+
+  OSRDestroySpatialReference(spatialRef);
+
+  const char *fieldNames[] = {"parentFID", "cell", "waterVapor", "weight", "date", "aoi"};
+  const OGRFieldType fieldTypes[] = {OFTInteger64, OFTInteger64, OFTReal, OFTReal, OFTDate, OFTString};
+  bool failed = exporter->layer == NULL;
+
+  for (size_t i = 0; i < sizeof(fieldNames) / sizeof(fieldNames[0]) && !failed; i++) {
+    OGRFieldDefnH definition = OGR_Fld_Create(fieldNames[i], fieldTypes[i]);
+    failed = OGR_L_CreateField(exporter->layer, definition, true) != OGRERR_NONE;
+    OGR_Fld_Destroy(definition);
+  }
+
+  if (failed || queueInit(&exporter->batches, INTERSECTION_QUEUE_DEPTH)) {
+    fprintf(stderr, "Failed to create intersection export '%s'\n", path);
+
+    if (exporter->dataset != NULL) {
+      GDALClose(exporter->dataset);
+      unlink(path);
+    }
+
+    exporter->dataset = NULL;
+    free(path);
+    return 1;
+  }
+
+  if (pthread_create(&exporter->writer, NULL, intersectionWriter, exporter) != 0) {
+    fprintf(stderr, "Failed to start writer thread of intersection export\n");
+    queueDestroy(&exporter->batches);
+    GDALClose(exporter->dataset);
+    exporter->dataset = NULL;
+    unlink(path);
+    free(path);
+    return 1;
+  }
+
+  printf("Exporting intersections to %s\n", path);
+
+  // from here on, the path refers to the file actually written
+  free(exporter->path);
+  exporter->path = path;
+  exporter->transactions = true;
+  exporter->opened = true;
+
+  return 0;
+}
+
+void setIntersectionExportContext(intersectionExport *exporter, const char *aoi, int year, int month,
+                                  int day)
+{
+  exporter->aoi = aoi;
+  exporter->year = year;
+  exporter->month = month;
+  exporter->day = day;
+}
+
+int exportIntersection(intersectionExport *exporter, GIntBig fid, GIntBig cell, double value,
+                       double weight, OGRGeometryH geometry)
+{
+  pthread_mutex_lock(&exporter->lock);
+  bool failed = exporter->failed;
+  pthread_mutex_unlock(&exporter->lock);
+
+  if (failed) {
+    OGR_G_DestroyGeometry(geometry);
+    return 1;
+  }
+
+  // the export isn't opened again after it failed to open once
+  if (!exporter->opened && openIntersectionExport(exporter)) {
+    OGR_G_DestroyGeometry(geometry);
+
+    pthread_mutex_lock(&exporter->lock);
+    exporter->failed = true;
+    pthread_mutex_unlock(&exporter->lock);
+
+    return 1;
+  }
+
+  if (exporter->current == NULL) {
+    exporter->current = calloc(1, sizeof(struct intersectionBatch));
+    struct exportedIntersection *entries = calloc(INTERSECTION_BATCH_SIZE,
+                                           sizeof(struct exportedIntersection));
+
+    if (exporter->current == NULL || entries == NULL) {
+      perror("calloc");
+      free(exporter->current);
+      free(entries);
+      exporter->current = NULL;
+      OGR_G_DestroyGeometry(geometry);
+      return 1;
+    }
+
+    exporter->current->entries = entries;
+  }
+
+  exporter->current->entries[exporter->current->size] = (struct exportedIntersection) {
+    .fid = fid,
+    .cell = cell,
+    .value = value,
+    .weight = weight,
+    .aoi = exporter->aoi,
+    .year = exporter->year,
+    .month = exporter->month,
+    .day = exporter->day,
+    .geometry = geometry
+  };
+  exporter->current->size++;
+
+  if (exporter->current->size < INTERSECTION_BATCH_SIZE) {
+    return 0;
+  }
+
+  struct intersectionBatch *batch = exporter->current;
+  exporter->current = NULL;
+
+  if (queuePush(&exporter->batches, batch)) {
+    freeIntersectionBatch(batch);
+    return 1;
+  }
+
+  return 0;
+}
+
+void freeIntersectionBatch(struct intersectionBatch *batch)
+{
+  if (batch == NULL) {
+    return;
+  }
+
+  for (size_t i = 0; i < batch->size; i++) {
+    OGR_G_DestroyGeometry(batch->entries[i].geometry);
+  }
+
+  free(batch->entries);
+  free(batch);
+}
+
+int writeIntersectionBatch(intersectionExport *exporter, struct intersectionBatch *batch)
+{
+  OGRFeatureDefnH definition = OGR_L_GetLayerDefn(exporter->layer);
+  int fidField = OGR_FD_GetFieldIndex(definition, "parentFID");
+  int cellField = OGR_FD_GetFieldIndex(definition, "cell");
+  int valueField = OGR_FD_GetFieldIndex(definition, "waterVapor");
+  int weightField = OGR_FD_GetFieldIndex(definition, "weight");
+  int dateField = OGR_FD_GetFieldIndex(definition, "date");
+  int aoiField = OGR_FD_GetFieldIndex(definition, "aoi");
+
+  for (size_t i = 0; i < batch->size; i++) {
+    // formats without transactions, e.g. FlatGeobuf, are written sequentially anyway
+    if (exporter->transactions && exporter->uncommitted == 0) {
+      OGRErr status = GDALDatasetStartTransaction(exporter->dataset, false);
+
+      if (status == OGRERR_UNSUPPORTED_OPERATION) {
+        exporter->transactions = false;
+      } else if (status != OGRERR_NONE) {
+        fprintf(stderr, "Failed to start transaction of intersection export\n");
+        return 1;
+      }
+    }
+
+    struct exportedIntersection *intersection = &batch->entries[i];
+    OGRFeatureH feature = OGR_F_Create(definition);
+
+    if (feature == NULL) {
+      fprintf(stderr, "Failed to create feature of intersection export\n");
+      return 1;
+    }
+
+    OGR_F_SetFieldInteger64(feature, fidField, intersection->fid);
+    OGR_F_SetFieldInteger64(feature, cellField, intersection->cell);
+    OGR_F_SetFieldDouble(feature, valueField, intersection->value);
+    OGR_F_SetFieldDouble(feature, weightField, intersection->weight);
+    OGR_F_SetFieldDateTime(feature, dateField, intersection->year, intersection->month,
+                           intersection->day, 0, 0, 0, 0);
+    OGR_F_SetFieldString(feature, aoiField, intersection->aoi);
+
+    // the layer holds multipolygons, the geometry moves from the batch to the feature
+    OGRGeometryH multiPolygon = OGR_G_ForceToMultiPolygon(intersection->geometry);
+    intersection->geometry = NULL;
+
+    if (multiPolygon == NULL || OGR_F_SetGeometryDirectly(feature, multiPolygon) != OGRERR_NONE
+        || OGR_L_CreateFeature(exporter->layer, feature) != OGRERR_NONE) {
+      fprintf(stderr, "Failed to write feature of intersection export\n");
+      OGR_F_Destroy(feature);
+      return 1;
+    }
+
+    OGR_F_Destroy(feature);
+
+    exporter->written++;
+
+    if (!exporter->transactions) {
+      continue;
+    }
+
+    exporter->uncommitted++;
+
+    if (exporter->uncommitted == INTERSECTION_TRANSACTION_SIZE) {
+      if (GDALDatasetCommitTransaction(exporter->dataset) != OGRERR_NONE) {
+        fprintf(stderr, "Failed to commit transaction of intersection export\n");
+        return 1;
+      }
+
+      exporter->uncommitted = 0;
+    }
+  }
+
+  return 0;
+}
+
+void *intersectionWriter(void *arg)
+{
+  intersectionExport *exporter = (intersectionExport *) arg;
+  struct intersectionBatch *batch;
+  bool failed = false;
+
+  while ((batch = queuePop(&exporter->batches)) != NULL) {
+    // after an error, batches are still taken such that producers never block
+    if (!failed && writeIntersectionBatch(exporter, batch)) {
+      failed = true;
+
+      pthread_mutex_lock(&exporter->lock);
+      exporter->failed = true;
+      pthread_mutex_unlock(&exporter->lock);
+    }
+
+    freeIntersectionBatch(batch);
+  }
+
+  return NULL;
+}
+
+int closeIntersectionExport(intersectionExport *exporter)
+{
+  if (exporter->opened) {
+    if (exporter->current != NULL && queuePush(&exporter->batches, exporter->current)) {
+      freeIntersectionBatch(exporter->current);
+      exporter->failed = true;
+    }
+
+    exporter->current = NULL;
+
+    queueClose(&exporter->batches);
+    pthread_join(exporter->writer, NULL);
+    queueDestroy(&exporter->batches);
+
+    if (exporter->uncommitted > 0 && GDALDatasetCommitTransaction(exporter->dataset) != OGRERR_NONE) {
+      fprintf(stderr, "Failed to commit transaction of intersection export\n");
+      exporter->failed = true;
+    }
+
+    // FlatGeobuf writes its spatial index on close
+    if (GDALClose(exporter->dataset) != CE_None) {
+      fprintf(stderr, "Failed to close intersection export\n");
+      exporter->failed = true;
+    }
+
+    if (exporter->failed) {
+      fprintf(stderr, "Intersection export '%s' is incomplete\n", exporter->path);
+    } else {
+      printf("Exported %lu intersections to %s\n", exporter->written, exporter->path);
+    }
+  }
+
+  int status = exporter->failed ? 1 : 0;
+
+  pthread_mutex_destroy(&exporter->lock);
+  free(exporter->path);
+  *exporter = (intersectionExport) {0};
+
+  return status;
+}
@@ -0,0 +1,153 @@
+#ifndef INTERSECTION_EXPORT_H
+#define INTERSECTION_EXPORT_H
+/**
+ * @file intersection-export.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for exporting intersections of AOI
+ *        features and raster cells to a vector dataset from a background thread.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup intersection-export Intersection Export
+ * @{
+ */
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <gdal/gdal.h>
+
+/// Number of intersections collected before they're handed to the writer thread
+#define INTERSECTION_BATCH_SIZE 4096
+
+/// Number of batches waiting for the writer thread before exporting blocks
+#define INTERSECTION_QUEUE_DEPTH 4
+
+/// Number of features written per transaction
+#define INTERSECTION_TRANSACTION_SIZE 262144
+
+/// Name of the layer intersections are written to
+#define INTERSECTION_LAYER_NAME "intersections"
+
+/**
+ * @brief Determine the GDAL driver of an export from the extension of its path
+ *
+ * @param path Path of export.
+ * @return const char* "GPKG" for '.gpkg', "FlatGeobuf" for '.fgb', NULL for any other extension.
+ */
+const char *intersectionExportDriver(const char *path);
+
+/**
+ * @brief Construct the path an export is written to
+ *
+ * @details If multiple processes export intersections, host name and process ID are inserted in
+ *          front of the extension, e.g. 'audit-node1-4711.fgb'.
+ *
+ * @note The caller must free the returned string.
+ *
+ * @param path Path of export as given by the user.
+ * @param perProcess Whether each process writes its own export.
+ * @return char* Path of the export, NULL on error.
+ */
+[[nodiscard]] char *intersectionExportPath(const char *path, bool perProcess);
+
+/**
+ * @brief Initialize an export without opening it yet
+ *
+ * @note After the function returns successfully, the caller must close the export with
+ *       closeIntersectionExport().
+ *
+ * @param exporter Export to initialize.
+ * @param path Path of export as given by the user.
+ * @param perProcess Whether each process writes its own export.
+ * @return int 0 on success, 1 on error.
+ */
+int initIntersectionExport(intersectionExport *exporter, const char *path, bool perProcess);
+
+/**
+ * @brief Create the vector dataset of an export and start its writer thread
+ *
+ * @details Existing files are never overwritten. The layer holds the fields 'parentFID', 'cell',
+ *          'waterVapor', 'weight', 'date' and 'aoi'.
+ *
+ * @param exporter Initialized export.
+ * @return int 0 on success, 1 on error.
+ */
+int openIntersectionExport(intersectionExport *exporter);
+
+/**
+ * @brief Set the AOI and day attached to intersections exported from now on
+ *
+ * @param exporter Initialized export.
+ * @param aoi Path of the AOI file, must outlive the export.
+ * @param year Year of the day.
+ * @param month Month of the day.
+ * @param day Day of month.
+ */
+void setIntersectionExportContext(intersectionExport *exporter, const char *aoi, int year, int month,
+                                  int day);
+
+/**
+ * @brief Queue a single intersection for export, opening the export if necessary
+ *
+ * @details Intersections are collected into batches of INTERSECTION_BATCH_SIZE, full batches are
+ *          handed to the writer thread. While INTERSECTION_QUEUE_DEPTH batches are waiting, this
+ *          function blocks.
+ *
+ * @param exporter Initialized export.
+ * @param fid FID of the AOI feature.
+ * @param cell Index of the raster cell.
+ * @param value Value of the raster cell.
+ * @param weight Area weight of the intersection.
+ * @param geometry Intersection geometry, ownership is taken also on error.
+ * @return int 0 on success, 1 on error, including earlier errors of the writer thread.
+ */
+int exportIntersection(intersectionExport *exporter, GIntBig fid, GIntBig cell, double value,
+                       double weight, OGRGeometryH geometry);
+
+/**
+ * @brief Free all geometries of a batch and the batch itself
+ *
+ * @param batch Batch to free, may be NULL.
+ */
+void freeIntersectionBatch(struct intersectionBatch *batch);
+
+/**
+ * @brief Write a batch of intersections to the layer of an export
+ *
+ * @details A transaction is started before the first feature and committed every
+ *          INTERSECTION_TRANSACTION_SIZE features, provided the format supports transactions.
+ *          Geometries are promoted to multipolygons and moved from the batch to the features.
+ *
+ * @param exporter Opened export.
+ * @param batch Batch to write, its geometries are taken over.
+ * @return int 0 on success, 1 on error.
+ */
+int writeIntersectionBatch(intersectionExport *exporter, struct intersectionBatch *batch);
+
+/**
+ * @brief Writer thread of an export
+ *
+ * @details Batches are written until the queue is closed. After an error, remaining batches are
+ *          only freed.
+ *
+ * @param arg Reference to opened export.
+ * @return void* Always NULL.
+ */
+void *intersectionWriter(void *arg);
+
+/**
+ * @brief Write all queued intersections and close an export
+ *
+ * @details The last transaction is committed once the writer thread finished. Exports which were
+ *          never opened are only freed.
+ *
+ * @param exporter Initialized export.
+ * @return int 0 on success, 1 if any intersection failed to be written.
+ */
+int closeIntersectionExport(intersectionExport *exporter);
+
+/** @} */ // end of group
+#endif // INTERSECTION_EXPORT_H
@@ -0,0 +1,461 @@
+#define _POSIX_C_SOURCE 200809L
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include "journal.h"
+#include "haze.h"
+#include "math-utils.h"
+#include "paths.h"
+#include "types.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+int lockLogFile(const char *logFile)
+{
+  char *lockPath = constructFilePath("%s.lock", logFile);
+  if (lockPath == NULL) {
+    fprintf(stderr, "Failed to construct path of lock file\n");
+    return -1;
+  }
+
+  int fd = open(lockPath, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    perror("open");
+    free(lockPath);
+    return -1;
+  }
+
+  free(lockPath);
+
+  struct flock lock = {.l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0};
+
+  while (fcntl(fd, F_SETLKW, &lock) != 0) {
+    if (errno == EINTR) {
+      continue;
+    }
+    perror("fcntl");
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+void unlockLogFile(int fd)
+{
+  if (fd < 0) {
+    return;
+  }
+
+  struct flock lock = {.l_type = F_UNLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0};
+  fcntl(fd, F_SETLK, &lock);
+  close(fd);
+}
+
+int appendRecords(const char *path, const char *records, size_t length)
+{
+  int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd < 0) {
+    perror("open");
+    return 1;
+  }
+
+  size_t written = 0;
+
+  while (written < length) {
+    ssize_t n = write(fd, records + written, length - written);
+
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("write");
+      close(fd);
+      return 1;
+    }
+
+    written += (size_t) n;
+  }
+
+  if (fsync(fd) != 0) {
+    perror("fsync");
+    close(fd);
+    return 1;
+  }
+
+  if (close(fd) != 0) {
+    perror("close");
+    return 1;
+  }
+
+  return 0;
+}
+
+int appendLogRecord(const char *logFile, const char *datasetPath, const char *status)
+{
+  char *record = constructFilePath("%s\t%s\n", datasetPath, status);
+  if (record == NULL) {
+    fprintf(stderr, "Failed to construct log record\n");
+    return 1;
+  }
+
+  int lockFd = lockLogFile(logFile);
+  if (lockFd < 0) {
+    free(record);
+    return 1;
+  }
+
+  int appendStatus = appendRecords(logFile, record, strlen(record));
+
+  unlockLogFile(lockFd);
+  free(record);
+
+  return appendStatus;
+}
+
+char *journalPathFromLogFile(const char *logFile)
+{
+  return constructFilePath("%s.journal", logFile);
+}
+
+int journalOpen(statusJournal *journal, const char *logFile, size_t syncInterval)
+{
+  memset(journal, 0, sizeof(statusJournal));
+
+  journal->logFile = strdup(logFile);
+  journal->journalPath = journalPathFromLogFile(logFile);
+
+  if (journal->logFile == NULL || journal->journalPath == NULL) {
+    fprintf(stderr, "Failed to construct path of journal\n");
+    free(journal->logFile);
+    free(journal->journalPath);
+    return 1;
+  }
+
+  journal->syncInterval = syncInterval == 0 ? 1 : syncInterval;
+
+  if (pthread_mutex_init(&journal->lock, NULL) != 0) {
+    fprintf(stderr, "Failed to initialize journal mutex\n");
+    free(journal->logFile);
+    free(journal->journalPath);
+    return 1;
+  }
+
+  return 0;
+}
+
+int journalFlushLocked(statusJournal *journal)
+{
+  if (journal->length == 0) {
+    return 0;
+  }
+
+  // compaction holds the same lock, thus records are either folded into the log or survive it
+  int lockFd = lockLogFile(journal->logFile);
+  if (lockFd < 0) {
+    return 1;
+  }
+
+  int status = appendRecords(journal->journalPath, journal->buffer, journal->length);
+
+  unlockLogFile(lockFd);
+
+  if (status == 0) {
+    journal->length = 0;
+    journal->pending = 0;
+  }
+
+  return status;
+}
+
+int journalAppend(statusJournal *journal, const char *datasetPath, const char *status)
+{
+  size_t recordLength = strlen(datasetPath) + strlen(status) + 2;
+
+  pthread_mutex_lock(&journal->lock);
+
+  if (journal->length + recordLength + 1 > journal->capacity) {
+    size_t newCapacity = journal->capacity == 0 ? 4096 : journal->capacity;
+    while (journal->length + recordLength + 1 > newCapacity) {
+      newCapacity *= 2;
+    }
+
+    char *newBuffer = realloc(journal->buffer, newCapacity);
+    if (newBuffer == NULL) {
+      perror("realloc");
+      pthread_mutex_unlock(&journal->lock);
+      return 1;
+    }
+
+    journal->buffer = newBuffer;
+    journal->capacity = newCapacity;
+  }
+
+  journal->length += (size_t) snprintf(journal->buffer + journal->length,
+                                       journal->capacity - journal->length, "%s\t%s\n", datasetPath, status);
+  journal->pending++;
+
+  int flushStatus = 0;
+
+  if (journal->pending >= journal->syncInterval) {
+    flushStatus = journalFlushLocked(journal);
+  }
+
+  pthread_mutex_unlock(&journal->lock);
+
+  return flushStatus;
+}
+
+int journalFlush(statusJournal *journal)
+{
+  pthread_mutex_lock(&journal->lock);
+  int status = journalFlushLocked(journal);
+  pthread_mutex_unlock(&journal->lock);
+
+  return status;
+}
+
+int journalClose(statusJournal *journal, bool flush)
+{
+  int status = flush ? journalFlush(journal) : 0;
+
+  pthread_mutex_destroy(&journal->lock);
+  free(journal->buffer);
+  free(journal->journalPath);
+  free(journal->logFile);
+
+  return status;
+}
+
+int replayJournal(stringList **list, const char *logFile)
+{
+  char *journalPath = journalPathFromLogFile(logFile);
+  if (journalPath == NULL) {
+    fprintf(stderr, "Failed to construct path of journal\n");
+    return 1;
+  }
+
+  FILE *f = fopen(journalPath, "r");
+  free(journalPath);
+
+  if (f == NULL) {
+    // no status changes since last compaction
+    return errno == ENOENT ? 0 : 1;
+  }
+
+  logIndex index;
+  if (buildLogIndex(*list, &index)) {
+    fclose(f);
+    return 1;
+  }
+
+  stringList *tail = *list;
+  while (tail != NULL && tail->next != NULL) {
+    tail = tail->next;
+  }
+
+  char *lineptr = NULL;
+  size_t n = 0;
+  int status = 0;
+
+  while (getline(&lineptr, &n, f) != -1) {
+    size_t length = strlen(lineptr);
+
+    // a record without newline was cut short by a crash, ignore it
+    if (length == 0 || lineptr[length - 1] != '\n') {
+      break;
+    }
+
+    lineptr[length - 1] = '\0';
+
+    const char *datasetPath = strtok(lineptr, "\t");
+    const char *newStatus = strtok(NULL, "\t");
+
+    if (datasetPath == NULL || newStatus == NULL) {
+      fprintf(stderr, "Failed to parse line in journal, ignoring it\n");
+      continue;
+    }
+
+    stringList *entry = logIndexLookup(&index, datasetPath);
+
+    if (strcmp(JOURNAL_DAY_STATUS, newStatus) == 0) {
+      const char *day = strtok(NULL, "\t");
+
+      // days of datasets unknown to the log file are meaningless
+      if (entry != NULL && day != NULL) {
+        entry->completedDays |= parseCompletedDays(day);
+      }
+      continue;
+    }
+
+    if (entry == NULL) {
+      entry = calloc(1, sizeof(stringList));
+      if (entry == NULL) {
+        perror("calloc");
+        status = 1;
+        break;
+      }
+
+      entry->string = strdup(datasetPath);
+      if (entry->string == NULL) {
+        perror("strdup");
+        free(entry);
+        status = 1;
+        break;
+      }
+
+      if (tail == NULL) {
+        *list = tail = entry;
+      } else {
+        tail->next = entry;
+        tail = entry;
+      }
+
+      if (logIndexInsert(&index, entry)) {
+        status = 1;
+        break;
+      }
+    }
+
+    char *statusCopy = strdup(newStatus);
+    if (statusCopy == NULL) {
+      perror("strdup");
+      status = 1;
+      break;
+    }
+
+    free(entry->status);
+    entry->status = statusCopy;
+  }
+
+  free(lineptr);
+  freeLogIndex(&index);
+  fclose(f);
+
+  return status;
+}
+
+int compactLogFile(const char *logFile)
+{
+  int lockFd = lockLogFile(logFile);
+  if (lockFd < 0) {
+    return 1;
+  }
+
+  char *journalPath = journalPathFromLogFile(logFile);
+  if (journalPath == NULL) {
+    fprintf(stderr, "Failed to construct path of journal\n");
+    unlockLogFile(lockFd);
+    return 1;
+  }
+
+  stringList *list = parseLogFile(logFile);
+  int status = 1;
+
+  if (list != NULL && writeUpdatedLogFile(list, logFile) == 0) {
+    // the log file is durable at this point, the journal is no longer needed
+    if (unlink(journalPath) != 0 && errno != ENOENT) {
+      perror("unlink");
+    } else {
+      status = 0;
+    }
+  }
+
+  freeStringList(list);
+  free(journalPath);
+  unlockLogFile(lockFd);
+
+  return status;
+}
+
+size_t logIndexSlot(const logIndex *index, const char *datasetPath)
+{
+  uint64_t hash = fnv1a(datasetPath, strlen(datasetPath), FNV1A_OFFSET_BASIS);
+  size_t slot = (size_t) (hash & (index->capacity - 1));
+
+  while (index->slots[slot] != NULL && strcmp(index->slots[slot]->string, datasetPath) != 0) {
+    slot = (slot + 1) & (index->capacity - 1);
+  }
+
+  return slot;
+}
+
+int buildLogIndex(stringList *list, logIndex *index)
+{
+  index->capacity = LOG_INDEX_INITIAL_CAPACITY;
+  index->size = 0;
+  index->slots = calloc(index->capacity, sizeof(stringList *));
+
+  if (index->slots == NULL) {
+    perror("calloc");
+    return 1;
+  }
+
+  for (stringList *ptr = list; ptr != NULL; ptr = ptr->next) {
+    if (logIndexInsert(index, ptr)) {
+      freeLogIndex(index);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int logIndexInsert(logIndex *index, stringList *entry)
+{
+  // keep load factor below 0.5, capacity is always a power of 2
+  if ((index->size + 1) * 2 > index->capacity) {
+    logIndex grown = {.capacity = index->capacity * 2, .size = 0};
+    grown.slots = calloc(grown.capacity, sizeof(stringList *));
+
+    if (grown.slots == NULL) {
+      perror("calloc");
+      return 1;
+    }
+
+    for (size_t i = 0; i < index->capacity; i++) {
+      if (index->slots[i] != NULL) {
+        grown.slots[logIndexSlot(&grown, index->slots[i]->string)] = index->slots[i];
+        grown.size++;
+      }
+    }
+
+    free(index->slots);
+    *index = grown;
+  }
+
+  size_t slot = logIndexSlot(index, entry->string);
+
+  if (index->slots[slot] == NULL) {
+    index->size++;
+  }
+
+  // later entries of the same dataset (e.g. re-downloads) take precedence
+  index->slots[slot] = entry;
+
+  return 0;
+}
+
+stringList *logIndexLookup(const logIndex *index, const char *datasetPath)
+{
+  return index->slots[logIndexSlot(index, datasetPath)];
+}
+
+void freeLogIndex(logIndex *index)
+{
+  free(index->slots);
+  index->slots = NULL;
+  index->capacity = 0;
+  index->size = 0;
+}
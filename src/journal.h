@@ -0,0 +1,201 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+/**
+ * @file journal.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for the append-only status journal of log files.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup journal Status Journal
+ * @{
+ */
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Number of status records buffered before they are appended to the journal and synced to disk
+#define JOURNAL_SYNC_INTERVAL 8
+
+/// Status field of journal records marking a single day of a dataset as written, followed by the day of month
+#define JOURNAL_DAY_STATUS "DAY"
+
+/// Initial number of slots of a log index
+#define LOG_INDEX_INITIAL_CAPACITY 64
+
+/**
+ * @brief Acquire an exclusive lock on the lock file belonging to a log file
+ *
+ * @details POSIX record locks are used as they are supported by NFS and Lustre. The function blocks
+ *          until the lock is acquired.
+ *
+ * @param logFile Path to log file.
+ * @return int File descriptor holding the lock, -1 on error.
+ */
+int lockLogFile(const char *logFile);
+
+/**
+ * @brief Release a lock acquired with lockLogFile()
+ *
+ * @param fd File descriptor returned by lockLogFile().
+ */
+void unlockLogFile(int fd);
+
+/**
+ * @brief Append records to a file and sync it to disk
+ *
+ * @note The caller is responsible for locking.
+ *
+ * @param path Path to file, created if it doesn't exist.
+ * @param records Newline-terminated records.
+ * @param length Number of bytes in `records`.
+ * @return int 0 on success, 1 on error.
+ */
+int appendRecords(const char *path, const char *records, size_t length);
+
+/**
+ * @brief Append a single record to a log file while holding its lock
+ *
+ * @details The record is written with a single call to `write` and synced to disk before the
+ *          lock is released, thus concurrent compaction can't lose it.
+ *
+ * @param logFile Path to log file, created if it doesn't exist.
+ * @param datasetPath Path of dataset.
+ * @param status Status of dataset.
+ * @return int 0 on success, 1 on error.
+ */
+int appendLogRecord(const char *logFile, const char *datasetPath, const char *status);
+
+/**
+ * @brief Construct path of the journal belonging to a log file
+ *
+ * @note After the function returns, the caller owns the returned object and must free it after use.
+ *
+ * @param logFile Path to log file.
+ * @return char* Reference to heap-allocated path `<logfile>.journal`, NULL on error.
+ */
+char *journalPathFromLogFile(const char *logFile);
+
+/**
+ * @brief Initialize a status journal
+ *
+ * @param journal Reference to uninitialized journal.
+ * @param logFile Path to log file.
+ * @param syncInterval Number of records after which the journal is written and synced.
+ * @return int 0 on success, 1 on error.
+ */
+int journalOpen(statusJournal *journal, const char *logFile, size_t syncInterval);
+
+/**
+ * @brief Record a status change
+ *
+ * @note Thread-safe.
+ *
+ * @param journal Reference to initialized journal.
+ * @param datasetPath Path of dataset.
+ * @param status New status of dataset.
+ * @return int 0 on success, 1 on error.
+ */
+int journalAppend(statusJournal *journal, const char *datasetPath, const char *status);
+
+/**
+ * @brief Append all buffered records to the journal file and sync it to disk
+ *
+ * @note Thread-safe.
+ *
+ * @param journal Reference to initialized journal.
+ * @return int 0 on success, 1 on error.
+ */
+int journalFlush(statusJournal *journal);
+
+/**
+ * @brief Append all buffered records to the journal file, caller must hold the journal's mutex
+ *
+ * @param journal Reference to initialized journal.
+ * @return int 0 on success, 1 on error.
+ */
+int journalFlushLocked(statusJournal *journal);
+
+/**
+ * @brief Free a status journal
+ *
+ * @param journal Reference to initialized journal.
+ * @param flush Whether buffered records are flushed first; forked children pass `false` to not duplicate
+ *        records inherited from their parent.
+ * @return int 0 on success, 1 if flushing failed.
+ */
+int journalClose(statusJournal *journal, bool flush);
+
+/**
+ * @brief Apply records of the journal belonging to a log file to a parsed log file
+ *
+ * @details Records for datasets already in the list update the status of the last matching entry,
+ *          records for unknown datasets are appended to the list. Day records (`JOURNAL_DAY_STATUS`)
+ *          add to the completed days of an entry instead.
+ *
+ * @param list Indirect reference to linked list as returned by parseLogFile(), possibly NULL.
+ * @param logFile Path to log file.
+ * @return int 0 on success (including a missing journal), 1 on error.
+ */
+int replayJournal(stringList **list, const char *logFile);
+
+/**
+ * @brief Fold the journal into the log file
+ *
+ * @details While holding the lock of the log file, the log file is re-read (including its journal),
+ *          written atomically and the journal is removed. Records appended to the log file by other
+ *          processes in the meantime are preserved.
+ *
+ * @param logFile Path to log file.
+ * @return int 0 on success, 1 on error.
+ */
+int compactLogFile(const char *logFile);
+
+/**
+ * @brief Build hash index over a log file list
+ *
+ * @param list Linked list of log file entries.
+ * @param index Reference to uninitialized index.
+ * @return int 0 on success, 1 on error.
+ */
+int buildLogIndex(stringList *list, logIndex *index);
+
+/**
+ * @brief Insert or replace the entry for a dataset path
+ *
+ * @param index Reference to initialized index.
+ * @param entry Entry to insert; an existing entry with the same path is replaced.
+ * @return int 0 on success, 1 on error.
+ */
+int logIndexInsert(logIndex *index, stringList *entry);
+
+/**
+ * @brief Find the slot of a dataset path, either holding its entry or being empty
+ *
+ * @param index Reference to initialized index.
+ * @param datasetPath Path of dataset.
+ * @return size_t Slot index.
+ */
+size_t logIndexSlot(const logIndex *index, const char *datasetPath);
+
+/**
+ * @brief Look up the entry of a dataset path
+ *
+ * @param index Reference to initialized index.
+ * @param datasetPath Path of dataset.
+ * @return stringList* Entry, NULL if not found.
+ */
+stringList *logIndexLookup(const logIndex *index, const char *datasetPath);
+
+/**
+ * @brief Free hash index, entries are not freed
+ *
+ * @param index Reference to initialized index.
+ */
+void freeLogIndex(logIndex *index);
+
+/** @} */ // end of group
+#endif // JOURNAL_H
@@ -0,0 +1,341 @@
+#define _POSIX_C_SOURCE 200809L
+#include "manifest.h"
+#include "aoi-cache.h"
+#include "fscheck.h"
+#include "haze.h"
+#include "math-utils.h"
+#include "paths.h"
+#include "polygon-store.h"
+#include "types.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <gdal/ogr_api.h>
+#include <gdal/ogr_core.h>
+#include <gdal/ogr_srs_api.h>
+
+char *manifestPathFromTable(const char *tablePath)
+{
+  const char *extension = strrchr(tablePath, '.');
+  const char *directory = strrchr(tablePath, '/');
+
+  if (extension == NULL || (directory != NULL && extension < directory)) {
+    return constructFilePath("%s.manifest", tablePath);
+  }
+
+  return constructFilePath("%.*s.manifest", (int) (extension - tablePath), tablePath);
+}
+
+int hashFeature(struct vectorGeometry *feature, bool usePrecomputedCentroid)
+{
+  const compactPolygon *polygon = &feature->polygon;
+
+  if (polygon->coordinates == NULL) {
+    fprintf(stderr, "Geometry with FID %lld has no coordinates\n", feature->id);
+    return 1;
+  }
+
+  uint32_t structure[4] = {polygon->pointCount, polygon->ringCount, polygon->partCount, polygon->isMulti};
+
+  uint64_t hash = fnv1a(&feature->id, sizeof(GIntBig), FNV1A_OFFSET_BASIS);
+  hash = fnv1a(structure, sizeof(structure), hash);
+  // coordinates and offsets share one block, thus a single pass covers both
+  hash = fnv1a(polygon->coordinates, compactPolygonBlockSize(polygon->pointCount, polygon->ringCount,
+               polygon->partCount), hash);
+
+  if (usePrecomputedCentroid) {
+    hash = fnv1a(&feature->precomutedLongitude, sizeof(double), hash);
+    hash = fnv1a(&feature->precomputedLatitude, sizeof(double), hash);
+  }
+
+  feature->hash = hash;
+
+  return 0;
+}
+
+int digestAreaOfInterest(const char *filePath, const char *layerName, bool usePrecomputedCentroid,
+                         double simplifyTolerance, const char *timeField, uint64_t *digest)
+{
+  // the spatial filter depends on the rasters processed, not on the area of interest
+  if (aoiCacheKey(filePath, layerName, SRS_WKT_WGS84_LAT_LONG, usePrecomputedCentroid, NULL,
+                  simplifyTolerance, digest)) {
+    return 1;
+  }
+
+  if (timeField != NULL) {
+    *digest = fnv1a(timeField, strlen(timeField) + 1, *digest);
+  }
+
+  return 0;
+}
+
+int hashInput(const char *datasetPath, const option_t *temporal, int day, const option_t *options,
+              uint64_t *hash)
+{
+  struct stat datasetStat;
+
+  if (stat(datasetPath, &datasetStat) != 0) {
+    perror("stat");
+    return 1;
+  }
+
+  int64_t fileIdentity[3] = {
+    (int64_t) datasetStat.st_size,
+    (int64_t) datasetStat.st_mtim.tv_sec,
+    (int64_t) datasetStat.st_mtim.tv_nsec
+  };
+  int tableIdentity[3] = {temporal->years[0], temporal->months[0], day};
+  int flags = (options->footprint ? 1 : 0) | (options->usePrecomputedCentroid ? 2 : 0)
+              | (options->deterministic ? 4 : 0) | (options->acquisitionTimeField != NULL ? 8 : 0);
+
+  uint64_t inputHash = fnv1a(datasetPath, strlen(datasetPath), FNV1A_OFFSET_BASIS);
+  inputHash = fnv1a(fileIdentity, sizeof(fileIdentity), inputHash);
+  inputHash = fnv1a(tableIdentity, sizeof(tableIdentity), inputHash);
+  inputHash = fnv1a(temporal->hours, temporal->hoursElements * sizeof(int), inputHash);
+  *hash = fnv1a(&flags, sizeof(int), inputHash);
+
+  return 0;
+}
+
+int rowCmp(const void *a, const void *b)
+{
+  const struct m *first = (const struct m *) a;
+  const struct m *second = (const struct m *) b;
+
+  if (first->fid != second->fid) {
+    return first->fid < second->fid ? -1 : 1;
+  }
+
+  if (first->hash != second->hash) {
+    return first->hash < second->hash ? -1 : 1;
+  }
+
+  return 0;
+}
+
+int readManifestProvenance(const char *path, struct tableProvenance *provenance)
+{
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    return 1;
+  }
+
+  int matched = fscanf(f, "input %" SCNx64 "\nfeatures %" SCNx64 "\n", &provenance->input,
+                       &provenance->features);
+
+  fclose(f);
+
+  return matched == 2 ? 0 : 1;
+}
+
+int readManifest(const char *path, tableManifest *manifest)
+{
+  memset(manifest, 0, sizeof(tableManifest));
+
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    return 1;
+  }
+
+  if (fscanf(f, "input %" SCNx64 "\nfeatures %" SCNx64 "\n", &manifest->provenance.input,
+             &manifest->provenance.features) != 2) {
+    fprintf(stderr, "Invalid manifest header in %s\n", path);
+    fclose(f);
+    return 1;
+  }
+
+  manifest->rows = malloc(MANIFEST_INITIAL_CAPACITY * sizeof(struct m));
+  if (manifest->rows == NULL) {
+    perror("malloc");
+    fclose(f);
+    return 1;
+  }
+  manifest->capacity = MANIFEST_INITIAL_CAPACITY;
+
+  struct m row = {0};
+  int matched;
+
+  while ((matched = fscanf(f, "%lld %" SCNx64 " %la %la %la\n", &row.fid, &row.hash, &row.x, &row.y,
+                           &row.value)) == 5) {
+    if (manifest->size == manifest->capacity) {
+      struct m *newRows = realloc(manifest->rows, manifest->capacity * 2 * sizeof(struct m));
+      if (newRows == NULL) {
+        perror("realloc");
+        freeManifest(manifest);
+        fclose(f);
+        return 1;
+      }
+
+      manifest->rows = newRows;
+      manifest->capacity *= 2;
+    }
+
+    manifest->rows[manifest->size] = row;
+    manifest->size++;
+  }
+
+  if (matched != EOF || !feof(f)) {
+    fprintf(stderr, "Invalid row in manifest %s\n", path);
+    freeManifest(manifest);
+    fclose(f);
+    return 1;
+  }
+
+  fclose(f);
+
+  qsort(manifest->rows, manifest->size, sizeof(struct m), rowCmp);
+
+  return 0;
+}
+
+int writeManifest(const char *path, const meanVector *values)
+{
+  char *temporaryPath = constructFilePath("%s.%d.tmp", path, (int) getpid());
+  if (temporaryPath == NULL) {
+    fprintf(stderr, "Failed to construct path of temporary manifest\n");
+    return 1;
+  }
+
+  FILE *f = fopen(temporaryPath, "w");
+  if (f == NULL) {
+    perror("fopen");
+    free(temporaryPath);
+    return 1;
+  }
+
+  bool failed = fprintf(f, "input %016" PRIx64 "\nfeatures %016" PRIx64 "\n",
+                        values->provenance.input, values->provenance.features) < 0;
+
+  for (size_t i = 0; i < values->size && !failed; i++) {
+    failed = fprintf(f, "%lld %016" PRIx64 " %a %a %a\n", values->entries[i].fid,
+                     values->entries[i].hash, values->entries[i].x, values->entries[i].y,
+                     values->entries[i].value) < 0;
+  }
+
+  if (fclose(f) != 0 || failed) {
+    fprintf(stderr, "Failed to write manifest %s\n", path);
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  if (rename(temporaryPath, path) != 0) {
+    perror("rename");
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  free(temporaryPath);
+
+  return 0;
+}
+
+void freeManifest(tableManifest *manifest)
+{
+  free(manifest->rows);
+  manifest->rows = NULL;
+  manifest->size = 0;
+  manifest->capacity = 0;
+}
+
+bool isTableUpToDate(const char *tablePath, const struct tableProvenance *expected)
+{
+  if (!fileExists(tablePath)) {
+    return false;
+  }
+
+  char *manifestPath = manifestPathFromTable(tablePath);
+  if (manifestPath == NULL) {
+    return false;
+  }
+
+  struct tableProvenance stored;
+  bool upToDate = readManifestProvenance(manifestPath, &stored) == 0
+                  && stored.input == expected->input && stored.features == expected->features;
+
+  free(manifestPath);
+
+  return upToDate;
+}
+
+int selectChangedFeatures(const tableManifest *manifest, const vectorGeometryVector *areasOfInterest,
+                          vectorGeometryVector *changed)
+{
+  changed->entries = malloc((areasOfInterest->size > 0 ? areasOfInterest->size : 1) * sizeof(
+                              struct vectorGeometry));
+  if (changed->entries == NULL) {
+    perror("malloc");
+    return 1;
+  }
+
+  changed->capacity = areasOfInterest->size;
+  changed->size = 0;
+  changed->digest = areasOfInterest->digest;
+
+  for (size_t i = 0; i < areasOfInterest->size; i++) {
+    struct m key = {.fid = areasOfInterest->entries[i].id, .hash = areasOfInterest->entries[i].hash};
+
+    if (bsearch(&key, manifest->rows, manifest->size, sizeof(struct m), rowCmp) == NULL) {
+      changed->entries[changed->size] = areasOfInterest->entries[i];
+      changed->size++;
+    }
+  }
+
+  return 0;
+}
+
+int spliceManifestRows(meanVector *values, const tableManifest *manifest,
+                       const vectorGeometryVector *areasOfInterest)
+{
+  struct m *current = malloc((areasOfInterest->size > 0 ? areasOfInterest->size : 1) * sizeof(
+                               struct m));
+  if (current == NULL) {
+    perror("malloc");
+    return 1;
+  }
+
+  for (size_t i = 0; i < areasOfInterest->size; i++) {
+    current[i].fid = areasOfInterest->entries[i].id;
+    current[i].hash = areasOfInterest->entries[i].hash;
+    current[i].order = areasOfInterest->entries[i].order;
+  }
+
+  qsort(current, areasOfInterest->size, sizeof(struct m), rowCmp);
+
+  struct m *entries = realloc(values->entries, (values->size + manifest->size + 1) * sizeof(struct m));
+  if (entries == NULL) {
+    perror("realloc");
+    free(current);
+    return 1;
+  }
+
+  values->entries = entries;
+  values->capcity = values->size + manifest->size + 1;
+
+  for (size_t i = 0; i < manifest->size; i++) {
+    const struct m *match = bsearch(&manifest->rows[i], current, areasOfInterest->size,
+                                    sizeof(struct m), rowCmp);
+
+    if (match != NULL) {
+      values->entries[values->size] = manifest->rows[i];
+      // manifests don't record the layer order, it's taken from the current feature
+      values->entries[values->size].order = match->order;
+      values->size++;
+    }
+  }
+
+  free(current);
+
+  // recomputed rows are in layer order already, reused ones are merged into it
+  qsort(values->entries, values->size, sizeof(struct m), rowOrderCmp);
+
+  return 0;
+}
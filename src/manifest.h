@@ -0,0 +1,173 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+/**
+ * @file manifest.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for manifests of output tables, which allow
+ *        incremental reprocessing.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup manifest Table Manifests
+ * @{
+ */
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <gdal/ogr_api.h>
+
+/// Initial number of rows allocated when reading a manifest
+#define MANIFEST_INITIAL_CAPACITY 256
+
+/**
+ * @brief Construct the path of the manifest belonging to an output table
+ *
+ * @note The caller must free the returned string.
+ *
+ * @param tablePath Path to output table, i.e. `WVP_YYYY-MM-DD.txt`.
+ * @return char* Path to manifest, i.e. `WVP_YYYY-MM-DD.manifest`, NULL on error.
+ */
+char *manifestPathFromTable(const char *tablePath);
+
+/**
+ * @brief Hash a feature of the area of interest
+ *
+ * @details The hash covers the FID and the coordinates and structure of the (possibly reprojected)
+ *          compact polygon. Precomputed centroids end up in the output table as well, thus they're
+ *          included if used.
+ *
+ * @param feature Feature whose `hash` field is set.
+ * @param usePrecomputedCentroid Whether precomputed centroids are used.
+ * @return int 0 on success, 1 on error.
+ */
+int hashFeature(struct vectorGeometry *feature, bool usePrecomputedCentroid);
+
+/**
+ * @brief Compute the digest of an area of interest
+ *
+ * @details Like the key of an AOI cache, the digest covers the source file's path, size and
+ *          modification time, the layer and options changing geometries, but not the spatial
+ *          filter. Thus, it doesn't change with the rasters processed, while editing the AOI file
+ *          does change it. Changes of single features are detected by their hashes.
+ *
+ * @param filePath Path to AOI dataset.
+ * @param layerName Name of layer to read, possibly NULL.
+ * @param usePrecomputedCentroid Whether precomputed centroids are read.
+ * @param simplifyTolerance Tolerance features are simplified with, 0 if they're not simplified.
+ * @param timeField Field acquisition times are read from, possibly NULL.
+ * @param digest Set to the resulting digest.
+ * @return int 0 on success, 1 on error.
+ */
+int digestAreaOfInterest(const char *filePath, const char *layerName, bool usePrecomputedCentroid,
+                         double simplifyTolerance, const char *timeField, uint64_t *digest);
+
+/**
+ * @brief Hash the inputs of a single output table except the area of interest
+ *
+ * @details The dataset is identified by its path, size and modification time instead of its
+ *          content, which would require reading the entire file. Options changing output values
+ *          are included as well.
+ *
+ * @param datasetPath Path to dataset.
+ * @param temporal Temporal information back-filled from the dataset.
+ * @param day Day of month of the output table.
+ * @param options Reference to parsed options struct.
+ * @param hash Set to the resulting hash.
+ * @return int 0 on success, 1 on error.
+ */
+int hashInput(const char *datasetPath, const option_t *temporal, int day, const option_t *options,
+              uint64_t *hash);
+
+/**
+ * @brief Callback function for `qsort` and `bsearch` to order rows by FID and feature hash
+ *
+ * @param a Void-casted reference to first row of comparison.
+ * @param b Void-casted reference to second row of comparison.
+ * @return int Negative value if a < b, 0 if a = b, positive value if a > b.
+ */
+int rowCmp(const void *a, const void *b);
+
+/**
+ * @brief Read the header of a manifest
+ *
+ * @param path Path to manifest.
+ * @param provenance Set to the hashes stored in the manifest.
+ * @return int 0 on success, 1 if the manifest is missing or invalid.
+ */
+int readManifestProvenance(const char *path, struct tableProvenance *provenance);
+
+/**
+ * @brief Read a manifest
+ *
+ * @note On success, rows are sorted with rowCmp() and the caller must free the manifest with freeManifest().
+ *
+ * @param path Path to manifest.
+ * @param manifest Reference to object which is filled by this function.
+ * @return int 0 on success, 1 if the manifest is missing or invalid.
+ */
+int readManifest(const char *path, tableManifest *manifest);
+
+/**
+ * @brief Write the manifest of an output table
+ *
+ * @details Values are stored as hexadecimal floating point numbers, thus they're restored exactly.
+ *          The manifest is written to a temporary file first and moved into place afterwards.
+ *
+ * @param path Path to manifest.
+ * @param values Rows of the output table together with their provenance.
+ * @return int 0 on success, 1 on error.
+ */
+int writeManifest(const char *path, const meanVector *values);
+
+/**
+ * @brief Free rows of a manifest
+ *
+ * @param manifest Manifest to free.
+ */
+void freeManifest(tableManifest *manifest);
+
+/**
+ * @brief Check if an output table is up to date
+ *
+ * @param tablePath Path to output table.
+ * @param expected Hashes of the current inputs.
+ * @return true If both table and manifest exist and the manifest matches the current inputs.
+ * @return false Otherwise.
+ */
+bool isTableUpToDate(const char *tablePath, const struct tableProvenance *expected);
+
+/**
+ * @brief Collect features which have no row in a manifest
+ *
+ * @details Features were either added or changed since the manifest was written.
+ *
+ * @note `changed` holds shallow copies of features, i.e. only `changed->entries` must be freed by the caller.
+ *
+ * @param manifest Manifest as returned by readManifest().
+ * @param areasOfInterest Vector of hashed features.
+ * @param changed Reference to vector which is filled by this function.
+ * @return int 0 on success, 1 on error.
+ */
+int selectChangedFeatures(const tableManifest *manifest, const vectorGeometryVector *areasOfInterest,
+                          vectorGeometryVector *changed);
+
+/**
+ * @brief Add rows of a manifest whose features are still part of the area of interest
+ *
+ * @details Rows of removed or changed features are dropped. Added rows take the layer order of
+ *          their current feature, afterwards all rows are in layer order, as in a full run.
+ *
+ * @param values Rows computed for changed features, extended in place.
+ * @param manifest Manifest as returned by readManifest().
+ * @param areasOfInterest Vector of hashed features.
+ * @return int 0 on success, 1 on error.
+ */
+int spliceManifestRows(meanVector *values, const tableManifest *manifest,
+                       const vectorGeometryVector *areasOfInterest);
+
+/** @} */ // end of group
+#endif // MANIFEST_H
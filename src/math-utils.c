@@ -1,6 +1,9 @@
 #include "math-utils.h"
+#include "types.h"
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 double kgsqmTocow(double x)
@@ -32,3 +35,137 @@ int intcmp(const void *a, const void *b)
 
   return aInt - bInt;
 }
+
+int uint64cmp(const void *a, const void *b)
+{
+  uint64_t first = *(const uint64_t *) a;
+  uint64_t second = *(const uint64_t *) b;
+
+  return (first > second) - (first < second);
+}
+
+void compensatedAdd(double *sum, double *compensation, double value)
+{
+  double t = *sum + value;
+
+  if (fabs(*sum) >= fabs(value)) {
+    *compensation += (*sum - t) + value;
+  } else {
+    *compensation += (value - t) + *sum;
+  }
+
+  *sum = t;
+}
+
+int contributionCmp(const void *a, const void *b)
+{
+  size_t aCell = ((const struct contribution *) a)->cell;
+  size_t bCell = ((const struct contribution *) b)->cell;
+
+  return (aCell > bCell) - (aCell < bCell);
+}
+
+double calculateOrderedWeightedAverage(const double *values, const double *weights,
+                                       const size_t *cells, size_t count)
+{
+  if (values == NULL || weights == NULL || cells == NULL) {
+    return NAN;
+  }
+
+  struct contribution *contributions = calloc(count == 0 ? 1 : count, sizeof(struct contribution));
+  if (contributions == NULL) {
+    perror("calloc");
+    return NAN;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    contributions[i].cell = cells[i];
+    contributions[i].value = values[i];
+    contributions[i].weight = weights[i];
+  }
+
+  qsort(contributions, count, sizeof(struct contribution), contributionCmp);
+
+  double numerator = 0.0;
+  double numeratorCompensation = 0.0;
+  double denominator = 0.0;
+  double denominatorCompensation = 0.0;
+
+  for (size_t i = 0; i < count; i++) {
+    compensatedAdd(&numerator, &numeratorCompensation,
+                   contributions[i].value * contributions[i].weight);
+    compensatedAdd(&denominator, &denominatorCompensation, contributions[i].weight);
+  }
+
+  free(contributions);
+
+  return (numerator + numeratorCompensation) / (denominator + denominatorCompensation);
+}
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t seed)
+{
+  const unsigned char *bytes = (const unsigned char *) data;
+  uint64_t hash = seed;
+
+  for (size_t i = 0; i < size; i++) {
+    hash ^= (uint64_t) bytes[i];
+    hash *= FNV1A_PRIME;
+  }
+
+  return hash;
+}
+
+uint64_t hilbertIndex(uint32_t x, uint32_t y)
+{
+  const uint32_t n = (uint32_t) 1 << HILBERT_ORDER;
+  uint64_t index = 0;
+
+  for (uint32_t s = n / 2; s > 0; s /= 2) {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+
+    index += (uint64_t) s * s * ((3 * rx) ^ ry);
+
+    // rotate quadrant such that the curve of the next level starts and ends where it should
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+
+      uint32_t t = x;
+      x = y;
+      y = t;
+    }
+  }
+
+  return index;
+}
+
+int curveKeyCmp(const void *a, const void *b)
+{
+  const struct curveKey *first = (const struct curveKey *) a;
+  const struct curveKey *second = (const struct curveKey *) b;
+
+  if (first->key != second->key) {
+    return first->key < second->key ? -1 : 1;
+  }
+
+  if (first->index != second->index) {
+    return first->index < second->index ? -1 : 1;
+  }
+
+  return 0;
+}
+
+int curveKeySearchCmp(const void *a, const void *b)
+{
+  const struct curveKey *first = (const struct curveKey *) a;
+  const struct curveKey *second = (const struct curveKey *) b;
+
+  if (first->key != second->key) {
+    return first->key < second->key ? -1 : 1;
+  }
+
+  return 0;
+}
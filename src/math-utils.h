@@ -13,8 +13,18 @@
  * @{
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 
+/// Initial value of FNV-1a hashes
+#define FNV1A_OFFSET_BASIS 0xcbf29ce484222325ULL
+
+/// Prime of 64-bit FNV-1a hashes
+#define FNV1A_PRIME 0x100000001b3ULL
+
+/// Number of bits per axis of the grid Hilbert indices are computed on
+#define HILBERT_ORDER 16
+
 /**
  * @brief Compute water column height
  *
@@ -43,6 +53,43 @@ double kgsqmTocow(double x);
  */
 double calculateWeightedAverage(const double *values, const double *weights, size_t count);
 
+/**
+ * @brief Add a value to a running sum using Neumaier's compensated summation
+ *
+ * @details The rounding error of each addition is accumulated in `compensation`, the final
+ *          result is `*sum + *compensation`. Both must be initialized to 0.
+ *
+ * @param sum Reference to running sum.
+ * @param compensation Reference to running compensation term.
+ * @param value Value to add.
+ */
+void compensatedAdd(double *sum, double *compensation, double value);
+
+/**
+ * @brief Compute the weighted average with a reduction order independent of input order
+ *
+ * @details Contributions are sorted by the index of the raster cell they originate from before being
+ *          summed with compensated summation. Thus, the result only depends on the set of contributions
+ *          and not on the order in which spatial queries or threads returned them.
+ *
+ * @param values Values to average.
+ * @param weights Weights associated with values.
+ * @param cells Raster cell indices associated with values, used as sort key.
+ * @param count Size of arrays.
+ * @return double Weighted arithmetic mean, NAN on error.
+ */
+double calculateOrderedWeightedAverage(const double *values, const double *weights,
+                                       const size_t *cells, size_t count);
+
+/**
+ * @brief Callback function for `qsort` to compare contributions by raster cell index
+ *
+ * @param a Void-casted reference to first contribution.
+ * @param b Void-casted reference to second contribution.
+ * @return int Negative value if a < b, 0 if a = b, positive value if a > b.
+ */
+int contributionCmp(const void *a, const void *b);
+
 /**
  * @brief Callback function for `qsort` to compare integers
  *
@@ -52,5 +99,60 @@ double calculateWeightedAverage(const double *values, const double *weights, siz
  */
 int intcmp(const void *a, const void *b);
 
+/**
+ * @brief Callback function for `qsort` and `bsearch` to compare unsigned 64-bit integers
+ *
+ * @param a Void-casted reference to first value of comparison.
+ * @param b Void-casted reference to second value of comparison.
+ * @return int Negative value if a < b, 0 if a = b, positive value if a > b.
+ */
+int uint64cmp(const void *a, const void *b);
+
+/**
+ * @brief Compute 64-bit FNV-1a hash of a byte sequence
+ *
+ * @details The hash can be computed incrementally by passing the result of a previous call as `seed`.
+ *          Use FNV1A_OFFSET_BASIS as seed for the first call.
+ *
+ * @param data Bytes to hash.
+ * @param size Number of bytes.
+ * @param seed Hash of preceding bytes or FNV1A_OFFSET_BASIS.
+ * @return uint64_t Hash value.
+ */
+uint64_t fnv1a(const void *data, size_t size, uint64_t seed);
+
+/**
+ * @brief Compute the distance of a grid cell along a Hilbert curve
+ *
+ * @details The curve covers a square grid of 2^HILBERT_ORDER cells per axis. Cells close to each
+ *          other on the curve are close to each other on the grid as well.
+ *
+ * @param x Column of cell, must be smaller than 2^HILBERT_ORDER.
+ * @param y Row of cell, must be smaller than 2^HILBERT_ORDER.
+ * @return uint64_t Distance along the curve.
+ */
+uint64_t hilbertIndex(uint32_t x, uint32_t y);
+
+/**
+ * @brief Callback function for `qsort` to order curve keys by key and index
+ *
+ * @param a Void-casted reference to first curve key.
+ * @param b Void-casted reference to second curve key.
+ * @return int Negative value if a < b, 0 if a = b, positive value if a > b.
+ */
+int curveKeyCmp(const void *a, const void *b);
+
+/**
+ * @brief Callback function for `bsearch` to find curve keys by key alone
+ *
+ * @details Arrays sorted with curveKeyCmp() are ordered by key as well, the index of the searched
+ *          key is ignored.
+ *
+ * @param a Void-casted reference to first curve key.
+ * @param b Void-casted reference to second curve key.
+ * @return int Negative value if a < b, 0 if a = b, positive value if a > b.
+ */
+int curveKeySearchCmp(const void *a, const void *b);
+
 /** @} */ // end of group
 #endif // MATH_UTILS_H
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "numeric-conversions.h"
 #include <errno.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <limits.h>
@@ -130,3 +131,30 @@ short convertPostiveShortSafely(const char *timeString, bool *error)
 
   return (short) temporaryResult;
 }
+
+double convertDoubleSafely(const char *numberString, bool *error)
+{
+  *error = false;
+  char *endptr;
+  errno = 0;
+  double result = strtod(numberString, &endptr);
+
+  if (errno == ERANGE || endptr == numberString || *endptr != '\0' || !isfinite(result)) {
+    *error = true;
+    return 0.0;
+  }
+
+  return result;
+}
+
+double convertNonNegativeDoubleSafely(const char *numberString, bool *error)
+{
+  double result = convertDoubleSafely(numberString, error);
+
+  if (*error || result < 0.0) {
+    *error = true;
+    return 0.0;
+  }
+
+  return result;
+}
@@ -119,5 +119,29 @@ int convertPositiveIntegerSafely(const char *timeString, bool *error);
  */
 short convertPostiveShortSafely(const char *timeString, bool *error);
 
+
+/**
+ * @brief Parse string to finite double
+ *
+ * @note This function is a thin wrapper around `strtod`. Contrary to the integer conversions,
+ *       trailing characters are treated as an error.
+ *
+ * @param numberString String representation of number.
+ * @param error Reference to error flag. Is set to `true` on error, `false` otherwise.
+ * @return double Parsed number.
+ */
+double convertDoubleSafely(const char *numberString, bool *error);
+
+/**
+ * @brief Parse string to finite, non-negative double
+ *
+ * @note See convertDoubleSafely(), negative numbers are treated as an error as well.
+ *
+ * @param numberString String representation of number.
+ * @param error Reference to error flag. Is set to `true` on error, `false` otherwise.
+ * @return double Parsed number.
+ */
+double convertNonNegativeDoubleSafely(const char *numberString, bool *error);
+
 /** @} */ // end of group
 #endif // NUMERIC_CONVERSIONS_H
\ No newline at end of file
@@ -9,6 +9,13 @@
 #include "fscheck.h"
 #include "types.h"
 #include "math-utils.h"
+#include "workers.h"
+#include "claims.h"
+#include "strtree.h"
+#include "date-check.h"
+#include "haze.h"
+#include "variables.h"
+#include "intersection-export.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,6 +24,7 @@
 #include <time.h>
 #include <getopt.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <errno.h>
 #include <limits.h>
 #include <libgen.h>
@@ -25,10 +33,12 @@ void printHelp(void)
 {
   printf("haze - Integrate reprocessed ERA5 single level data into FORCE for atmospheric correction\n\n");
   printf("Usage: haze <subprogram> <options>\n");
-  printf("\tWhere <subprogram> is either 'download' to download data from CDS or 'process' to process downloaded files\n");
+  printf("\tWhere <subprogram> is either 'download' to download data from CDS, 'process' to process downloaded files, 'export' to write text tables or time series from an output store or 'query' to print the time series of a feature\n");
   printf("\tWhere <options> depends on the subprogram used:\n");
-  printf("\tSignature of 'download' subprogram: [-h|--help] [-g|--global] [-d|--daily] [-l|--layer] --year --month --day --hour [aoi] logfile outdir\n");
-  printf("\tSignature of 'process' subprogram:  [-h|--help] [--wrap-on-edge] [--use-precomputed-centroid] [-l|--layer] aoi logfile outdir\n");
+  printf("\tSignature of 'download' subprogram: [-h|--help] [-g|--global] [-d|--daily] [-l|--layer] [--variables] --year --month --day --hour [aoi] logfile outdir\n");
+  printf("\tSignature of 'process' subprogram:  [-h|--help] [--wrap-on-edge] [--use-precomputed-centroid] [--pipeline] [--jobs] [--shard-claim] [--claim-expiry] [--no-deterministic] [--memory-budget] [--incremental] [--aoi-cache] [--threads] [--simplify-tolerance] [--no-spatial-filter] [--store] [--aggregations] [--climatology] [--acquisition-time-field] [--variables] [--additional-aoi] [--export-intersections] [-l|--layer] aoi logfile outdir\n");
+  printf("\tSignature of 'export' subprogram:   [-h|--help] [--series] store outdir\n");
+  printf("\tSignature of 'query' subprogram:    [-h|--help] --fid|--lon --lat [--from] [--to] outdir\n");
   printf("\nGlobal optional flags:\n");
   printf("\t-h|--help:  Print help and exit.\n");
   printf("\nOptional flags valid for download subprogram:\n");
@@ -37,8 +47,35 @@ void printHelp(void)
   printf("\nOptional flags valid for processing subprogram:\n");
   printf("\t--wrap-on-edge: If specified, multipolygons are considered footprint geometries and those cut at the dateline are merged to a polygon to compute centroid.\n");
   printf("\t--use-precomputed-centroid: If specified, read fields 'longitude' and 'latitude' which must be of type double from the input layer and use those for centroid coordinates in the output file instead of dynamically computed ones. Note that intersection is still performed on possibly transformed geometries. Setting this options together with '--wrap-on-edge' is not useful.\n");
+  printf("\t--pipeline: If specified, reading the next dataset, computing the current one and writing output tables are overlapped in separate threads. Output is identical to sequential processing, at most two datasets are held in memory.\n");
+  printf("\t--shard-claim: If specified, datasets are claimed via claim files in the directory '<logfile>.claims' before processing. This allows any number of haze instances, possibly on different nodes sharing a file system, to work through the same log file. Cannot be combined with '--jobs'.\n");
+  printf("\t--no-deterministic: If specified, averages are summed in the order intersections are found instead of a fixed order with compensated summation. This is slightly faster, but output may differ in the last digits between runs with different parallelism. Cannot be combined with '--jobs', '--pipeline' or '--shard-claim'.\n");
+  printf("\t--incremental: If specified, already processed datasets are considered as well. Output tables whose dataset and AOI features did not change since they were written are skipped, otherwise only rows of added or changed features are computed and spliced into the existing table. This relies on manifests written next to the tables by incremental runs only, thus the first incremental run computes all tables. Cannot be combined with '--shard-claim'.\n");
+  printf("\t--no-spatial-filter: If specified, all AOI features are read. By default, only features intersecting the combined extent of all rasters to process are read, which requires opening every raster first. The filter is always disabled together with '--store' or '--climatology', which hold every feature of the AOI across runs.\n");
+  printf("\t--store: If specified, output of each year is written to a single store 'WVP_YYYY.hzs' in the output directory instead of one text table per day. The store holds the features table (FID, longitude, latitude) once and a day x feature matrix of values, text tables are written from it with the 'export' subprogram. Features without a value on a day are left out of exported tables. Cannot be combined with '--incremental'.\n");
+  printf("\t--climatology: If specified, per-feature sums, sums of squares and counts of daily means are accumulated per day of year in 'WVP_CLIMATOLOGY.hzc' in the output directory while datasets are processed. Each day is added at most once, thus the accumulator is shared by workers, instances and subsequent runs. Once processing finished, climatology tables 'WVP_0000-MM-DD.txt' holding longitude, latitude, mean, standard deviation and number of days are written from it. Days skipped because their tables were completed before are not added. Cannot be combined with '--incremental'.\n");
+  printf("\nOptional flags valid for export subprogram:\n");
+  printf("\t--series: If specified, the feature-major series store 'WVP_YYYY.hzt' is written to the output directory instead of text tables. Each feature's time series is stored contiguously and indexed by FID, it's read with the 'query' subprogram.\n");
   printf("\nGlobal optional keyword arguments:\n");
   printf("\t-l|--layer: Layer to open from AOI dataset.\n");
+  printf("\t--variables: Comma-separated list of ERA5 single level variables, any of 'total_column_water_vapour', 'surface_pressure' and 'total_column_ozone'. Defaults to 'total_column_water_vapour', which must always be part of the list. When downloading, all variables are requested in the same product. When processing, intersections are computed once for water vapor and their area weights are applied to the bands of each other variable; daily means are written to 'SP_YYYY-MM-DD.txt' and 'TCO3_YYYY-MM-DD.txt' in ERA5 units. Bands are selected by their GRIB element, thus bands of variables downloaded but not passed to 'process' are ignored, while missing ones are an error. Further variables cannot be combined with '--incremental' or '--store'.\n");
+  printf("\nOptional keyword arguments valid for processing subprogram:\n");
+  printf("\t--jobs: Number of worker processes, defaults to 1. The AOI is read once and shared with all workers, datasets are handed out to idle workers one at a time.\n");
+  printf("\t--memory-budget: Upper bound of memory used by all workers when using '--jobs', e.g. 16G. Supported suffixes are K, M and G (powers of 1024). The footprint of each dataset is estimated from its dimensions and the AOI size; datasets are only handed out to workers while the sum of estimates fits into the budget.\n");
+  printf("\t--threads: Number of threads reprojecting and converting AOI features, defaults to 1. Features are still read by a single thread.\n");
+  printf("\t--simplify-tolerance: Fraction of the raster pixel size AOI features are simplified with, e.g. 0.05. Vertices are removed with a topology-preserving simplification and snapped to a grid of the same size afterwards. Features which would collapse are kept as they are. The largest resulting change of area weights is reported. The smallest pixel size of all rasters to process is used; if none of them can be opened, features are not simplified and a warning is printed. Defaults to 0, i.e. features are not simplified.\n");
+  printf("\t--aggregations: Comma-separated list of temporal aggregations to write, any of 'hourly', 'daily-mean', 'daily-min' and 'daily-max'. Defaults to 'daily-mean', which is written to 'WVP_YYYY-MM-DD.txt' as expected by FORCE. Other aggregations are written to 'WVP_YYYY-MM-DDTHH.txt', 'WVP_YYYY-MM-DD_MIN.txt' and 'WVP_YYYY-MM-DD_MAX.txt'. Daily extremes are taken over the hourly area-weighted means. Bands are read and intersected once for all aggregations. Aggregations other than 'daily-mean' cannot be combined with '--incremental' or '--store'.\n");
+  printf("\t--aoi-cache: Path to a binary cache of reprojected AOI geometries. If the cache matches the AOI file (path, size, modification time), layer and options, geometries are read from it instead of the AOI file, otherwise the cache is rewritten.\n");
+  printf("\t--acquisition-time-field: Name of a date-time or time field of the AOI layer holding the acquisition time of each feature, e.g. of scene footprints. Instead of the daily mean, these features are assigned the area-weighted means of the two hourly bands bracketing their acquisition time in UTC, interpolated linearly. Times before the first or after the last hour of a day take that hour's value. Features whose field is NULL keep the daily mean. The climatology accumulates daily means regardless.\n");
+  printf("\t--additional-aoi: Further AOI given as 'name=path[@layer]', may be repeated. The last '@' only separates the layer if the entire path isn't a readable file. Each dataset is read and averaged once, its daily grid is intersected with the main AOI and every additional one. Tables of an additional AOI are written to the subdirectory 'name' of the output directory, which is created if needed, with the same options as the main AOI. Acquisition times are only read for the main AOI, caches of additional AOIs are written next to '--aoi-cache' with '.name' appended. A day is completed once the tables of all AOIs were written. Cannot be combined with '--incremental'.\n");
+  printf("\t--export-intersections: Path of a vector dataset every intersection of an AOI feature and a raster cell is written to, together with the feature's FID, cell index, cell value, area weight, day and AOI. The format is chosen by the extension, '.fgb' (FlatGeobuf) or '.gpkg' (GeoPackage). Features are written by a background thread, GeoPackages in large transactions. The file must not exist. With '--jobs' or '--shard-claim', each process writes its own file with host name and process ID inserted before the extension.\n");
+  printf("\t--claim-expiry: Number of seconds after which claims of crashed instances are taken over when using '--shard-claim', defaults to %d.\n", DEFAULT_CLAIM_EXPIRY);
+  printf("\nKeyword arguments valid for query subprogram:\n");
+  printf("\t--fid:  FID of the feature to query.\n");
+  printf("\t--lon:  Longitude of a location, the feature whose centroid is closest is queried. Requires '--lat'.\n");
+  printf("\t--lat:  Latitude of a location, requires '--lon'.\n");
+  printf("\t--from: First day of the time series as YYYY-MM-DD, defaults to 1940-01-01.\n");
+  printf("\t--to:   Last day of the time series as YYYY-MM-DD, defaults to 2039-12-31.\n");
   printf("\nMandatory keyword arguments valid for download subprogram (either scalar vlaue, start:stop or comma seperated list. In the first case, endpoints are inclusive.):\n");
   printf("\t--year:  Years for which data should be downloaded.\n");
   printf("\t--month: Months for which data should be downloaded.\n");
@@ -73,8 +110,39 @@ void printHelp(void)
   userOptions->authenticationToken = NULL;
   userOptions->download = false;
   userOptions->process = false;
+  userOptions->exportStore = false;
   userOptions->footprint = false;
   userOptions->usePrecomputedCentroid = false;
+  userOptions->pipeline = false;
+  userOptions->jobs = 1;
+  userOptions->shardClaim = false;
+  userOptions->claimExpiry = DEFAULT_CLAIM_EXPIRY;
+  userOptions->deterministic = true;
+  userOptions->memoryBudget = 0;
+  userOptions->incremental = false;
+  userOptions->aoiCache = NULL;
+  userOptions->threads = 1;
+  userOptions->simplifyTolerance = 0.0;
+  userOptions->spatialFilter = true;
+  userOptions->store = false;
+  userOptions->storePath = NULL;
+  userOptions->exportSeries = false;
+  userOptions->query = false;
+  userOptions->queryByFid = false;
+  userOptions->queryFid = 0;
+  userOptions->queryByLocation = false;
+  userOptions->queryLongitude = 0.0;
+  userOptions->queryLatitude = 0.0;
+  userOptions->queryFrom = 19400101;
+  userOptions->queryTo = 20391231;
+  userOptions->aggregations = AGGREGATION_DAILY_MEAN;
+  userOptions->climatology = false;
+  userOptions->acquisitionTimeField = NULL;
+  userOptions->variables = VARIABLE_TOTAL_COLUMN_WATER_VAPOUR;
+  userOptions->aoiSets = NULL;
+  userOptions->aoiSetCount = 0;
+  userOptions->intersectionExportPath = NULL;
+  userOptions->intersectionExport = NULL;
 
   static struct option long_options[] = {
     {"help", no_argument, NULL, 'h'},
@@ -87,10 +155,40 @@ void printHelp(void)
     {"daily", no_argument, NULL, 'd'},
     {"wrap-on-edge", no_argument, NULL, 'f'},
     {"use-precomputed-centroid", no_argument, NULL, 67},
+    {"pipeline", no_argument, NULL, 70},
+    {"jobs", required_argument, NULL, 71},
+    {"shard-claim", no_argument, NULL, 72},
+    {"claim-expiry", required_argument, NULL, 73},
+    {"no-deterministic", no_argument, NULL, 74},
+    {"memory-budget", required_argument, NULL, 75},
+    {"incremental", no_argument, NULL, 76},
+    {"aoi-cache", required_argument, NULL, 77},
+    {"threads", required_argument, NULL, 78},
+    {"simplify-tolerance", required_argument, NULL, 79},
+    {"store", no_argument, NULL, 80},
+    {"series", no_argument, NULL, 81},
+    {"fid", required_argument, NULL, 82},
+    {"lon", required_argument, NULL, 83},
+    {"lat", required_argument, NULL, 84},
+    {"from", required_argument, NULL, 85},
+    {"to", required_argument, NULL, 86},
+    {"aggregations", required_argument, NULL, 87},
+    {"climatology", no_argument, NULL, 88},
+    {"acquisition-time-field", required_argument, NULL, 89},
+    {"variables", required_argument, NULL, 90},
+    {"additional-aoi", required_argument, NULL, 91},
+    {"export-intersections", required_argument, NULL, 92},
+    {"no-spatial-filter", no_argument, NULL, 93},
     {0, 0, 0, 0}
   };
 
   int opt;
+  bool conversionError = false;
+  bool longitudeGiven = false;
+  bool latitudeGiven = false;
+  int year = 0;
+  int month = 0;
+  int day = 0;
 
   while ((opt = getopt_long(argc, argv, "hl:gd", long_options, NULL)) != -1) {
     switch (opt) {
@@ -140,6 +238,150 @@ void printHelp(void)
       case 67:
         userOptions->usePrecomputedCentroid = true;
         break;
+      case 70:
+        userOptions->pipeline = true;
+        break;
+      case 71:
+        userOptions->jobs = convertPositiveIntegerSafely(optarg, &conversionError);
+        if (conversionError || userOptions->jobs < 1 || userOptions->jobs > MAX_JOBS) {
+          fprintf(stderr, "Failed to parse number of jobs or value not in range [1, %d]\n\n", MAX_JOBS);
+          freeOption(userOptions);
+          return NULL;
+        }
+        break;
+      case 72:
+        userOptions->shardClaim = true;
+        break;
+      case 73:
+        userOptions->claimExpiry = convertPositiveIntegerSafely(optarg, &conversionError);
+        if (conversionError || userOptions->claimExpiry < 1) {
+          fprintf(stderr, "Failed to parse claim expiry or value not positive\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        break;
+      case 74:
+        userOptions->deterministic = false;
+        break;
+      case 75:
+        if (parseMemorySize(optarg, &userOptions->memoryBudget)) {
+          fprintf(stderr, "Failed to parse memory budget\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        break;
+      case 76:
+        userOptions->incremental = true;
+        break;
+      case 77:
+        userOptions->aoiCache = optarg;
+        break;
+      case 78:
+        userOptions->threads = convertPositiveIntegerSafely(optarg, &conversionError);
+        if (conversionError || userOptions->threads < 1 || userOptions->threads > MAX_INGEST_THREADS) {
+          fprintf(stderr, "Failed to parse number of threads or value not in range [1, %d]\n\n",
+                  MAX_INGEST_THREADS);
+          freeOption(userOptions);
+          return NULL;
+        }
+        break;
+      case 79:
+        userOptions->simplifyTolerance = convertNonNegativeDoubleSafely(optarg, &conversionError);
+        if (conversionError || userOptions->simplifyTolerance > 1.0) {
+          fprintf(stderr, "Failed to parse simplification tolerance or value not in range [0, 1]\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        break;
+      case 80:
+        userOptions->store = true;
+        break;
+      case 81:
+        userOptions->exportSeries = true;
+        break;
+      case 82:
+        userOptions->queryFid = (GIntBig) convertNumberSafely(optarg, &conversionError);
+        if (conversionError) {
+          fprintf(stderr, "Failed to parse FID\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        userOptions->queryByFid = true;
+        break;
+      case 83:
+        userOptions->queryLongitude = convertDoubleSafely(optarg, &conversionError);
+        if (conversionError) {
+          fprintf(stderr, "Failed to parse longitude\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        longitudeGiven = true;
+        break;
+      case 84:
+        userOptions->queryLatitude = convertDoubleSafely(optarg, &conversionError);
+        if (conversionError || userOptions->queryLatitude < -90.0 || userOptions->queryLatitude > 90.0) {
+          fprintf(stderr, "Failed to parse latitude or value not in range [-90, 90]\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        latitudeGiven = true;
+        break;
+      case 85:
+        if (parseDate(optarg, &year, &month, &day)) {
+          fprintf(stderr, "Failed to parse first day of query, expected YYYY-MM-DD\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        userOptions->queryFrom = year * 10000 + month * 100 + day;
+        break;
+      case 86:
+        if (parseDate(optarg, &year, &month, &day)) {
+          fprintf(stderr, "Failed to parse last day of query, expected YYYY-MM-DD\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        userOptions->queryTo = year * 10000 + month * 100 + day;
+        break;
+      case 87:
+        if (parseAggregations(optarg, &userOptions->aggregations)) {
+          fprintf(stderr, "Failed to parse aggregations, expected a comma-separated list of 'hourly', 'daily-mean', 'daily-min' and 'daily-max'\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        break;
+      case 88:
+        userOptions->climatology = true;
+        break;
+      case 89:
+        userOptions->acquisitionTimeField = optarg;
+        break;
+      case 90:
+        if (parseVariables(optarg, &userOptions->variables)) {
+          fprintf(stderr, "Failed to parse variables, expected a comma-separated list of 'total_column_water_vapour', 'surface_pressure' and 'total_column_ozone' including the first\n\n");
+          freeOption(userOptions);
+          return NULL;
+        }
+        break;
+      case 91:
+        if (appendAoiSet(optarg, userOptions)) {
+          fprintf(stderr, "Failed to parse additional AOI '%s', expected 'name=path[@layer]' with a unique name\n\n",
+                  optarg);
+          freeOption(userOptions);
+          return NULL;
+        }
+        break;
+      case 92:
+        if (intersectionExportDriver(optarg) == NULL) {
+          fprintf(stderr, "Unsupported format of intersection export '%s', expected '.fgb' or '.gpkg'\n\n",
+                  optarg);
+          freeOption(userOptions);
+          return NULL;
+        }
+        userOptions->intersectionExportPath = optarg;
+        break;
+      case 93:
+        userOptions->spatialFilter = false;
+        break;
       case '?':
         [[fallthrough]];
       default:
@@ -148,6 +390,76 @@ void printHelp(void)
     }
   }
 
+  if (userOptions->shardClaim && userOptions->jobs > 1) {
+    fprintf(stderr, "Options '--shard-claim' and '--jobs' are mutually exclusive, start multiple instances instead\n\n");
+    freeOption(userOptions);
+    return NULL;
+  }
+
+  // claims of datasets processed in earlier runs are already turned into "done" markers
+  if (userOptions->incremental && userOptions->shardClaim) {
+    fprintf(stderr, "Options '--incremental' and '--shard-claim' are mutually exclusive\n\n");
+    freeOption(userOptions);
+    return NULL;
+  }
+
+  // stores keep no manifests, thus rows can't be reused
+  if (userOptions->incremental && userOptions->store) {
+    fprintf(stderr, "Options '--incremental' and '--store' are mutually exclusive\n\n");
+    freeOption(userOptions);
+    return NULL;
+  }
+
+  // manifests and stores only hold daily means
+  if (userOptions->aggregations != AGGREGATION_DAILY_MEAN && (userOptions->incremental
+      || userOptions->store)) {
+    fprintf(stderr, "Option '--aggregations' only supports 'daily-mean' together with '--incremental' or '--store'\n\n");
+    freeOption(userOptions);
+    return NULL;
+  }
+
+  // tables of changed datasets are recomputed, but their earlier values can't be taken out again
+  if (userOptions->incremental && userOptions->climatology) {
+    fprintf(stderr, "Options '--incremental' and '--climatology' are mutually exclusive\n\n");
+    freeOption(userOptions);
+    return NULL;
+  }
+
+  // manifests and stores only hold water vapor
+  if (userOptions->variables != VARIABLE_TOTAL_COLUMN_WATER_VAPOUR && (userOptions->incremental
+      || userOptions->store)) {
+    fprintf(stderr, "Option '--variables' only supports 'total_column_water_vapour' together with '--incremental' or '--store'\n\n");
+    freeOption(userOptions);
+    return NULL;
+  }
+
+  // manifests are written per AOI, but pending bands are selected for the main AOI only
+  if (userOptions->incremental && userOptions->aoiSetCount > 0) {
+    fprintf(stderr, "Options '--incremental' and '--additional-aoi' are mutually exclusive\n\n");
+    freeOption(userOptions);
+    return NULL;
+  }
+
+  if (userOptions->memoryBudget != 0 && userOptions->jobs == 1) {
+    fprintf(stderr, "Warning: '--memory-budget' has no effect without '--jobs'\n");
+  }
+
+  // a faster configuration must never change output files
+  if (!userOptions->deterministic && (userOptions->jobs > 1 || userOptions->pipeline
+                                      || userOptions->shardClaim)) {
+    fprintf(stderr, "Option '--no-deterministic' cannot be combined with parallel processing\n\n");
+    freeOption(userOptions);
+    return NULL;
+  }
+
+  if (longitudeGiven != latitudeGiven) {
+    fprintf(stderr, "Options '--lon' and '--lat' must be given together\n\n");
+    freeOption(userOptions);
+    return NULL;
+  }
+
+  userOptions->queryByLocation = longitudeGiven && latitudeGiven;
+
   int positionalArguments = argc - optind;
 
   if (positionalArguments == 0 || positionalArguments > 4) {
@@ -158,8 +470,11 @@ void printHelp(void)
 
   userOptions->download = strcmp("download", argv[optind]) == 0;
   userOptions->process = strcmp("process", argv[optind]) == 0;
+  userOptions->exportStore = strcmp("export", argv[optind]) == 0;
+  userOptions->query = strcmp("query", argv[optind]) == 0;
 
-  if (!(userOptions->download || userOptions->process)) {
+  if (!(userOptions->download || userOptions->process || userOptions->exportStore
+        || userOptions->query)) {
     fprintf(stderr, "Unknown sub-program specified: '%s'\n", argv[optind]);
     freeOption(userOptions);
     return NULL;
@@ -179,6 +494,12 @@ void printHelp(void)
     userOptions->logFile = argv[optind];
     optind++;
     userOptions->outputDirectory = argv[optind];
+  } else if (positionalArguments == 2 && userOptions->exportStore) {
+    userOptions->storePath = argv[optind];
+    optind++;
+    userOptions->outputDirectory = argv[optind];
+  } else if (positionalArguments == 1 && userOptions->query) {
+    userOptions->outputDirectory = argv[optind];
   } else {
     fprintf(stderr, "Encountered wrong number of positional arguments: ");
     for (int i = positionalArguments; i > 0; i--, optind++) {
@@ -189,6 +510,50 @@ void printHelp(void)
     return NULL;
   }
 
+  // exporting neither reads the AOI nor the log file
+  if (userOptions->exportStore) {
+    if (!fileReadable(userOptions->storePath)) {
+      fprintf(stderr, "Output store '%s' does not exist or is not readable\n\n", userOptions->storePath);
+      freeOption(userOptions);
+      return NULL;
+    }
+
+    if (!fileExists(userOptions->outputDirectory) || !fileWritable(userOptions->outputDirectory)) {
+      fprintf(stderr, "Output directory '%s' does not exist or is not writable\n\n",
+              userOptions->outputDirectory);
+      freeOption(userOptions);
+      return NULL;
+    }
+
+    forceNoTrailingSlash(userOptions);
+
+    return userOptions;
+  }
+
+  if (userOptions->query) {
+    if (userOptions->queryByFid == userOptions->queryByLocation) {
+      fprintf(stderr, "Query needs either '--fid' or '--lon' and '--lat'\n\n");
+      freeOption(userOptions);
+      return NULL;
+    }
+
+    if (userOptions->queryFrom > userOptions->queryTo) {
+      fprintf(stderr, "First day of query is after its last day\n\n");
+      freeOption(userOptions);
+      return NULL;
+    }
+
+    if (!fileExists(userOptions->outputDirectory)) {
+      fprintf(stderr, "Output directory '%s' does not exist\n\n", userOptions->outputDirectory);
+      freeOption(userOptions);
+      return NULL;
+    }
+
+    forceNoTrailingSlash(userOptions);
+
+    return userOptions;
+  }
+
   char *dupedLogFile = strdup(userOptions->logFile);
   if (dupedLogFile == NULL) {
     fprintf(stderr, "Failed to duplicate log file path\n");
@@ -225,6 +590,15 @@ void printHelp(void)
     return NULL;
   }
 
+  for (size_t i = 0; i < userOptions->aoiSetCount; i++) {
+    if (!fileReadable(userOptions->aoiSets[i].filePath)) {
+      fprintf(stderr, "AOI file '%s' does not exist or is not readable\n\n",
+              userOptions->aoiSets[i].filePath);
+      freeOption(userOptions);
+      return NULL;
+    }
+  }
+
   if (!outputDirectoryExists) {
     fprintf(stderr, "Output directory '%s' does not exist\n\n", userOptions->outputDirectory);
     freeOption(userOptions);
@@ -261,6 +635,227 @@ void printHelp(void)
   return userOptions;
 }
 
+int parseMemorySize(const char *argString, size_t *bytes)
+{
+  if (argString == NULL || bytes == NULL) {
+    return 1;
+  }
+
+  char *end = NULL;
+  errno = 0;
+  unsigned long long value = strtoull(argString, &end, 10);
+
+  if (errno != 0 || end == argString || value == 0 || argString[0] == '-') {
+    return 1;
+  }
+
+  unsigned long long multiplier = 1;
+
+  switch (*end) {
+    case '\0':
+      break;
+    case 'k':
+    case 'K':
+      multiplier = 1024ULL;
+      end++;
+      break;
+    case 'm':
+    case 'M':
+      multiplier = 1024ULL * 1024ULL;
+      end++;
+      break;
+    case 'g':
+    case 'G':
+      multiplier = 1024ULL * 1024ULL * 1024ULL;
+      end++;
+      break;
+    default:
+      return 1;
+  }
+
+  if (*end != '\0' || value > SIZE_MAX / multiplier) {
+    return 1;
+  }
+
+  *bytes = (size_t) (value * multiplier);
+
+  return 0;
+}
+
+int parseAggregations(const char *argString, unsigned int *aggregations)
+{
+  if (argString == NULL || aggregations == NULL) {
+    return 1;
+  }
+
+  char *duplicate = strdup(argString);
+  if (duplicate == NULL) {
+    perror("strdup");
+    return 1;
+  }
+
+  const char *names[] = {"daily-mean", "daily-min", "daily-max", "hourly"};
+  const unsigned int flags[] = {AGGREGATION_DAILY_MEAN, AGGREGATION_DAILY_MIN, AGGREGATION_DAILY_MAX, AGGREGATION_HOURLY};
+  unsigned int parsed = 0;
+  char *savePointer = NULL;
+
+  for (char *token = strtok_r(duplicate, ",", &savePointer); token != NULL;
+       token = strtok_r(NULL, ",", &savePointer)) {
+    size_t i = 0;
+
+    while (i < 4 && strcmp(token, names[i]) != 0) {
+      i++;
+    }
+
+    if (i == 4) {
+      free(duplicate);
+      return 1;
+    }
+
+    parsed |= flags[i];
+  }
+
+  free(duplicate);
+
+  if (parsed == 0) {
+    return 1;
+  }
+
+  *aggregations = parsed;
+
+  return 0;
+}
+
+int parseVariables(const char *argString, unsigned int *variables)
+{
+  if (argString == NULL || variables == NULL) {
+    return 1;
+  }
+
+  char *duplicate = strdup(argString);
+  if (duplicate == NULL) {
+    perror("strdup");
+    return 1;
+  }
+
+  unsigned int parsed = 0;
+  char *savePointer = NULL;
+
+  for (char *token = strtok_r(duplicate, ",", &savePointer); token != NULL;
+       token = strtok_r(NULL, ",", &savePointer)) {
+    unsigned int flag = 1u;
+
+    while (flag <= VARIABLE_LAST && strcmp(token, variableRequestName(flag)) != 0) {
+      flag <<= 1;
+    }
+
+    if (flag > VARIABLE_LAST) {
+      free(duplicate);
+      return 1;
+    }
+
+    parsed |= flag;
+  }
+
+  free(duplicate);
+
+  // intersections are computed for water vapor, other variables only reuse its weights
+  if (!(parsed & VARIABLE_TOTAL_COLUMN_WATER_VAPOUR)) {
+    return 1;
+  }
+
+  *variables = parsed;
+
+  return 0;
+}
+
+int parseAoiSet(const char *argString, struct aoiSet *set)
+{
+  if (argString == NULL || set == NULL) {
+    return 1;
+  }
+
+  char *buffer = strdup(argString);
+  if (buffer == NULL) {
+    perror("strdup");
+    return 1;
+  }
+
+  char *separator = strchr(buffer, '=');
+
+  if (separator == NULL || separator == buffer || separator[1] == '\0') {
+    free(buffer);
+    return 1;
+  }
+
+  *separator = '\0';
+
+  // the name becomes a subdirectory of the output directory, thus it must not leave it
+  if (strchr(buffer, '/') != NULL || strcmp(buffer, ".") == 0 || strcmp(buffer, "..") == 0) {
+    free(buffer);
+    return 1;
+  }
+
+  // paths may contain '@' themselves, thus the last one only separates the layer if the path
+  // before it names a readable file while the entire argument doesn't
+  char *path = separator + 1;
+  char *layer = strrchr(path, '@');
+
+  if (layer != NULL && !fileReadable(path)) {
+    *layer = '\0';
+
+    if (fileReadable(path)) {
+      layer++;
+    } else {
+      *layer = '@';
+      layer = NULL;
+    }
+  }
+
+  if (layer != NULL && *layer == '\0') {
+    free(buffer);
+    return 1;
+  }
+
+  *set = (struct aoiSet) {
+    .buffer = buffer,
+    .name = buffer,
+    .filePath = path,
+    .layerName = layer
+  };
+
+  return 0;
+}
+
+int appendAoiSet(const char *argString, option_t *options)
+{
+  struct aoiSet set;
+
+  if (parseAoiSet(argString, &set)) {
+    return 1;
+  }
+
+  for (size_t i = 0; i < options->aoiSetCount; i++) {
+    if (strcmp(options->aoiSets[i].name, set.name) == 0) {
+      free(set.buffer);
+      return 1;
+    }
+  }
+
+  struct aoiSet *sets = realloc(options->aoiSets, (options->aoiSetCount + 1) * sizeof(struct aoiSet));
+  if (sets == NULL) {
+    perror("realloc");
+    free(set.buffer);
+    return 1;
+  }
+
+  sets[options->aoiSetCount] = set;
+  options->aoiSets = sets;
+  options->aoiSetCount++;
+
+  return 0;
+}
+
 int parseIntegers(int *arr, size_t capacity, size_t *elements, char *argString, const int min,
                   const int max)
 {
@@ -558,8 +1153,52 @@ void printOptions(const option_t *options)
 
   printf("aoi file: %s\n", options->areaOfInterest);
 
+  if (options->download || options->process) {
+    printf("Variables: %u\n", options->variables);
+  }
+
   if (options->process) {
     printf("Geometries represent footprints: %d\n", options->footprint);
+    printf("Pipelined processing: %d\n", options->pipeline);
+    printf("Worker processes: %d\n", options->jobs);
+    printf("Sharded processing via claim files: %d (expiry %d s)\n", options->shardClaim,
+           options->claimExpiry);
+    printf("Deterministic summation: %d\n", options->deterministic);
+    printf("Memory budget: %lu bytes\n", options->memoryBudget);
+    printf("Incremental processing: %d\n", options->incremental);
+    printf("AOI cache: %s\n", options->aoiCache == NULL ? "none" : options->aoiCache);
+    printf("AOI ingestion threads: %d\n", options->threads);
+    printf("Simplification tolerance: %lf pixels\n", options->simplifyTolerance);
+    printf("Restrict AOI to raster extent: %d\n", options->spatialFilter);
+    printf("Output store: %d\n", options->store);
+    printf("Aggregations: %u\n", options->aggregations);
+    printf("Accumulate climatology: %d\n", options->climatology);
+    printf("Acquisition time field: %s\n",
+           options->acquisitionTimeField == NULL ? "none" : options->acquisitionTimeField);
+
+    printf("Intersection export: %s\n",
+           options->intersectionExportPath == NULL ? "none" : options->intersectionExportPath);
+
+    for (size_t i = 0; i < options->aoiSetCount; i++) {
+      printf("Additional aoi '%s': %s (layer %s)\n", options->aoiSets[i].name,
+             options->aoiSets[i].filePath,
+             options->aoiSets[i].layerName == NULL ? "first" : options->aoiSets[i].layerName);
+    }
+  }
+
+  if (options->exportStore) {
+    printf("Output store: %s\n", options->storePath);
+    printf("Write series store: %d\n", options->exportSeries);
+  }
+
+  if (options->query) {
+    if (options->queryByFid) {
+      printf("Query FID: %lld\n", (long long) options->queryFid);
+    } else {
+      printf("Query location: %lf, %lf\n", options->queryLongitude, options->queryLatitude);
+    }
+
+    printf("Query range: %d to %d\n", options->queryFrom, options->queryTo);
   }
 
   printf("out directory: %s\n", options->outputDirectory);
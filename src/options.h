@@ -60,6 +60,67 @@ void printHelp(void);
 int parseIntegers(int *arr, size_t capacity, size_t *elements, char *argString, const int min,
                   const int max);
 
+/**
+ * @brief Parse a memory size with optional binary suffix
+ *
+ * @details Accepts a positive integer optionally followed by K, M or G (case-insensitive),
+ *          which are interpreted as powers of 1024.
+ *
+ * @param argString String to parse, e.g. "512M".
+ * @param bytes Reference to variable receiving the size in bytes.
+ * @return int 0 on success, 1 on error.
+ */
+int parseMemorySize(const char *argString, size_t *bytes);
+
+/**
+ * @brief Parse a comma-separated list of temporal aggregations
+ *
+ * @details Accepts any combination of "hourly", "daily-mean", "daily-min" and "daily-max".
+ *
+ * @param argString String to parse, e.g. "daily-mean,daily-max".
+ * @param aggregations Reference to variable receiving the AGGREGATION_* flags.
+ * @return int 0 on success, 1 on error.
+ */
+int parseAggregations(const char *argString, unsigned int *aggregations);
+
+/**
+ * @brief Parse a comma-separated list of ERA5 single level variables
+ *
+ * @details Accepts any combination of "total_column_water_vapour", "surface_pressure" and
+ *          "total_column_ozone", the first one being mandatory.
+ *
+ * @param argString String to parse, e.g. "total_column_water_vapour,surface_pressure".
+ * @param variables Reference to variable receiving the VARIABLE_* flags.
+ * @return int 0 on success, 1 on error.
+ */
+int parseVariables(const char *argString, unsigned int *variables);
+
+/**
+ * @brief Parse an additional AOI given as `name=path[@layer]`
+ *
+ * @details The name must not be empty, contain '/' or be one of "." and "..", since it's used as
+ *          subdirectory of the output directory. Paths may contain '@', the last one only separates
+ *          the layer if the entire path isn't a readable file but the part before it is. Otherwise,
+ *          the first layer is read. Geometries, output directory and options of the set are filled
+ *          in later.
+ *
+ * @note The caller must free `set->buffer`.
+ *
+ * @param argString String to parse, e.g. "wrs2=/data/wrs2.gpkg@descending".
+ * @param set Set to fill.
+ * @return int 0 on success, 1 on error.
+ */
+int parseAoiSet(const char *argString, struct aoiSet *set);
+
+/**
+ * @brief Parse an additional AOI and append it to the options
+ *
+ * @param argString String to parse, see parseAoiSet().
+ * @param options Options to append the set to.
+ * @return int 0 on success, 1 on error or if the name was given before.
+ */
+int appendAoiSet(const char *argString, option_t *options);
+
 /**
  * @brief Parse a range of integers denoted by min:max to list of intgers with closed interval bounds
  *
@@ -0,0 +1,428 @@
+#define _POSIX_C_SOURCE 200809L
+#include "output-store.h"
+#include "haze.h"
+#include "paths.h"
+#include "types.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <gdal/ogr_core.h>
+
+[[nodiscard]] char *storePathOfYear(const char *outputDirectory, int year)
+{
+  return constructFilePath("%s/WVP_%.4d" STORE_EXTENSION, outputDirectory, year);
+}
+
+bool isStorePath(const char *filePath)
+{
+  size_t length = strlen(filePath);
+  size_t extensionLength = strlen(STORE_EXTENSION);
+
+  return length >= extensionLength
+         && strcmp(filePath + length - extensionLength, STORE_EXTENSION) == 0;
+}
+
+int storeSlot(int month, int day)
+{
+  if (month < 1 || month > 12 || day < 1 || day > 31) {
+    return -1;
+  }
+
+  return (month - 1) * 31 + day - 1;
+}
+
+off_t storeIndexOffset(uint64_t featureCount)
+{
+  return (off_t) (sizeof(struct storeHeader) + featureCount * sizeof(struct storeFeature));
+}
+
+off_t storeMatrixOffset(uint64_t featureCount)
+{
+  return storeIndexOffset(featureCount) + (off_t) (STORE_DAY_SLOTS * sizeof(uint64_t));
+}
+
+int preadFully(int fd, void *buffer, size_t size, off_t offset)
+{
+  size_t total = 0;
+
+  while (total < size) {
+    ssize_t bytesRead = pread(fd, (char *) buffer + total, size - total, offset + (off_t) total);
+
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (bytesRead <= 0) {
+      return 1;
+    }
+
+    total += (size_t) bytesRead;
+  }
+
+  return 0;
+}
+
+int pwriteFully(int fd, const void *buffer, size_t size, off_t offset)
+{
+  size_t total = 0;
+
+  while (total < size) {
+    ssize_t bytesWritten = pwrite(fd, (const char *) buffer + total, size - total,
+                                  offset + (off_t) total);
+
+    if (bytesWritten < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (bytesWritten <= 0) {
+      perror("pwrite");
+      return 1;
+    }
+
+    total += (size_t) bytesWritten;
+  }
+
+  return 0;
+}
+
+int createStore(const char *storePath, int year, uint64_t featureCount, uint64_t features)
+{
+  struct storeHeader header = {
+    .year = (uint32_t) year,
+    .daySlots = STORE_DAY_SLOTS,
+    .featureCount = featureCount,
+    .features = features
+  };
+  memcpy(header.magic, STORE_MAGIC, STORE_MAGIC_SIZE);
+
+  struct storeFeature *table = malloc((featureCount > 0 ? featureCount : 1) * sizeof(struct storeFeature));
+  if (table == NULL) {
+    perror("malloc");
+    return 1;
+  }
+
+  for (uint64_t i = 0; i < featureCount; i++) {
+    table[i] = (struct storeFeature) {.fid = OGRNullFID, .x = NAN, .y = NAN};
+  }
+
+  char *temporaryPath = constructFilePath("%s.%d.tmp", storePath, (int) getpid());
+  if (temporaryPath == NULL) {
+    fprintf(stderr, "Failed to construct path of temporary output store\n");
+    free(table);
+    return 1;
+  }
+
+  int fd = open(temporaryPath, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    perror("open");
+    free(temporaryPath);
+    free(table);
+    return 1;
+  }
+
+  off_t storeSize = storeMatrixOffset(featureCount)
+                    + (off_t) (STORE_DAY_SLOTS * featureCount * sizeof(double));
+
+  // index and matrix stay holes of zeros until days are written
+  bool failed = pwriteFully(fd, &header, sizeof(struct storeHeader), 0)
+                || pwriteFully(fd, table, featureCount * sizeof(struct storeFeature),
+                               (off_t) sizeof(struct storeHeader))
+                || ftruncate(fd, storeSize) != 0;
+
+  free(table);
+
+  if (close(fd) != 0 || failed) {
+    fprintf(stderr, "Failed to write output store %s\n", storePath);
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  // unlike rename, link never replaces a store another process created in the meantime
+  if (link(temporaryPath, storePath) != 0 && errno != EEXIST) {
+    perror("link");
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  unlink(temporaryPath);
+  free(temporaryPath);
+
+  return 0;
+}
+
+int readStoreHeader(int fd, const char *storePath, struct storeHeader *header)
+{
+  if (preadFully(fd, header, sizeof(struct storeHeader), 0)
+      || memcmp(header->magic, STORE_MAGIC, STORE_MAGIC_SIZE) != 0
+      || header->daySlots != STORE_DAY_SLOTS) {
+    fprintf(stderr, "'%s' is not an output store of this version\n", storePath);
+    return 1;
+  }
+
+  return 0;
+}
+
+int openStore(const char *storePath, int year, uint64_t featureCount, uint64_t features)
+{
+  int fd = open(storePath, O_RDWR);
+
+  if (fd < 0 && errno == ENOENT) {
+    if (createStore(storePath, year, featureCount, features)) {
+      return -1;
+    }
+
+    fd = open(storePath, O_RDWR);
+  }
+
+  if (fd < 0) {
+    perror("open");
+    return -1;
+  }
+
+  struct storeHeader header;
+
+  if (readStoreHeader(fd, storePath, &header)) {
+    close(fd);
+    return -1;
+  }
+
+  if (header.year != (uint32_t) year || header.featureCount != featureCount
+      || header.features != features) {
+    fprintf(stderr, "Output store %s was written for a different year or AOI, use another output directory\n",
+            storePath);
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+bool isStoreDayWritten(const char *storePath, int month, int day)
+{
+  int slot = storeSlot(month, day);
+  if (slot < 0) {
+    return false;
+  }
+
+  int fd = open(storePath, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct storeHeader header;
+  uint64_t entry = 0;
+  bool written = readStoreHeader(fd, storePath, &header) == 0
+                 && preadFully(fd, &entry, sizeof(uint64_t),
+                               storeIndexOffset(header.featureCount) + (off_t) slot * (off_t) sizeof(uint64_t)) == 0
+                 && entry != 0;
+
+  close(fd);
+
+  return written;
+}
+
+int writeStoreDay(const char *storePath, const meanVector *values)
+{
+  int slot = storeSlot(values->month, values->day);
+  if (slot < 0) {
+    fprintf(stderr, "Invalid date %.4d-%.2d-%.2d for output store %s\n", values->year, values->month,
+            values->day, storePath);
+    return 1;
+  }
+
+  uint64_t featureCount = values->featureCount;
+  int fd = openStore(storePath, values->year, featureCount, values->provenance.features);
+  if (fd < 0) {
+    return 1;
+  }
+
+  struct storeFeature *table = malloc((featureCount > 0 ? featureCount : 1) * sizeof(struct storeFeature));
+  double *row = malloc((featureCount > 0 ? featureCount : 1) * sizeof(double));
+
+  if (table == NULL || row == NULL) {
+    perror("malloc");
+    free(table);
+    free(row);
+    close(fd);
+    return 1;
+  }
+
+  bool failed = preadFully(fd, table, featureCount * sizeof(struct storeFeature),
+                           (off_t) sizeof(struct storeHeader)) != 0;
+
+  for (uint64_t i = 0; i < featureCount; i++) {
+    row[i] = NAN;
+  }
+
+  // runs of consecutive unknown features are written with a single call each; entries in between
+  // are left alone since other processes may be writing them
+  size_t runStart = 0;
+  size_t runLength = 0;
+
+  for (size_t i = 0; i < values->size && !failed; i++) {
+    const struct m *entry = &values->entries[i];
+
+    if (entry->order >= featureCount) {
+      fprintf(stderr, "Feature %lld is not part of output store %s\n", (long long) entry->fid, storePath);
+      failed = true;
+      break;
+    }
+
+    row[entry->order] = entry->value;
+
+    if (table[entry->order].fid == entry->fid) {
+      continue;
+    }
+
+    table[entry->order] = (struct storeFeature) {.fid = entry->fid, .x = entry->x, .y = entry->y};
+
+    if (runLength > 0 && entry->order != runStart + runLength) {
+      failed = pwriteFully(fd, table + runStart, runLength * sizeof(struct storeFeature),
+                           (off_t) (sizeof(struct storeHeader) + runStart * sizeof(struct storeFeature)));
+      runLength = 0;
+    }
+
+    if (runLength == 0) {
+      runStart = entry->order;
+    }
+
+    runLength++;
+  }
+
+  if (!failed && runLength > 0) {
+    failed = pwriteFully(fd, table + runStart, runLength * sizeof(struct storeFeature),
+                         (off_t) (sizeof(struct storeHeader) + runStart * sizeof(struct storeFeature)));
+  }
+
+  // zero marks absent days, a zero input hash is thus stored as one
+  uint64_t indexEntry = values->provenance.input == 0 ? 1 : values->provenance.input;
+
+  failed = failed
+           || pwriteFully(fd, row, featureCount * sizeof(double),
+                          storeMatrixOffset(featureCount) + (off_t) ((uint64_t) slot * featureCount * sizeof(double)))
+           || pwriteFully(fd, &indexEntry, sizeof(uint64_t),
+                          storeIndexOffset(featureCount) + (off_t) slot * (off_t) sizeof(uint64_t));
+
+  free(table);
+  free(row);
+
+  if (close(fd) != 0 || failed) {
+    fprintf(stderr, "Failed to write %.4d-%.2d-%.2d to output store %s\n", values->year, values->month,
+            values->day, storePath);
+    return 1;
+  }
+
+  return 0;
+}
+
+int exportStore(const char *storePath, const char *outputDirectory)
+{
+  int fd = open(storePath, O_RDONLY);
+  if (fd < 0) {
+    perror("open");
+    return 1;
+  }
+
+  struct storeHeader header;
+
+  if (readStoreHeader(fd, storePath, &header)) {
+    close(fd);
+    return 1;
+  }
+
+  uint64_t featureCount = header.featureCount;
+  size_t allocationCount = featureCount > 0 ? featureCount : 1;
+  struct storeFeature *table = malloc(allocationCount * sizeof(struct storeFeature));
+  uint64_t *index = malloc(STORE_DAY_SLOTS * sizeof(uint64_t));
+  double *row = malloc(allocationCount * sizeof(double));
+  meanVector day = {.entries = malloc(allocationCount * sizeof(struct m)), .capcity = featureCount};
+
+  if (table == NULL || index == NULL || row == NULL || day.entries == NULL) {
+    perror("malloc");
+    free(table);
+    free(index);
+    free(row);
+    free(day.entries);
+    close(fd);
+    return 1;
+  }
+
+  bool failed = preadFully(fd, table, featureCount * sizeof(struct storeFeature),
+                           (off_t) sizeof(struct storeHeader))
+                || preadFully(fd, index, STORE_DAY_SLOTS * sizeof(uint64_t), storeIndexOffset(featureCount));
+
+  if (failed) {
+    fprintf(stderr, "Failed to read output store %s\n", storePath);
+  }
+
+  int exported = 0;
+
+  for (int slot = 0; slot < STORE_DAY_SLOTS && !failed; slot++) {
+    if (index[slot] == 0) {
+      continue;
+    }
+
+    int month = slot / 31 + 1;
+    int dayOfMonth = slot % 31 + 1;
+
+    if (preadFully(fd, row, featureCount * sizeof(double),
+                   storeMatrixOffset(featureCount) + (off_t) ((uint64_t) slot * featureCount * sizeof(double)))) {
+      fprintf(stderr, "Failed to read %.4u-%.2d-%.2d from output store %s\n", header.year, month,
+              dayOfMonth, storePath);
+      failed = true;
+      break;
+    }
+
+    day.size = 0;
+
+    for (uint64_t i = 0; i < featureCount; i++) {
+      if (isnan(row[i])) {
+        continue;
+      }
+
+      day.entries[day.size] = (struct m) {
+        .x = table[i].x, .y = table[i].y, .value = row[i], .fid = table[i].fid, .order = i
+      };
+      day.size++;
+    }
+
+    char *tablePath = constructFilePath("%s/WVP_%.4u-%.2d-%.2d.txt", outputDirectory, header.year, month,
+                                        dayOfMonth);
+    if (tablePath == NULL) {
+      fprintf(stderr, "Failed to construct file path for output text file\n");
+      failed = true;
+      break;
+    }
+
+    if (writeWeightedMeans(&day, tablePath) != 0) {
+      fprintf(stderr, "Encountered error while writing output table '%s'\n", tablePath);
+      failed = true;
+    } else {
+      exported++;
+    }
+
+    free(tablePath);
+  }
+
+  free(table);
+  free(index);
+  free(row);
+  free(day.entries);
+  close(fd);
+
+  if (!failed) {
+    printf("Exported %d tables from %s\n", exported, storePath);
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+#ifndef OUTPUT_STORE_H
+#define OUTPUT_STORE_H
+/**
+ * @file output-store.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for a per-year store of output tables,
+ *        from which FORCE text tables are exported on demand.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup output-store Output Store
+ * @{
+ */
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/// Magic bytes at the start of an output store, the last byte being the format version
+#define STORE_MAGIC "HAZESTO\001"
+
+/// Number of magic bytes
+#define STORE_MAGIC_SIZE 8
+
+/// Number of day slots of a store, each month is assigned 31 slots
+#define STORE_DAY_SLOTS (12 * 31)
+
+/// File extension of output stores
+#define STORE_EXTENSION ".hzs"
+
+/**
+ * @brief Construct the path of the output store of a year
+ *
+ * @note The caller must free the returned string.
+ *
+ * @param outputDirectory Directory output is written to.
+ * @param year Year of the store.
+ * @return char* Path of the store, NULL on error.
+ */
+[[nodiscard]] char *storePathOfYear(const char *outputDirectory, int year);
+
+/**
+ * @brief Check whether a path refers to an output store
+ *
+ * @param filePath Path to check.
+ * @return true The path ends with STORE_EXTENSION.
+ * @return false Otherwise.
+ */
+bool isStorePath(const char *filePath);
+
+/**
+ * @brief Compute the day slot of a date
+ *
+ * @param month Month in range [1, 12].
+ * @param day Day in range [1, 31].
+ * @return int Day slot, -1 if the date is out of range.
+ */
+int storeSlot(int month, int day);
+
+/**
+ * @brief Compute the offset of the index of an output store
+ *
+ * @param featureCount Number of features of the store.
+ * @return off_t Offset of the first index entry.
+ */
+off_t storeIndexOffset(uint64_t featureCount);
+
+/**
+ * @brief Compute the offset of the value matrix of an output store
+ *
+ * @param featureCount Number of features of the store.
+ * @return off_t Offset of the first row of the matrix.
+ */
+off_t storeMatrixOffset(uint64_t featureCount);
+
+/**
+ * @brief Read exactly `size` bytes at an offset
+ *
+ * @param fd File descriptor to read from.
+ * @param buffer Destination buffer.
+ * @param size Number of bytes to read.
+ * @param offset Offset to read at.
+ * @return int 0 on success, 1 on error or if the file ends early.
+ */
+int preadFully(int fd, void *buffer, size_t size, off_t offset);
+
+/**
+ * @brief Write exactly `size` bytes at an offset
+ *
+ * @param fd File descriptor to write to.
+ * @param buffer Source buffer.
+ * @param size Number of bytes to write.
+ * @param offset Offset to write at.
+ * @return int 0 on success, 1 on error.
+ */
+int pwriteFully(int fd, const void *buffer, size_t size, off_t offset);
+
+/**
+ * @brief Create an empty output store unless it exists already
+ *
+ * @details The header and the features table are written to a temporary file, which is extended
+ *          to the full size of the store and linked to its final path afterwards. The index and the
+ *          matrix are not written, thus they occupy no space until days are stored. If another
+ *          process created the store in the meantime, that one is kept.
+ *
+ * @param storePath Path to store.
+ * @param year Year of the store.
+ * @param featureCount Number of AOI features.
+ * @param features Digest of AOI features.
+ * @return int 0 on success, 1 on error.
+ */
+int createStore(const char *storePath, int year, uint64_t featureCount, uint64_t features);
+
+/**
+ * @brief Open an output store for writing, creating it if necessary
+ *
+ * @details Stores written for a different year or different AOI features are rejected.
+ *
+ * @param storePath Path to store.
+ * @param year Year of the store.
+ * @param featureCount Number of AOI features.
+ * @param features Digest of AOI features.
+ * @return int File descriptor of the store, -1 on error.
+ */
+int openStore(const char *storePath, int year, uint64_t featureCount, uint64_t features);
+
+/**
+ * @brief Read and validate the header of an output store
+ *
+ * @param fd File descriptor of the store.
+ * @param storePath Path to store, used for error messages.
+ * @param header Set to the header of the store.
+ * @return int 0 on success, 1 if the file is not a store.
+ */
+int readStoreHeader(int fd, const char *storePath, struct storeHeader *header);
+
+/**
+ * @brief Check whether an output store holds a day
+ *
+ * @param storePath Path to store.
+ * @param month Month of the day.
+ * @param day Day of month.
+ * @return true The day was written to the store.
+ * @return false The day is missing or the store could not be read.
+ */
+bool isStoreDayWritten(const char *storePath, int month, int day);
+
+/**
+ * @brief Write a day table into an output store
+ *
+ * @details The row of the day is written in full, features without a value are set to NaN. Entries
+ *          of the features table are only written for features which were unknown so far. The index
+ *          entry is written last, thus a day is only considered present once its row is complete.
+ *          All writes go to fixed offsets, thus several processes may write different days of the
+ *          same store concurrently.
+ *
+ * @param storePath Path to store.
+ * @param values Table of a single day, rows are placed by their `order`.
+ * @return int 0 on success, 1 on error.
+ */
+int writeStoreDay(const char *storePath, const meanVector *values);
+
+/**
+ * @brief Export all days of an output store as FORCE text tables
+ *
+ * @details Rows are written in feature order. Features without a value on a day are left out.
+ *
+ * @param storePath Path to store.
+ * @param outputDirectory Directory text tables are written to.
+ * @return int 0 on success, 1 on error.
+ */
+int exportStore(const char *storePath, const char *outputDirectory);
+
+/** @} */ // end of group
+#endif // OUTPUT_STORE_H
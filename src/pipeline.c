@@ -0,0 +1,197 @@
+#include "pipeline.h"
+#include "haze.h"
+#include "queue.h"
+#include "types.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+void *readerStage(void *arg)
+{
+  struct readerContext *context = (struct readerContext *) arg;
+
+  // only read the next dataset once it can be handed off, otherwise memory usage is unbounded
+  while (queueWaitForSpace(context->datasets) == 0) {
+    // allocated before taking an entry, entries are only completed by the writer stage
+    struct loadedDataset *dataset = calloc(1, sizeof(struct loadedDataset));
+    if (dataset == NULL) {
+      perror("calloc");
+      context->failed = true;
+      break;
+    }
+
+    stringList *entry = context->provider->next(context->provider);
+
+    if (entry == NULL) {
+      free(dataset);
+      break;
+    }
+
+    if (loadDataset(entry, context->areasOfInterest, context->options, dataset)) {
+      dataset->failed = true;
+    }
+
+    if (queuePush(context->datasets, dataset)) {
+      freeRawData(&dataset->data);
+      free(dataset);
+      break;
+    }
+  }
+
+  queueClose(context->datasets);
+
+  return NULL;
+}
+
+void *writerStage(void *arg)
+{
+  struct writerContext *context = (struct writerContext *) arg;
+  bool writeFailed = false;
+  struct pipelineJob *job;
+
+  while ((job = queuePop(context->jobs)) != NULL) {
+    if (job->values == NULL) {
+      context->provider->complete(context->provider, job->entry, job->success && !writeFailed);
+      writeFailed = false;
+    } else if (writeFailed) {
+      // sequential processing stops at the first failed table of a dataset, do the same here
+      freeWeightedMeans(job->values);
+      free(job->filePath);
+    } else {
+      writeFailed = writeTable(job->values, job->filePath, job->entry, job->day,
+                               context->provider) != 0;
+    }
+
+    free(job);
+  }
+
+  return NULL;
+}
+
+int enqueueTable(meanVector *values, char *filePath, stringList *entry, int day, void *sinkData)
+{
+  boundedQueue *jobs = (boundedQueue *) sinkData;
+
+  struct pipelineJob *job = calloc(1, sizeof(struct pipelineJob));
+  if (job == NULL) {
+    perror("calloc");
+    freeWeightedMeans(values);
+    free(filePath);
+    return 1;
+  }
+
+  job->values = values;
+  job->filePath = filePath;
+  job->entry = entry;
+  job->day = day;
+
+  if (queuePush(jobs, job)) {
+    freeWeightedMeans(values);
+    free(filePath);
+    free(job);
+    return 1;
+  }
+
+  return 0;
+}
+
+int runPipeline(entryProvider *provider, vectorGeometryVector *areasOfInterest,
+                const option_t *options)
+{
+  boundedQueue datasets;
+  boundedQueue jobs;
+
+  if (queueInit(&datasets, PIPELINE_PREFETCH_DEPTH)) {
+    return 1;
+  }
+
+  if (queueInit(&jobs, PIPELINE_OUTPUT_DEPTH)) {
+    queueDestroy(&datasets);
+    return 1;
+  }
+
+  struct readerContext readerArgs = {
+    .provider = provider,
+    .areasOfInterest = areasOfInterest,
+    .options = options,
+    .datasets = &datasets
+  };
+  struct writerContext writerArgs = {.provider = provider, .jobs = &jobs};
+  pthread_t reader;
+  pthread_t writer;
+
+  if (pthread_create(&writer, NULL, writerStage, &writerArgs) != 0) {
+    fprintf(stderr, "Failed to start writer thread\n");
+    queueDestroy(&jobs);
+    queueDestroy(&datasets);
+    return 1;
+  }
+
+  if (pthread_create(&reader, NULL, readerStage, &readerArgs) != 0) {
+    fprintf(stderr, "Failed to start reader thread\n");
+    queueClose(&jobs);
+    pthread_join(writer, NULL);
+    queueDestroy(&jobs);
+    queueDestroy(&datasets);
+    return 1;
+  }
+
+  int status = 0;
+  struct loadedDataset *dataset;
+
+  // compute stage runs in calling thread, GEOS was initialized for it
+  while ((dataset = queuePop(&datasets)) != NULL) {
+    bool success = false;
+
+    if (!dataset->failed) {
+      success = computeDataset(dataset, areasOfInterest, options, enqueueTable, &jobs) == 0;
+      freeRawData(&dataset->data);
+    }
+
+    struct pipelineJob *completion = calloc(1, sizeof(struct pipelineJob));
+    if (completion == NULL) {
+      perror("calloc");
+      fprintf(stderr, "Encountered errors while processing %s. Not marking dataset as processed.\n",
+              dataset->entry->string);
+      free(dataset);
+      status = 1;
+      break;
+    }
+
+    completion->entry = dataset->entry;
+    completion->success = success;
+    free(dataset);
+
+    if (queuePush(&jobs, completion)) {
+      free(completion);
+      status = 1;
+      break;
+    }
+  }
+
+  if (status) {
+    // stop reader; datasets read ahead are discarded without touching their log file entries
+    queueClose(&datasets);
+    while ((dataset = queuePop(&datasets)) != NULL) {
+      freeRawData(&dataset->data);
+      free(dataset);
+    }
+  }
+
+  pthread_join(reader, NULL);
+
+  if (readerArgs.failed) {
+    status = 1;
+  }
+
+  // remaining tables are still written before the writer exits
+  queueClose(&jobs);
+  pthread_join(writer, NULL);
+
+  queueDestroy(&jobs);
+  queueDestroy(&datasets);
+
+  return status;
+}
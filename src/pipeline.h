@@ -0,0 +1,83 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+/**
+ * @file pipeline.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for overlapping reading, computation and writing of ERA-5 datasets.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup pipeline Processing Pipeline
+ * @{
+ */
+
+#include "types.h"
+
+/// Number of datasets read ahead of the one currently being computed
+#define PIPELINE_PREFETCH_DEPTH 1
+
+/// Number of computed tables which may wait for being written to disk
+#define PIPELINE_OUTPUT_DEPTH 64
+
+/**
+ * @brief Thread function of the reader stage
+ *
+ * @details Loads datasets returned by the provider and passes them to the compute stage. The next
+ *          dataset is only read once the dataset queue has space. The queue is closed when the
+ *          provider is exhausted or memory for the next dataset can't be allocated, in which case
+ *          no further entry is taken from the provider.
+ *
+ * @param arg Reference to struct readerContext.
+ * @return void* Always NULL.
+ */
+void *readerStage(void *arg);
+
+/**
+ * @brief Thread function of the writer stage
+ *
+ * @details Writes tables to disk, completing the corresponding day of an entry after each table,
+ *          and completes entries once all of their tables are written.
+ *          After a failed write, remaining tables of the same entry are discarded and the entry
+ *          is completed as failed.
+ *
+ * @param arg Reference to struct writerContext.
+ * @return void* Always NULL.
+ */
+void *writerStage(void *arg);
+
+/**
+ * @brief Table sink handing tables over to the writer stage of the pipeline
+ *
+ * @param values Vector containing centroids of AOI geometries and associated water column value.
+ * @param filePath Path to output file.
+ * @param entry Log file entry the table belongs to.
+ * @param day Day of month the table belongs to.
+ * @param sinkData Reference to the queue of the writer stage.
+ * @return int 0 on success, 1 on error.
+ */
+int enqueueTable(meanVector *values, char *filePath, stringList *entry, int day, void *sinkData);
+
+/**
+ * @brief Process all entries supplied by a provider in a three-stage pipeline
+ *
+ * @details A reader thread opens and reads the next dataset while the calling thread computes
+ *          area-weighted means of the current one. Finished tables are written to disk by a writer
+ *          thread. Entries are completed by the writer thread once all of their tables are written,
+ *          thus the status of an entry is never updated before its output exists on disk.
+ *          At most PIPELINE_PREFETCH_DEPTH + 1 datasets are held in memory at once.
+ *
+ * @note Output is identical to processEntries(), only the timing of work differs.
+ *
+ * @param provider Reference to entry provider. `next` is called from the reader thread, `complete`
+ *        from the writer thread.
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @return int 0 on success, 1 on error.
+ */
+int runPipeline(entryProvider *provider, vectorGeometryVector *areasOfInterest,
+                const option_t *options);
+
+/** @} */ // end of group
+#endif // PIPELINE_H
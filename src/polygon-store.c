@@ -0,0 +1,539 @@
+#include "polygon-store.h"
+#include "types.h"
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <gdal/ogr_api.h>
+#include <gdal/ogr_core.h>
+#include <gdal/ogr_srs_api.h>
+#include <geos_c.h>
+
+size_t compactPolygonBlockSize(uint32_t pointCount, uint32_t ringCount, uint32_t partCount)
+{
+  return 2 * (size_t) pointCount * sizeof(double)
+         + ((size_t) ringCount + 1) * sizeof(uint32_t)
+         + ((size_t) partCount + 1) * sizeof(uint32_t);
+}
+
+int allocateCompactPolygon(compactPolygon *polygon, uint32_t pointCount, uint32_t ringCount,
+                           uint32_t partCount)
+{
+  // coordinates come first to keep doubles aligned, offsets are appended to the same block
+  polygon->coordinates = malloc(compactPolygonBlockSize(pointCount, ringCount, partCount));
+  if (polygon->coordinates == NULL) {
+    perror("malloc");
+    return 1;
+  }
+
+  polygon->ringOffsets = (uint32_t *) (polygon->coordinates + 2 * (size_t) pointCount);
+  polygon->partOffsets = polygon->ringOffsets + ringCount + 1;
+  polygon->pointCount = pointCount;
+  polygon->ringCount = ringCount;
+  polygon->partCount = partCount;
+
+  return 0;
+}
+
+int compactPolygonFromOGR(const OGRGeometryH geom, compactPolygon *polygon)
+{
+  OGRwkbGeometryType type = wkbFlatten(OGR_G_GetGeometryType(geom));
+
+  if (type != wkbPolygon && type != wkbMultiPolygon) {
+    fprintf(stderr, "Got unexpected geometry type '%s'\n", OGR_G_GetGeometryName(geom));
+    return 1;
+  }
+
+  bool isMulti = type == wkbMultiPolygon;
+  int partCount = isMulti ? OGR_G_GetGeometryCount(geom) : 1;
+  size_t ringCount = 0;
+  size_t pointCount = 0;
+
+  for (int part = 0; part < partCount; part++) {
+    OGRGeometryH subPolygon = isMulti ? OGR_G_GetGeometryRef(geom, part) : geom;
+    int subRingCount = OGR_G_GetGeometryCount(subPolygon);
+
+    ringCount += (size_t) subRingCount;
+
+    for (int ring = 0; ring < subRingCount; ring++) {
+      pointCount += (size_t) OGR_G_GetPointCount(OGR_G_GetGeometryRef(subPolygon, ring));
+    }
+  }
+
+  if (pointCount >= UINT32_MAX || ringCount >= UINT32_MAX) {
+    fprintf(stderr, "Geometry has too many vertices to be stored\n");
+    return 1;
+  }
+
+  if (allocateCompactPolygon(polygon, (uint32_t) pointCount, (uint32_t) ringCount,
+                             (uint32_t) partCount)) {
+    return 1;
+  }
+
+  polygon->isMulti = isMulti;
+
+  uint32_t point = 0;
+  uint32_t ring = 0;
+
+  for (int part = 0; part < partCount; part++) {
+    OGRGeometryH subPolygon = isMulti ? OGR_G_GetGeometryRef(geom, part) : geom;
+    int subRingCount = OGR_G_GetGeometryCount(subPolygon);
+
+    polygon->partOffsets[part] = ring;
+
+    for (int subRing = 0; subRing < subRingCount; subRing++) {
+      OGRGeometryH ringGeometry = OGR_G_GetGeometryRef(subPolygon, subRing);
+      int ringPointCount = OGR_G_GetPointCount(ringGeometry);
+      double *ringCoordinates = polygon->coordinates + 2 * (size_t) point;
+
+      polygon->ringOffsets[ring] = point;
+
+      if (ringPointCount > 0
+          && OGR_G_GetPoints(ringGeometry, ringCoordinates, 2 * sizeof(double), ringCoordinates + 1,
+                             2 * sizeof(double), NULL, 0) != ringPointCount) {
+        fprintf(stderr, "Failed to extract points from linear ring geometry\n");
+        freeCompactPolygon(polygon);
+        return 1;
+      }
+
+      point += (uint32_t) ringPointCount;
+      ring++;
+    }
+  }
+
+  polygon->ringOffsets[ring] = point;
+  polygon->partOffsets[partCount] = ring;
+
+  computeCompactPolygonEnvelope(polygon);
+
+  return 0;
+}
+
+void computeCompactPolygonEnvelope(compactPolygon *polygon)
+{
+  if (polygon->pointCount == 0) {
+    polygon->envelope.MinX = polygon->envelope.MinY = 0.0;
+    polygon->envelope.MaxX = polygon->envelope.MaxY = 0.0;
+    return;
+  }
+
+  polygon->envelope.MinX = DBL_MAX;
+  polygon->envelope.MinY = DBL_MAX;
+  polygon->envelope.MaxX = -DBL_MAX;
+  polygon->envelope.MaxY = -DBL_MAX;
+
+  for (size_t i = 0; i < polygon->pointCount; i++) {
+    polygon->envelope.MinX = fmin(polygon->envelope.MinX, polygon->coordinates[2 * i]);
+    polygon->envelope.MaxX = fmax(polygon->envelope.MaxX, polygon->coordinates[2 * i]);
+    polygon->envelope.MinY = fmin(polygon->envelope.MinY, polygon->coordinates[2 * i + 1]);
+    polygon->envelope.MaxY = fmax(polygon->envelope.MaxY, polygon->coordinates[2 * i + 1]);
+  }
+}
+
+int compactPolygonFromGEOS(const GEOSGeometry *geom, compactPolygon *polygon)
+{
+  int type = GEOSGeomTypeId(geom);
+
+  if (type != GEOS_POLYGON && type != GEOS_MULTIPOLYGON) {
+    fprintf(stderr, "Got unexpected GEOS geometry type %d\n", type);
+    return 1;
+  }
+
+  bool isMulti = type == GEOS_MULTIPOLYGON;
+  int partCount = isMulti ? GEOSGetNumGeometries(geom) : 1;
+  size_t ringCount = 0;
+  size_t pointCount = 0;
+
+  if (partCount < 0) {
+    fprintf(stderr, "Failed to get number of polygons\n");
+    return 1;
+  }
+
+  // empty polygons don't have any rings, like their OGR counterparts
+  for (int part = 0; part < partCount; part++) {
+    const GEOSGeometry *subPolygon = isMulti ? GEOSGetGeometryN(geom, part) : geom;
+    int interiorRingCount = GEOSGetNumInteriorRings(subPolygon);
+
+    if (interiorRingCount < 0) {
+      fprintf(stderr, "Failed to get number of interior rings\n");
+      return 1;
+    }
+
+    if (GEOSisEmpty(subPolygon) == 1) {
+      continue;
+    }
+
+    for (int ring = 0; ring <= interiorRingCount; ring++) {
+      const GEOSGeometry *ringGeometry = ring == 0 ? GEOSGetExteriorRing(subPolygon)
+                                         : GEOSGetInteriorRingN(subPolygon, ring - 1);
+      unsigned int ringPointCount;
+
+      if (ringGeometry == NULL
+          || GEOSCoordSeq_getSize(GEOSGeom_getCoordSeq(ringGeometry), &ringPointCount) == 0) {
+        fprintf(stderr, "Failed to get number of points of linear ring\n");
+        return 1;
+      }
+
+      pointCount += ringPointCount;
+      ringCount++;
+    }
+  }
+
+  if (pointCount >= UINT32_MAX || ringCount >= UINT32_MAX) {
+    fprintf(stderr, "Geometry has too many vertices to be stored\n");
+    return 1;
+  }
+
+  if (allocateCompactPolygon(polygon, (uint32_t) pointCount, (uint32_t) ringCount,
+                             (uint32_t) partCount)) {
+    return 1;
+  }
+
+  polygon->isMulti = isMulti;
+
+  uint32_t point = 0;
+  uint32_t ring = 0;
+
+  for (int part = 0; part < partCount; part++) {
+    const GEOSGeometry *subPolygon = isMulti ? GEOSGetGeometryN(geom, part) : geom;
+    int subRingCount = GEOSisEmpty(subPolygon) == 1 ? 0 : GEOSGetNumInteriorRings(subPolygon) + 1;
+
+    polygon->partOffsets[part] = ring;
+
+    for (int subRing = 0; subRing < subRingCount; subRing++) {
+      const GEOSGeometry *ringGeometry = subRing == 0 ? GEOSGetExteriorRing(subPolygon)
+                                         : GEOSGetInteriorRingN(subPolygon, subRing - 1);
+      const GEOSCoordSequence *sequence = GEOSGeom_getCoordSeq(ringGeometry);
+      unsigned int ringPointCount;
+
+      polygon->ringOffsets[ring] = point;
+
+      if (GEOSCoordSeq_getSize(sequence, &ringPointCount) == 0
+          || GEOSCoordSeq_copyToBuffer(sequence, polygon->coordinates + 2 * (size_t) point, 0, 0) == 0) {
+        fprintf(stderr, "Failed to extract points from linear ring geometry\n");
+        freeCompactPolygon(polygon);
+        return 1;
+      }
+
+      point += ringPointCount;
+      ring++;
+    }
+  }
+
+  polygon->ringOffsets[ring] = point;
+  polygon->partOffsets[partCount] = ring;
+
+  computeCompactPolygonEnvelope(polygon);
+
+  return 0;
+}
+
+[[nodiscard]] OGRGeometryH compactPolygonToOGR(const compactPolygon *polygon,
+    OGRSpatialReferenceH crs)
+{
+  OGRGeometryH geom = OGR_G_CreateGeometry(polygon->isMulti ? wkbMultiPolygon : wkbPolygon);
+  if (geom == NULL) {
+    fprintf(stderr, "Failed to create empty geometry\n");
+    return NULL;
+  }
+
+  for (uint32_t part = 0; part < polygon->partCount; part++) {
+    OGRGeometryH subPolygon = polygon->isMulti ? OGR_G_CreateGeometry(wkbPolygon) : geom;
+    if (subPolygon == NULL) {
+      fprintf(stderr, "Failed to create empty polygon\n");
+      OGR_G_DestroyGeometry(geom);
+      return NULL;
+    }
+
+    for (uint32_t ring = polygon->partOffsets[part]; ring < polygon->partOffsets[part + 1]; ring++) {
+      uint32_t ringPointCount = polygon->ringOffsets[ring + 1] - polygon->ringOffsets[ring];
+      const double *ringCoordinates = polygon->coordinates + 2 * (size_t) polygon->ringOffsets[ring];
+
+      OGRGeometryH ringGeometry = OGR_G_CreateGeometry(wkbLinearRing);
+      if (ringGeometry == NULL) {
+        fprintf(stderr, "Failed to create empty linear ring\n");
+        if (subPolygon != geom) {
+          OGR_G_DestroyGeometry(subPolygon);
+        }
+        OGR_G_DestroyGeometry(geom);
+        return NULL;
+      }
+
+      OGR_G_SetPoints(ringGeometry, (int) ringPointCount, ringCoordinates, 2 * sizeof(double),
+                      ringCoordinates + 1, 2 * sizeof(double), NULL, 0);
+      OGR_G_AddGeometryDirectly(subPolygon, ringGeometry);
+    }
+
+    if (subPolygon != geom) {
+      OGR_G_AddGeometryDirectly(geom, subPolygon);
+    }
+  }
+
+  if (crs != NULL) {
+    OGR_G_AssignSpatialReference(geom, crs);
+  }
+
+  return geom;
+}
+
+[[nodiscard]] GEOSGeometry *compactPolygonPartToGEOS(const compactPolygon *polygon, uint32_t part)
+{
+  uint32_t firstRing = polygon->partOffsets[part];
+  uint32_t ringCount = polygon->partOffsets[part + 1] - firstRing;
+
+  if (ringCount == 0) {
+    return GEOSGeom_createEmptyPolygon();
+  }
+
+  GEOSGeometry **rings = malloc(ringCount * sizeof(GEOSGeometry *));
+  if (rings == NULL) {
+    perror("malloc");
+    return NULL;
+  }
+
+  for (uint32_t ring = 0; ring < ringCount; ring++) {
+    uint32_t start = polygon->ringOffsets[firstRing + ring];
+    uint32_t ringPointCount = polygon->ringOffsets[firstRing + ring + 1] - start;
+
+    GEOSCoordSequence *sequence = GEOSCoordSeq_copyFromBuffer(polygon->coordinates + 2 * (size_t) start,
+                                  ringPointCount, 0, 0);
+    // ownership of sequence is taken by the ring, even on failure
+    rings[ring] = sequence == NULL ? NULL : GEOSGeom_createLinearRing(sequence);
+
+    if (rings[ring] == NULL) {
+      fprintf(stderr, "Failed to create linear ring\n");
+      for (uint32_t created = 0; created < ring; created++) {
+        GEOSGeom_destroy(rings[created]);
+      }
+      free(rings);
+      return NULL;
+    }
+  }
+
+  // ownership of all rings is taken by the polygon, but not of the array holding them
+  GEOSGeometry *geom = GEOSGeom_createPolygon(rings[0], rings + 1, ringCount - 1);
+  free(rings);
+
+  if (geom == NULL) {
+    fprintf(stderr, "Failed to create polygon\n");
+  }
+
+  return geom;
+}
+
+[[nodiscard]] GEOSGeometry *compactPolygonToGEOS(const compactPolygon *polygon)
+{
+  if (!polygon->isMulti) {
+    return compactPolygonPartToGEOS(polygon, 0);
+  }
+
+  GEOSGeometry **parts = malloc((polygon->partCount > 0 ? polygon->partCount : 1) * sizeof(
+                                  GEOSGeometry *));
+  if (parts == NULL) {
+    perror("malloc");
+    return NULL;
+  }
+
+  for (uint32_t part = 0; part < polygon->partCount; part++) {
+    parts[part] = compactPolygonPartToGEOS(polygon, part);
+
+    if (parts[part] == NULL) {
+      for (uint32_t created = 0; created < part; created++) {
+        GEOSGeom_destroy(parts[created]);
+      }
+      free(parts);
+      return NULL;
+    }
+  }
+
+  GEOSGeometry *geom = GEOSGeom_createCollection(GEOS_MULTIPOLYGON, parts, polygon->partCount);
+  free(parts);
+
+  if (geom == NULL) {
+    fprintf(stderr, "Failed to create multipolygon\n");
+  }
+
+  return geom;
+}
+
+int compactPolygonCentroid(const compactPolygon *polygon, double *x, double *y)
+{
+  if (polygon->pointCount == 0) {
+    return 1;
+  }
+
+  // coordinates are taken relative to the first point to limit cancellation, like GEOS does
+  const double baseX = polygon->coordinates[0];
+  const double baseY = polygon->coordinates[1];
+  double area = 0.0;
+  double momentX = 0.0;
+  double momentY = 0.0;
+
+  for (uint32_t part = 0; part < polygon->partCount; part++) {
+    for (uint32_t ring = polygon->partOffsets[part]; ring < polygon->partOffsets[part + 1]; ring++) {
+      double ringArea = 0.0;
+      double ringMomentX = 0.0;
+      double ringMomentY = 0.0;
+
+      for (uint32_t point = polygon->ringOffsets[ring]; point + 1 < polygon->ringOffsets[ring + 1];
+           point++) {
+        double x0 = polygon->coordinates[2 * (size_t) point] - baseX;
+        double y0 = polygon->coordinates[2 * (size_t) point + 1] - baseY;
+        double x1 = polygon->coordinates[2 * (size_t) point + 2] - baseX;
+        double y1 = polygon->coordinates[2 * (size_t) point + 3] - baseY;
+        double cross = x0 * y1 - x1 * y0;
+
+        ringArea += cross;
+        ringMomentX += (x0 + x1) * cross;
+        ringMomentY += (y0 + y1) * cross;
+      }
+
+      // exterior rings add to the area, interior rings subtract from it regardless of orientation
+      double sign = (ringArea < 0.0 ? -1.0 : 1.0) * (ring == polygon->partOffsets[part] ? 1.0 : -1.0);
+
+      area += sign * ringArea;
+      momentX += sign * ringMomentX;
+      momentY += sign * ringMomentY;
+    }
+  }
+
+  if (area == 0.0) {
+    return 1;
+  }
+
+  *x = baseX + momentX / (3.0 * area);
+  *y = baseY + momentY / (3.0 * area);
+
+  return 0;
+}
+
+int compactFootprintCentroid(const compactPolygon *footprint, double **scratch,
+                             size_t *scratchSize, double *x, double *y)
+{
+  // shifted coordinates are followed by the envelope of each part, i.e. min x, min y, max x, max y
+  size_t required = 2 * (size_t) footprint->pointCount + 4 * (size_t) footprint->partCount;
+
+  if (required > *scratchSize) {
+    double *grown = realloc(*scratch, required * sizeof(double));
+    if (grown == NULL) {
+      perror("realloc");
+      return 1;
+    }
+
+    *scratch = grown;
+    *scratchSize = required;
+  }
+
+  double *shifted = *scratch;
+  double *partEnvelopes = *scratch + 2 * (size_t) footprint->pointCount;
+
+  for (uint32_t part = 0; part < footprint->partCount; part++) {
+    double *envelope = partEnvelopes + 4 * (size_t) part;
+    envelope[0] = envelope[1] = DBL_MAX;
+    envelope[2] = envelope[3] = -DBL_MAX;
+
+    for (uint32_t ring = footprint->partOffsets[part]; ring < footprint->partOffsets[part + 1]; ring++) {
+      bool hasWestern = false;
+      bool hasEastern = false;
+
+      for (uint32_t point = footprint->ringOffsets[ring]; point < footprint->ringOffsets[ring + 1];
+           point++) {
+        double pointX = footprint->coordinates[2 * (size_t) point];
+        double pointY = footprint->coordinates[2 * (size_t) point + 1];
+
+        // vertices on the antimeridian itself don't tell on which side a ring lies
+        hasWestern |= pointX < 0.0 && pointX > -180.0;
+        hasEastern |= pointX > 0.0 && pointX < 180.0;
+
+        if (pointX < 0.0) {
+          pointX += 360.0;
+        }
+
+        shifted[2 * (size_t) point] = pointX;
+        shifted[2 * (size_t) point + 1] = pointY;
+
+        envelope[0] = fmin(envelope[0], pointX);
+        envelope[1] = fmin(envelope[1], pointY);
+        envelope[2] = fmax(envelope[2], pointX);
+        envelope[3] = fmax(envelope[3], pointY);
+      }
+
+      // a ring on both sides of the prime meridian is torn apart by the shift
+      if (hasWestern && hasEastern) {
+        return 1;
+      }
+    }
+  }
+
+  // parts only touching each other after the shift are merged by simply summing their moments
+  for (uint32_t first = 0; first < footprint->partCount; first++) {
+    const double *a = partEnvelopes + 4 * (size_t) first;
+
+    for (uint32_t second = first + 1; second < footprint->partCount; second++) {
+      const double *b = partEnvelopes + 4 * (size_t) second;
+
+      if (a[0] < b[2] && b[0] < a[2] && a[1] < b[3] && b[1] < a[3]) {
+        return 1;
+      }
+    }
+  }
+
+  compactPolygon view = *footprint;
+  view.coordinates = shifted;
+
+  return compactPolygonCentroid(&view, x, y);
+}
+
+int simplifyCompactPolygon(compactPolygon *polygon, double tolerance, double *areaChange)
+{
+  *areaChange = 0.0;
+
+  GEOSGeometry *original = compactPolygonToGEOS(polygon);
+  if (original == NULL) {
+    return 1;
+  }
+
+  // simplification moves vertices by at most `tolerance`, snapping by half of the grid size
+  GEOSGeometry *simplified = GEOSTopologyPreserveSimplify(original, tolerance);
+  GEOSGeometry *snapped = simplified == NULL ? NULL : GEOSGeom_setPrecision(simplified, tolerance, 0);
+  GEOSGeom_destroy(simplified);
+
+  double originalArea;
+  double snappedArea;
+
+  // features smaller than the grid collapse when snapped, those are kept as they are
+  if (snapped == NULL || GEOSisEmpty(snapped) != 0
+      || (GEOSGeomTypeId(snapped) != GEOS_POLYGON && GEOSGeomTypeId(snapped) != GEOS_MULTIPOLYGON)
+      || GEOSArea(original, &originalArea) == 0 || GEOSArea(snapped, &snappedArea) == 0
+      || originalArea <= 0.0 || snappedArea <= 0.0) {
+    GEOSGeom_destroy(snapped);
+    GEOSGeom_destroy(original);
+    return 1;
+  }
+
+  // any cell's share of the feature's area changes by at most the area of the symmetric difference
+  GEOSGeometry *difference = GEOSSymDifference(original, snapped);
+  double differenceArea;
+  compactPolygon replacement;
+
+  if (difference == NULL || GEOSArea(difference, &differenceArea) == 0
+      || compactPolygonFromGEOS(snapped, &replacement)) {
+    GEOSGeom_destroy(difference);
+    GEOSGeom_destroy(snapped);
+    GEOSGeom_destroy(original);
+    return 1;
+  }
+
+  GEOSGeom_destroy(difference);
+  GEOSGeom_destroy(snapped);
+  GEOSGeom_destroy(original);
+
+  freeCompactPolygon(polygon);
+  *polygon = replacement;
+  *areaChange = differenceArea / originalArea;
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+#ifndef POLYGON_STORE_H
+#define POLYGON_STORE_H
+/**
+ * @file polygon-store.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for the compact representation of AOI
+ *        polygons and conversions to OGR and GEOS geometries.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup polygon-store Compact Polygon Store
+ * @{
+ */
+
+#include "types.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <gdal/ogr_api.h>
+#include <gdal/ogr_srs_api.h>
+#include <geos_c.h>
+
+/**
+ * @brief Compute the size of the single allocation backing a compact polygon
+ *
+ * @param pointCount Number of points of all rings.
+ * @param ringCount Number of rings of all polygons.
+ * @param partCount Number of polygons.
+ * @return size_t Size in bytes.
+ */
+size_t compactPolygonBlockSize(uint32_t pointCount, uint32_t ringCount, uint32_t partCount);
+
+/**
+ * @brief Allocate storage of a compact polygon and set up pointers into it
+ *
+ * @note The polygon must be freed with freeCompactPolygon().
+ *
+ * @param polygon Polygon whose counts and pointers are set.
+ * @param pointCount Number of points of all rings.
+ * @param ringCount Number of rings of all polygons.
+ * @param partCount Number of polygons.
+ * @return int 0 on success, 1 on error.
+ */
+int allocateCompactPolygon(compactPolygon *polygon, uint32_t pointCount, uint32_t ringCount,
+                           uint32_t partCount);
+
+/**
+ * @brief Copy the coordinates of an OGR polygon or multipolygon into a compact polygon
+ *
+ * @details Only x and y coordinates are kept. The envelope is computed while copying.
+ *
+ * @param geom Polygon or multipolygon, possibly 2.5D.
+ * @param polygon Polygon which is filled by this function.
+ * @return int 0 on success, 1 on error or unsupported geometry type.
+ */
+int compactPolygonFromOGR(const OGRGeometryH geom, compactPolygon *polygon);
+
+/**
+ * @brief Compute the envelope of a compact polygon from its coordinates
+ *
+ * @param polygon Polygon whose envelope is set.
+ */
+void computeCompactPolygonEnvelope(compactPolygon *polygon);
+
+/**
+ * @brief Copy the coordinates of a GEOS polygon or multipolygon into a compact polygon
+ *
+ * @details Only x and y coordinates are kept. The envelope is computed while copying.
+ *
+ * @param geom Polygon or multipolygon.
+ * @param polygon Polygon which is filled by this function.
+ * @return int 0 on success, 1 on error or unsupported geometry type.
+ */
+int compactPolygonFromGEOS(const GEOSGeometry *geom, compactPolygon *polygon);
+
+/**
+ * @brief Build an OGR geometry from a compact polygon
+ *
+ * @details Only needed by code paths relying on OGR, e.g. merging footprints split at the antimeridian.
+ *
+ * @note After the function returns, the caller owns the returned geometry and must destroy it after use.
+ *
+ * @param polygon Compact polygon.
+ * @param crs Spatial reference assigned to the geometry, possibly NULL.
+ * @return OGRGeometryH Polygon or multipolygon, NULL on error.
+ */
+[[nodiscard]] OGRGeometryH compactPolygonToOGR(const compactPolygon *polygon,
+    OGRSpatialReferenceH crs);
+
+/**
+ * @brief Build a GEOS polygon from a single part of a compact polygon
+ *
+ * @note After the function returns, the caller owns the returned geometry and must destroy it after use.
+ *
+ * @param polygon Compact polygon.
+ * @param part Index of part to build.
+ * @return GEOSGeometry* Polygon, NULL on error.
+ */
+[[nodiscard]] GEOSGeometry *compactPolygonPartToGEOS(const compactPolygon *polygon, uint32_t part);
+
+/**
+ * @brief Build a GEOS geometry from a compact polygon
+ *
+ * @details Coordinates are copied into GEOS coordinate sequences directly, i.e. without an
+ *          intermediate WKB representation.
+ *
+ * @note After the function returns, the caller owns the returned geometry and must destroy it after use.
+ *
+ * @param polygon Compact polygon.
+ * @return GEOSGeometry* Polygon or multipolygon, NULL on error.
+ */
+[[nodiscard]] GEOSGeometry *compactPolygonToGEOS(const compactPolygon *polygon);
+
+/**
+ * @brief Compute the planar centroid of a compact polygon
+ *
+ * @details The centroid is weighted by area, interior rings are subtracted. This matches the
+ *          centroid computed by GEOS and OGR for polygonal geometries.
+ *
+ * @param polygon Compact polygon.
+ * @param x Set to the x coordinate of the centroid.
+ * @param y Set to the y coordinate of the centroid.
+ * @return int 0 on success, 1 if the polygon has no area.
+ */
+int compactPolygonCentroid(const compactPolygon *polygon, double *x, double *y);
+
+/**
+ * @brief Compute the centroid of a footprint split at the antimeridian without merging its parts
+ *
+ * @details Like mergeFootprintSplitAtDateline(), vertices west of 0° are shifted by +360°. The
+ *          shifted coordinates are written to a scratch buffer reused across calls, the centroid is
+ *          computed from them with compactPolygonCentroid(). This is only valid if parts merely touch
+ *          each other after the shift.
+ *
+ * @param footprint Multipolygon split at the antimeridian.
+ * @param scratch Indirect reference to scratch buffer, possibly NULL, grown as needed. Must be freed by the caller.
+ * @param scratchSize Number of doubles the scratch buffer holds.
+ * @param x Set to the x coordinate of the centroid, possibly beyond +180°.
+ * @param y Set to the y coordinate of the centroid.
+ * @return int 0 on success, 1 if parts overlap, a ring crosses the prime meridian, the footprint has
+ *         no area or the scratch buffer couldn't be grown. The parts must be merged in that case.
+ */
+int compactFootprintCentroid(const compactPolygon *footprint, double **scratch,
+                             size_t *scratchSize, double *x, double *y);
+
+/**
+ * @brief Simplify a compact polygon and snap its vertices to a grid
+ *
+ * @details Vertices are removed with a topology-preserving simplification first, the result is
+ *          snapped to a precision grid of size `tolerance` afterwards. The area of the symmetric
+ *          difference between both geometries, relative to the area of the original one, bounds
+ *          the change of area weights computed for the feature.
+ *
+ * @note The polygon is kept unchanged if it would collapse or if GEOS fails to simplify it.
+ *
+ * @param polygon Polygon replaced by its simplified version.
+ * @param tolerance Simplification tolerance and grid size in units of the polygon's CRS.
+ * @param areaChange Set to the relative area of the symmetric difference, 0 if the polygon is kept.
+ * @return int 0 if the polygon was simplified, 1 if it was kept unchanged.
+ */
+int simplifyCompactPolygon(compactPolygon *polygon, double tolerance, double *areaChange);
+
+/** @} */ // end of group
+#endif // POLYGON_STORE_H
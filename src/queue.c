@@ -0,0 +1,127 @@
+#include "queue.h"
+#include "types.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int queueInit(boundedQueue *queue, size_t capacity)
+{
+  if (queue == NULL || capacity == 0) {
+    return 1;
+  }
+
+  queue->items = calloc(capacity, sizeof(void *));
+  if (queue->items == NULL) {
+    perror("calloc");
+    return 1;
+  }
+
+  queue->capacity = capacity;
+  queue->head = 0;
+  queue->count = 0;
+  queue->closed = false;
+
+  if (pthread_mutex_init(&queue->lock, NULL) != 0) {
+    fprintf(stderr, "Failed to initialize queue mutex\n");
+    free(queue->items);
+    return 1;
+  }
+
+  if (pthread_cond_init(&queue->notEmpty, NULL) != 0) {
+    fprintf(stderr, "Failed to initialize queue condition variable\n");
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->items);
+    return 1;
+  }
+
+  if (pthread_cond_init(&queue->notFull, NULL) != 0) {
+    fprintf(stderr, "Failed to initialize queue condition variable\n");
+    pthread_cond_destroy(&queue->notEmpty);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->items);
+    return 1;
+  }
+
+  return 0;
+}
+
+int queuePush(boundedQueue *queue, void *item)
+{
+  pthread_mutex_lock(&queue->lock);
+
+  while (queue->count == queue->capacity && !queue->closed) {
+    pthread_cond_wait(&queue->notFull, &queue->lock);
+  }
+
+  if (queue->closed) {
+    pthread_mutex_unlock(&queue->lock);
+    return 1;
+  }
+
+  queue->items[(queue->head + queue->count) % queue->capacity] = item;
+  queue->count++;
+
+  pthread_cond_signal(&queue->notEmpty);
+  pthread_mutex_unlock(&queue->lock);
+
+  return 0;
+}
+
+void *queuePop(boundedQueue *queue)
+{
+  pthread_mutex_lock(&queue->lock);
+
+  while (queue->count == 0 && !queue->closed) {
+    pthread_cond_wait(&queue->notEmpty, &queue->lock);
+  }
+
+  if (queue->count == 0) {
+    // closed and drained
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+  }
+
+  void *item = queue->items[queue->head];
+  queue->head = (queue->head + 1) % queue->capacity;
+  queue->count--;
+
+  pthread_cond_signal(&queue->notFull);
+  pthread_mutex_unlock(&queue->lock);
+
+  return item;
+}
+
+int queueWaitForSpace(boundedQueue *queue)
+{
+  pthread_mutex_lock(&queue->lock);
+
+  while (queue->count == queue->capacity && !queue->closed) {
+    pthread_cond_wait(&queue->notFull, &queue->lock);
+  }
+
+  bool closed = queue->closed;
+
+  pthread_mutex_unlock(&queue->lock);
+
+  return closed ? 1 : 0;
+}
+
+void queueClose(boundedQueue *queue)
+{
+  pthread_mutex_lock(&queue->lock);
+  queue->closed = true;
+  pthread_cond_broadcast(&queue->notEmpty);
+  pthread_cond_broadcast(&queue->notFull);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+void queueDestroy(boundedQueue *queue)
+{
+  pthread_cond_destroy(&queue->notFull);
+  pthread_cond_destroy(&queue->notEmpty);
+  pthread_mutex_destroy(&queue->lock);
+  free(queue->items);
+  queue->items = NULL;
+}
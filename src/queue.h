@@ -0,0 +1,81 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+/**
+ * @file queue.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures of a bounded, thread-safe FIFO queue.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup queue Bounded Queue
+ * @{
+ */
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Initialize a bounded queue in place
+ *
+ * @note After the function returns successfully, the caller must destroy the queue with queueDestroy().
+ *
+ * @param queue Reference to queue object.
+ * @param capacity Maximum number of items held by the queue at any time, must be greater than 0.
+ * @return int 0 on success, 1 on error.
+ */
+int queueInit(boundedQueue *queue, size_t capacity);
+
+/**
+ * @brief Append an item to the queue, blocking while the queue is full
+ *
+ * @note No ownership of `item` is taken by the queue, it's merely passed on to the consumer.
+ *
+ * @param queue Reference to initialized queue.
+ * @param item Item to append, must not be NULL.
+ * @return int 0 on success, 1 if the queue was closed before the item could be appended.
+ */
+int queuePush(boundedQueue *queue, void *item);
+
+/**
+ * @brief Remove the oldest item from the queue, blocking while the queue is empty
+ *
+ * @param queue Reference to initialized queue.
+ * @return void* Oldest item, NULL if the queue is closed and drained.
+ */
+void *queuePop(boundedQueue *queue);
+
+/**
+ * @brief Block until the queue can accept another item
+ *
+ * @details This allows a single producer to delay expensive work (e.g. reading a dataset) until
+ *          the result can actually be handed off, thus limiting the number of items alive at once.
+ *
+ * @param queue Reference to initialized queue.
+ * @return int 0 if space is available, 1 if the queue was closed while waiting.
+ */
+int queueWaitForSpace(boundedQueue *queue);
+
+/**
+ * @brief Close the queue
+ *
+ * @details After closing, pushing is no longer possible while remaining items can still be popped.
+ *          All blocked producers and consumers are woken up.
+ *
+ * @param queue Reference to initialized queue.
+ */
+void queueClose(boundedQueue *queue);
+
+/**
+ * @brief Destroy synchronization primitives and storage of the queue
+ *
+ * @note Items still in the queue are not freed.
+ *
+ * @param queue Reference to initialized queue.
+ */
+void queueDestroy(boundedQueue *queue);
+
+/** @} */ // end of group
+#endif // QUEUE_H
@@ -0,0 +1,358 @@
+#define _POSIX_C_SOURCE 200809L
+#include "series-store.h"
+#include "math-utils.h"
+#include "output-store.h"
+#include "paths.h"
+#include "types.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <gdal/ogr_core.h>
+
+[[nodiscard]] char *seriesPathOfYear(const char *outputDirectory, int year)
+{
+  return constructFilePath("%s/WVP_%.4d" SERIES_EXTENSION, outputDirectory, year);
+}
+
+off_t seriesOffset(uint64_t featureCount, uint64_t position)
+{
+  return (off_t) (sizeof(struct storeHeader) + featureCount * sizeof(struct storeFeature)
+                  + position * STORE_DAY_SLOTS * sizeof(double));
+}
+
+int readStoreColumns(int fd, uint64_t featureCount, const uint64_t *index, size_t firstColumn,
+                     size_t columnCount, double *row, double *series)
+{
+  for (size_t slot = 0; slot < STORE_DAY_SLOTS; slot++) {
+    // days which were never written are holes in the store, skip reading them
+    if (index[slot] == 0) {
+      for (size_t column = 0; column < columnCount; column++) {
+        series[column * STORE_DAY_SLOTS + slot] = NAN;
+      }
+
+      continue;
+    }
+
+    if (preadFully(fd, row, columnCount * sizeof(double),
+                   storeMatrixOffset(featureCount) + (off_t) ((slot * featureCount + firstColumn) * sizeof(double)))) {
+      fprintf(stderr, "Failed to read day slot %lu of output store\n", slot);
+      return 1;
+    }
+
+    for (size_t column = 0; column < columnCount; column++) {
+      series[column * STORE_DAY_SLOTS + slot] = row[column];
+    }
+  }
+
+  return 0;
+}
+
+int writeSeriesStore(const char *storePath, const char *outputDirectory)
+{
+  int storeFd = open(storePath, O_RDONLY);
+  if (storeFd < 0) {
+    perror("open");
+    return 1;
+  }
+
+  struct storeHeader header;
+
+  if (readStoreHeader(storeFd, storePath, &header)) {
+    close(storeFd);
+    return 1;
+  }
+
+  uint64_t featureCount = header.featureCount;
+  size_t allocationCount = featureCount > 0 ? featureCount : 1;
+  struct storeFeature *table = malloc(allocationCount * sizeof(struct storeFeature));
+  struct storeFeature *sortedTable = malloc(allocationCount * sizeof(struct storeFeature));
+  struct curveKey *keys = malloc(allocationCount * sizeof(struct curveKey));
+  uint64_t *ranks = malloc(allocationCount * sizeof(uint64_t));
+  uint64_t *index = malloc(STORE_DAY_SLOTS * sizeof(uint64_t));
+  double *row = malloc(SERIES_BLOCK_FEATURES * sizeof(double));
+  double *series = malloc(SERIES_BLOCK_FEATURES * STORE_DAY_SLOTS * sizeof(double));
+  char *seriesPath = seriesPathOfYear(outputDirectory, (int) header.year);
+  char *temporaryPath = seriesPath == NULL ? NULL : constructFilePath("%s.%d.tmp", seriesPath,
+                        (int) getpid());
+
+  bool failed = table == NULL || sortedTable == NULL || keys == NULL || ranks == NULL || index == NULL
+                || row == NULL || series == NULL || temporaryPath == NULL;
+
+  if (failed) {
+    fprintf(stderr, "Failed to allocate memory to transpose output store %s\n", storePath);
+  } else if (preadFully(storeFd, table, featureCount * sizeof(struct storeFeature),
+                        (off_t) sizeof(struct storeHeader))
+             || preadFully(storeFd, index, STORE_DAY_SLOTS * sizeof(uint64_t), storeIndexOffset(featureCount))) {
+    fprintf(stderr, "Failed to read output store %s\n", storePath);
+    failed = true;
+  }
+
+  uint64_t knownCount = 0;
+
+  if (!failed) {
+    // FIDs are signed, flipping the sign bit keeps their order when they're compared unsigned
+    for (uint64_t i = 0; i < featureCount; i++) {
+      ranks[i] = UINT64_MAX;
+
+      if (table[i].fid != OGRNullFID) {
+        keys[knownCount] = (struct curveKey) {.key = (uint64_t) table[i].fid ^ (UINT64_C(1) << 63), .index = i};
+        knownCount++;
+      }
+    }
+
+    qsort(keys, knownCount, sizeof(struct curveKey), curveKeyCmp);
+
+    for (uint64_t rank = 0; rank < knownCount; rank++) {
+      ranks[keys[rank].index] = rank;
+      sortedTable[rank] = table[keys[rank].index];
+    }
+  }
+
+  int fd = failed ? -1 : open(temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (!failed && fd < 0) {
+    perror("open");
+    failed = true;
+  }
+
+  struct storeHeader seriesHeader = header;
+  memcpy(seriesHeader.magic, SERIES_MAGIC, STORE_MAGIC_SIZE);
+  seriesHeader.featureCount = knownCount;
+
+  failed = failed
+           || pwriteFully(fd, &seriesHeader, sizeof(struct storeHeader), 0)
+           || pwriteFully(fd, sortedTable, knownCount * sizeof(struct storeFeature),
+                          (off_t) sizeof(struct storeHeader));
+
+  for (size_t firstColumn = 0; firstColumn < featureCount && !failed; firstColumn += SERIES_BLOCK_FEATURES) {
+    size_t columnCount = featureCount - firstColumn < SERIES_BLOCK_FEATURES
+                         ? featureCount - firstColumn
+                         : SERIES_BLOCK_FEATURES;
+
+    if (readStoreColumns(storeFd, featureCount, index, firstColumn, columnCount, row, series)) {
+      failed = true;
+      break;
+    }
+
+    // columns whose ranks are consecutive as well are written with a single call, which is the
+    // common case of FIDs ascending in layer order
+    size_t runStart = 0;
+    size_t runLength = 0;
+
+    for (size_t column = 0; column <= columnCount && !failed; column++) {
+      uint64_t rank = column < columnCount ? ranks[firstColumn + column] : UINT64_MAX;
+
+      if (runLength > 0 && rank == ranks[firstColumn + runStart] + runLength) {
+        runLength++;
+        continue;
+      }
+
+      if (runLength > 0) {
+        failed = pwriteFully(fd, series + runStart * STORE_DAY_SLOTS,
+                             runLength * STORE_DAY_SLOTS * sizeof(double),
+                             seriesOffset(knownCount, ranks[firstColumn + runStart]));
+      }
+
+      runStart = column;
+      runLength = rank == UINT64_MAX ? 0 : 1;
+    }
+  }
+
+  if (fd >= 0 && (close(fd) != 0 || failed)) {
+    fprintf(stderr, "Failed to write series store %s\n", seriesPath);
+    unlink(temporaryPath);
+    failed = true;
+  } else if (!failed && rename(temporaryPath, seriesPath) != 0) {
+    perror("rename");
+    unlink(temporaryPath);
+    failed = true;
+  }
+
+  if (!failed) {
+    printf("Wrote time series of %lu features to %s\n", knownCount, seriesPath);
+  }
+
+  close(storeFd);
+  free(table);
+  free(sortedTable);
+  free(keys);
+  free(ranks);
+  free(index);
+  free(row);
+  free(series);
+  free(seriesPath);
+  free(temporaryPath);
+
+  return failed ? 1 : 0;
+}
+
+int findSeriesFeature(int fd, uint64_t featureCount, GIntBig fid, struct storeFeature *feature,
+                      uint64_t *position)
+{
+  uint64_t low = 0;
+  uint64_t high = featureCount;
+
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+
+    if (preadFully(fd, feature, sizeof(struct storeFeature),
+                   (off_t) (sizeof(struct storeHeader) + middle * sizeof(struct storeFeature)))) {
+      return 1;
+    }
+
+    if (feature->fid == fid) {
+      *position = middle;
+      return 0;
+    }
+
+    if (feature->fid < fid) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return 1;
+}
+
+int nearestSeriesFeature(int fd, uint64_t featureCount, double longitude, double latitude,
+                         struct storeFeature *feature, uint64_t *position)
+{
+  struct storeFeature *table = malloc((featureCount > 0 ? featureCount : 1) * sizeof(struct storeFeature));
+  if (table == NULL) {
+    perror("malloc");
+    return 1;
+  }
+
+  if (preadFully(fd, table, featureCount * sizeof(struct storeFeature), (off_t) sizeof(struct storeHeader))) {
+    free(table);
+    return 1;
+  }
+
+  double closest = INFINITY;
+
+  for (uint64_t i = 0; i < featureCount; i++) {
+    // longitudes are cyclic, see cyclicCellGeometry
+    double dx = fmod(fabs(table[i].x - longitude), 360.0);
+    dx = dx > 180.0 ? 360.0 - dx : dx;
+    double dy = table[i].y - latitude;
+    double distance = dx * dx + dy * dy;
+
+    if (distance < closest) {
+      closest = distance;
+      *feature = table[i];
+      *position = i;
+    }
+  }
+
+  free(table);
+
+  return isinf(closest) ? 1 : 0;
+}
+
+int querySeriesOfYear(const option_t *options, int year, bool *found)
+{
+  *found = false;
+
+  char *seriesPath = seriesPathOfYear(options->outputDirectory, year);
+  if (seriesPath == NULL) {
+    fprintf(stderr, "Failed to construct path of series store\n");
+    return 1;
+  }
+
+  int fd = open(seriesPath, O_RDONLY);
+  if (fd < 0) {
+    int status = errno == ENOENT ? 0 : 1;
+
+    if (status != 0) {
+      perror("open");
+    }
+
+    free(seriesPath);
+    return status;
+  }
+
+  struct storeHeader header;
+
+  if (preadFully(fd, &header, sizeof(struct storeHeader), 0)
+      || memcmp(header.magic, SERIES_MAGIC, STORE_MAGIC_SIZE) != 0
+      || header.daySlots != STORE_DAY_SLOTS) {
+    fprintf(stderr, "'%s' is not a series store of this version\n", seriesPath);
+    close(fd);
+    free(seriesPath);
+    return 1;
+  }
+
+  struct storeFeature feature;
+  uint64_t position;
+  bool located = options->queryByFid
+                 ? findSeriesFeature(fd, header.featureCount, options->queryFid, &feature, &position) == 0
+                 : nearestSeriesFeature(fd, header.featureCount, options->queryLongitude,
+                                        options->queryLatitude, &feature, &position) == 0;
+
+  if (!located) {
+    close(fd);
+    free(seriesPath);
+    return 0;
+  }
+
+  double values[STORE_DAY_SLOTS];
+
+  if (preadFully(fd, values, sizeof(values), seriesOffset(header.featureCount, position))) {
+    fprintf(stderr, "Failed to read time series from %s\n", seriesPath);
+    close(fd);
+    free(seriesPath);
+    return 1;
+  }
+
+  close(fd);
+  free(seriesPath);
+
+  for (int slot = 0; slot < STORE_DAY_SLOTS; slot++) {
+    int month = slot / 31 + 1;
+    int day = slot % 31 + 1;
+    int date = year * 10000 + month * 100 + day;
+
+    // slots of invalid dates such as February 30th are never written and hold NaN as well
+    if (date < options->queryFrom || date > options->queryTo || isnan(values[slot])) {
+      continue;
+    }
+
+    printf("%.4d-%.2d-%.2d %lld %.4lf %.4lf %.10lf\n", year, month, day, (long long) feature.fid,
+           feature.x, feature.y, kgsqmTocow(values[slot]));
+  }
+
+  *found = true;
+
+  return 0;
+}
+
+int querySeries(const option_t *options)
+{
+  bool foundAny = false;
+
+  for (int year = options->queryFrom / 10000; year <= options->queryTo / 10000; year++) {
+    bool found = false;
+
+    if (querySeriesOfYear(options, year, &found)) {
+      return 1;
+    }
+
+    foundAny = foundAny || found;
+  }
+
+  if (!foundAny) {
+    fprintf(stderr, "Feature not found in any series store of %s between %d and %d\n",
+            options->outputDirectory, options->queryFrom / 10000, options->queryTo / 10000);
+    return 1;
+  }
+
+  return 0;
+}
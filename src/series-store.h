@@ -0,0 +1,134 @@
+#ifndef SERIES_STORE_H
+#define SERIES_STORE_H
+/**
+ * @file series-store.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for a feature-major copy of output stores
+ *        and querying time series of single features from it.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup series-store Series Store
+ * @{
+ */
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/// Magic bytes at the start of a series store, the last byte being the format version
+#define SERIES_MAGIC "HAZESER\001"
+
+/// File extension of series stores
+#define SERIES_EXTENSION ".hzt"
+
+/// Number of features transposed at once, bounds the memory used to STORE_DAY_SLOTS doubles each
+#define SERIES_BLOCK_FEATURES 4096
+
+/**
+ * @brief Construct the path of the series store of a year
+ *
+ * @note The caller must free the returned string.
+ *
+ * @param outputDirectory Directory series stores are written to.
+ * @param year Year of the store.
+ * @return char* Path of the store, NULL on error.
+ */
+[[nodiscard]] char *seriesPathOfYear(const char *outputDirectory, int year);
+
+/**
+ * @brief Compute the offset of the time series at a position of the index of a series store
+ *
+ * @param featureCount Number of features of the store.
+ * @param position Position of the feature in the index.
+ * @return off_t Offset of the first value of the time series.
+ */
+off_t seriesOffset(uint64_t featureCount, uint64_t position);
+
+/**
+ * @brief Read a block of columns of an output store
+ *
+ * @details Only rows of days present in the store are read, others are set to NaN.
+ *
+ * @param fd File descriptor of output store.
+ * @param featureCount Number of features of the store.
+ * @param index Index of the store.
+ * @param firstColumn First column to read.
+ * @param columnCount Number of columns to read.
+ * @param row Buffer of at least `columnCount` doubles.
+ * @param series Buffer of `columnCount` x STORE_DAY_SLOTS doubles, set to the time series of each column.
+ * @return int 0 on success, 1 on error.
+ */
+int readStoreColumns(int fd, uint64_t featureCount, const uint64_t *index, size_t firstColumn,
+                     size_t columnCount, double *row, double *series);
+
+/**
+ * @brief Write the feature-major copy of an output store
+ *
+ * @details The series store holds the same header as the output store, the features table sorted by
+ *          FID and the time series of each feature in the same order. Features which never had a
+ *          value are left out. The output store is transposed in blocks of SERIES_BLOCK_FEATURES
+ *          columns, the result is moved into place after it was written completely.
+ *
+ * @param storePath Path to output store.
+ * @param outputDirectory Directory the series store is written to.
+ * @return int 0 on success, 1 on error.
+ */
+int writeSeriesStore(const char *storePath, const char *outputDirectory);
+
+/**
+ * @brief Find a feature in the index of a series store by its FID
+ *
+ * @details The sorted index is searched on disk, thus only a few entries are read.
+ *
+ * @param fd File descriptor of series store.
+ * @param featureCount Number of features of the store.
+ * @param fid FID to search.
+ * @param feature Set to the index entry of the feature.
+ * @param position Set to the position of the feature in the index.
+ * @return int 0 if the feature was found, 1 otherwise.
+ */
+int findSeriesFeature(int fd, uint64_t featureCount, GIntBig fid, struct storeFeature *feature,
+                      uint64_t *position);
+
+/**
+ * @brief Find the feature whose centroid is closest to a location in a series store
+ *
+ * @param fd File descriptor of series store.
+ * @param featureCount Number of features of the store.
+ * @param longitude Longitude of location.
+ * @param latitude Latitude of location.
+ * @param feature Set to the index entry of the closest feature.
+ * @param position Set to the position of the feature in the index.
+ * @return int 0 if a feature was found, 1 otherwise.
+ */
+int nearestSeriesFeature(int fd, uint64_t featureCount, double longitude, double latitude,
+                         struct storeFeature *feature, uint64_t *position);
+
+/**
+ * @brief Print the time series of the queried feature within one year
+ *
+ * @param options Pointer to option_t struct, holding the query.
+ * @param year Year to query.
+ * @param found Set to true if the feature is part of the year's series store.
+ * @return int 0 on success, also if the store doesn't exist, 1 on error.
+ */
+int querySeriesOfYear(const option_t *options, int year, bool *found);
+
+/**
+ * @brief Print the time series of a feature from the series stores in the output directory
+ *
+ * @details Each line holds the date, FID, centroid and water vapor of a day in the queried range.
+ *          Days without a value are left out.
+ *
+ * @param options Pointer to option_t struct, holding the query.
+ * @return int 0 on success, 1 on error or if the feature wasn't found in any store.
+ */
+int querySeries(const option_t *options);
+
+/** @} */ // end of group
+#endif // SERIES_STORE_H
@@ -1,6 +1,9 @@
 #include "strtree.h"
 #include "haze.h"
 #include "gdal-ops.h"
+#include "manifest.h"
+#include "math-utils.h"
+#include "polygon-store.h"
 #include "types.h"
 #include <float.h>
 #include <gdal/cpl_conv.h>
@@ -12,18 +15,197 @@
 #include <gdal/ogr_core.h>
 #include <gdal/ogr_srs_api.h>
 #include <geos_c.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+int readPrecomputedCentroidFields(OGRFeatureH feature, const char *filePath, double *longitude,
+                                  double *latitude)
+{
+  int longitudeFieldIndex = OGR_F_GetFieldIndex(feature, "longitude");
+  int latitudeFieldIndex = OGR_F_GetFieldIndex(feature, "latitude");
+
+  if (longitudeFieldIndex == -1 || latitudeFieldIndex == -1) {
+    fprintf(stderr, "Failed to get field indices for longitude and latitude from %s\n", filePath);
+    return 1;
+  }
+
+  OGRFeatureDefnH featureDefinition = OGR_F_GetDefnRef(feature);
+
+  OGRFieldDefnH longitudeFieldDefinition = OGR_FD_GetFieldDefn(featureDefinition,
+      longitudeFieldIndex);
+  OGRFieldDefnH latitudeFieldDefinition = OGR_FD_GetFieldDefn(featureDefinition, latitudeFieldIndex);
+
+  if (longitudeFieldDefinition == NULL || latitudeFieldDefinition == NULL) {
+    fprintf(stderr, "Tried to query field definition with invalid index\n");
+    return 1;
+  }
+
+  if (!OGR_F_IsFieldSet(feature, longitudeFieldIndex)
+      || OGR_F_IsFieldNull(feature, longitudeFieldIndex)
+      || OGR_Fld_GetType(longitudeFieldDefinition) != OFTReal) {
+    fprintf(stderr, "longitude field is either not set, NULL or not of type double\n");
+    return 1;
+  }
+
+  if (!OGR_F_IsFieldSet(feature, latitudeFieldIndex)
+      || OGR_F_IsFieldNull(feature, latitudeFieldIndex)
+      || OGR_Fld_GetType(latitudeFieldDefinition) != OFTReal) {
+    fprintf(stderr, "latitude field is either not set, NULL or not of type double\n");
+    return 1;
+  }
+
+  *longitude = OGR_F_GetFieldAsDouble(feature, longitudeFieldIndex);
+  *latitude = OGR_F_GetFieldAsDouble(feature, latitudeFieldIndex);
+
+  return 0;
+}
+
+int readAcquisitionHour(OGRFeatureH feature, int fieldIndex, double *hour)
+{
+  *hour = NAN;
+
+  if (!OGR_F_IsFieldSet(feature, fieldIndex) || OGR_F_IsFieldNull(feature, fieldIndex)) {
+    return 0;
+  }
+
+  int year;
+  int month;
+  int day;
+  int hours;
+  int minutes;
+  float seconds;
+  int timeZone;
+
+  if (!OGR_F_GetFieldAsDateTimeEx(feature, fieldIndex, &year, &month, &day, &hours, &minutes, &seconds,
+                                  &timeZone)) {
+    return 1;
+  }
+
+  double utc = hours + minutes / 60.0 + seconds / 3600.0;
+
+  // OGR encodes offsets in steps of 15 minutes relative to 100 (UTC), 0 and 1 denote unknown and
+  // local time which are taken as UTC
+  if (timeZone > 1) {
+    utc -= (timeZone - 100) / 4.0;
+  }
+
+  *hour = fmod(utc + 24.0, 24.0);
+
+  return 0;
+}
+
+int readAcquisitionTimes(const char *filePath, const char *layerName, const char *fieldName,
+                         vectorGeometryVector *geometries)
+{
+  GDALDatasetH vectorDataset = openVectorDataset(filePath);
+  if (vectorDataset == NULL) {
+    return 1;
+  }
+
+  OGRLayerH layer = openVectorLayer(vectorDataset, layerName);
+  if (layer == NULL) {
+    fprintf(stderr, "Failed to get vector layer: %s", CPLGetLastErrorMsg());
+    closeGDALDataset(vectorDataset);
+    return 1;
+  }
+
+  int fieldIndex = OGR_FD_GetFieldIndex(OGR_L_GetLayerDefn(layer), fieldName);
+  OGRFieldDefnH fieldDefinition = fieldIndex < 0 ? NULL : OGR_FD_GetFieldDefn(OGR_L_GetLayerDefn(layer),
+                                  fieldIndex);
+
+  if (fieldDefinition == NULL
+      || (OGR_Fld_GetType(fieldDefinition) != OFTDateTime && OGR_Fld_GetType(fieldDefinition) != OFTTime)) {
+    fprintf(stderr, "Field '%s' is either missing from %s or not of type date-time or time\n", fieldName,
+            filePath);
+    closeGDALDataset(vectorDataset);
+    return 1;
+  }
+
+  // features are looked up by FID, geometries were sorted along a curve in the meantime
+  struct curveKey *keys = malloc((geometries->size > 0 ? geometries->size : 1) * sizeof(struct curveKey));
+  if (keys == NULL) {
+    perror("malloc");
+    closeGDALDataset(vectorDataset);
+    return 1;
+  }
+
+  for (size_t i = 0; i < geometries->size; i++) {
+    geometries->entries[i].acquisitionHour = NAN;
+    keys[i] = (struct curveKey) {.key = (uint64_t) geometries->entries[i].id ^ (UINT64_C(1) << 63), .index = i};
+  }
+
+  qsort(keys, geometries->size, sizeof(struct curveKey), curveKeyCmp);
+
+  // only attributes are needed, which saves parsing geometries for most drivers
+  const char *ignoredFields[] = {"OGR_GEOMETRY", NULL};
+  OGR_L_SetIgnoredFields(layer, ignoredFields);
+
+  bool failed = false;
+  size_t matchedCount = 0;
+  size_t timedCount = 0;
+
+  OGR_FOR_EACH_FEATURE_BEGIN(feature, layer) {
+    struct curveKey key = {.key = (uint64_t) OGR_F_GetFID(feature) ^ (UINT64_C(1) << 63)};
+    struct curveKey *match = bsearch(&key, keys, geometries->size, sizeof(struct curveKey), curveKeySearchCmp);
+
+    if (match == NULL) {
+      // the feature was left out by the spatial filter
+      continue;
+    }
+
+    matchedCount++;
+
+    struct vectorGeometry *entry = &geometries->entries[match->index];
+
+    if (readAcquisitionHour(feature, fieldIndex, &entry->acquisitionHour)) {
+      fprintf(stderr, "Failed to read acquisition time of feature with FID %lld\n", (long long) entry->id);
+      failed = true;
+      break;
+    }
+
+    if (!isnan(entry->acquisitionHour)) {
+      // manifests have to notice changed times just like changed geometries
+      entry->hash = fnv1a(&entry->acquisitionHour, sizeof(double), entry->hash);
+      timedCount++;
+    }
+  }
+  OGR_FOR_EACH_FEATURE_END(feature);
+
+  free(keys);
+  closeGDALDataset(vectorDataset);
+
+  if (failed) {
+    return 1;
+  }
+
+  // every geometry was read from this layer, thus a feature which isn't found means FIDs changed
+  if (matchedCount != geometries->size) {
+    fprintf(stderr, "%lu of %lu features of %s weren't found by FID when reading acquisition times\n",
+            geometries->size - matchedCount, geometries->size, filePath);
+    return 1;
+  }
+
+  printf("Read acquisition times of %lu of %lu features, %lu without time are assigned the daily mean\n",
+         timedCount, geometries->size, geometries->size - timedCount);
+
+  return 0;
+}
+
 [[nodiscard]] vectorGeometryVector *buildGEOSGeometriesFromFile(const char *filePath,
     const char *layerName,
     const char *inputReferenceSystem,
-    bool readPrecomputedCentroid)
+    bool readPrecomputedCentroid,
+    int threads,
+    const OGREnvelope *spatialFilter,
+    double simplifyTolerance)
 {
   vectorGeometryVector *geometries = malloc(sizeof(vectorGeometryVector));
 
@@ -63,8 +245,6 @@
       return NULL;
   }
 
-  size_t featureCount = OGR_L_GetFeatureCount(layer, 1);
-
   OGRSpatialReferenceH layerCRS = OGR_L_GetSpatialRef(layer); // reference is owned by dataset
   if (layerCRS == NULL) {
     fprintf(stderr, "Failed to get layer CRS: %s", CPLGetLastErrorMsg());
@@ -81,9 +261,18 @@
 
   const bool needsReprojection = !EQUAL(inputReferenceSystem, layerWKT);
 
+  // features outside of the filter are skipped by OGR before they're materialized at all
+  if (spatialFilter != NULL
+      && applySpatialFilter(layer, spatialFilter, (char *) inputReferenceSystem, layerWKT)) {
+    fprintf(stderr, "Warning: Failed to restrict AOI to raster extent, reading all features\n");
+  }
+
+  size_t featureCount = OGR_L_GetFeatureCount(layer, 1);
+
   geometries->entries = malloc(featureCount * sizeof(struct vectorGeometry));
   geometries->capacity = featureCount;
   geometries->size = 0;
+  geometries->digest = 0;
 
   if (geometries->entries == NULL) {
     fprintf(stderr, "Failed to allocate memory for array of vector geometries\n");
@@ -93,6 +282,23 @@
     return NULL;
   }
 
+  if (threads > 1) {
+    int ingestStatus = ingestFeaturesParallel(layer, filePath, layerWKT,
+                       (char *) inputReferenceSystem, needsReprojection, readPrecomputedCentroid, threads,
+                       geometries);
+
+    CPLFree((void *) layerWKT);
+    closeGDALDataset(vectorDataset);
+
+    if (ingestStatus || (simplifyTolerance > 0.0
+                         && simplifyFeatures(geometries, simplifyTolerance, readPrecomputedCentroid))) {
+      freeVectorGeometryList(geometries);
+      return NULL;
+    }
+
+    return geometries;
+  }
+
   OGRCoordinateTransformationH transformation = NULL;
   CSLConstList transformerAddonOptions = NULL;
   OGRGeomTransformerH transformer = NULL;
@@ -163,88 +369,47 @@
       geom = transformedGeometry;
     }
 
-    geometries->entries[geometries->size].geometry = OGRToGEOS(geom);
-    geometries->entries[geometries->size].mbr = boundingBoxOfOGRToGEOS(geom);
-    geometries->entries[geometries->size].OGRGeometry = geom;
-    geometries->entries[geometries->size].id = OGR_F_GetFID(feature);
-
-    if (readPrecomputedCentroid) {
-      int longitudeFieldIndex = OGR_F_GetFieldIndex(feature, "longitude");
-      int latitudeFieldIndex = OGR_F_GetFieldIndex(feature, "latitude");
-
-      if (longitudeFieldIndex == -1 || latitudeFieldIndex == -1) {
-        fprintf(stderr, "Failed to get field indices for longitude and latitude from %s\n", filePath);
-        freeVectorGeometryList(geometries);
-        OGR_G_DestroyGeometry(geom);
-        OGR_F_Destroy(feature); // current feature as loop is not finished
-        CSLDestroy(transformerAddonOptions);
-        OGR_GeomTransformer_Destroy(transformer);
-        OCTDestroyCoordinateTransformation(transformation);
-        CPLFree((void *) layerWKT);
-        closeGDALDataset(vectorDataset);
-        return NULL;
-      }
-
-      OGRFeatureDefnH featureDefinition = OGR_F_GetDefnRef(feature);
-
-      OGRFieldDefnH longitudeFieldDefinition = OGR_FD_GetFieldDefn(featureDefinition,
-          longitudeFieldIndex);
-      OGRFieldDefnH latitudeFieldDefinition = OGR_FD_GetFieldDefn(featureDefinition, latitudeFieldIndex);
-
-      if (longitudeFieldDefinition == NULL || latitudeFieldDefinition == NULL) {
-        fprintf(stderr, "Tried to query field definition with invalid index\n");
-        freeVectorGeometryList(geometries);
-        OGR_G_DestroyGeometry(geom);
-        OGR_F_Destroy(feature); // current feature as loop is not finished
-        CSLDestroy(transformerAddonOptions);
-        OGR_GeomTransformer_Destroy(transformer);
-        OCTDestroyCoordinateTransformation(transformation);
-        CPLFree((void *) layerWKT);
-        closeGDALDataset(vectorDataset);
-        return NULL;
-      }
-
-      if (!OGR_F_IsFieldSet(feature, longitudeFieldIndex)
-          || OGR_F_IsFieldNull(feature, longitudeFieldIndex)
-          || OGR_Fld_GetType(longitudeFieldDefinition) != OFTReal) {
-        fprintf(stderr, "longitude field is either not set, NULL or not of type double\n");
-        freeVectorGeometryList(geometries);
-        OGR_G_DestroyGeometry(geom);
-        OGR_F_Destroy(feature); // current feature as loop is not finished
-        CSLDestroy(transformerAddonOptions);
-        OGR_GeomTransformer_Destroy(transformer);
-        OCTDestroyCoordinateTransformation(transformation);
-        CPLFree((void *) layerWKT);
-        closeGDALDataset(vectorDataset);
-        return NULL;
-      }
+    // the compact polygon is the only representation kept, others are built when needed
+    int compactStatus = compactPolygonFromOGR(geom, &geometries->entries[geometries->size].polygon);
+    OGR_G_DestroyGeometry(geom);
 
-      if (!OGR_F_IsFieldSet(feature, latitudeFieldIndex)
-          || OGR_F_IsFieldNull(feature, latitudeFieldIndex)
-          || OGR_Fld_GetType(latitudeFieldDefinition) != OFTReal) {
-        fprintf(stderr, "latitude field is either not set, NULL or not of type double\n");
-        freeVectorGeometryList(geometries);
-        OGR_G_DestroyGeometry(geom);
-        OGR_F_Destroy(feature); // current feature as loop is not finished
-        CSLDestroy(transformerAddonOptions);
-        OGR_GeomTransformer_Destroy(transformer);
-        OCTDestroyCoordinateTransformation(transformation);
-        CPLFree((void *) layerWKT);
-        closeGDALDataset(vectorDataset);
-        return NULL;
-      }
+    if (compactStatus) {
+      fprintf(stderr, "Failed to convert OGR geometry to compact polygon\n");
+      freeVectorGeometryList(geometries);
+      OGR_F_Destroy(feature); // current feature as loop is not finished
+      CSLDestroy(transformerAddonOptions);
+      OGR_GeomTransformer_Destroy(transformer);
+      OCTDestroyCoordinateTransformation(transformation);
+      CPLFree((void *) layerWKT);
+      closeGDALDataset(vectorDataset);
+      return NULL;
+    }
 
-      geometries->entries[geometries->size].precomutedLongitude = OGR_F_GetFieldAsDouble(feature,
-          longitudeFieldIndex);
-      geometries->entries[geometries->size].precomputedLatitude = OGR_F_GetFieldAsDouble(feature,
-          latitudeFieldIndex);
+    geometries->entries[geometries->size].id = OGR_F_GetFID(feature);
+    geometries->entries[geometries->size].order = geometries->size;
+    geometries->entries[geometries->size].precomutedLongitude = 0.0;
+    geometries->entries[geometries->size].precomputedLatitude = 0.0;
+    geometries->entries[geometries->size].acquisitionHour = NAN;
+
+    if (readPrecomputedCentroid
+        && readPrecomputedCentroidFields(feature, filePath,
+                                         &geometries->entries[geometries->size].precomutedLongitude,
+                                         &geometries->entries[geometries->size].precomputedLatitude)) {
+      freeVectorGeometry(&geometries->entries[geometries->size]);
+      freeVectorGeometryList(geometries);
+      OGR_F_Destroy(feature); // current feature as loop is not finished
+      CSLDestroy(transformerAddonOptions);
+      OGR_GeomTransformer_Destroy(transformer);
+      OCTDestroyCoordinateTransformation(transformation);
+      CPLFree((void *) layerWKT);
+      closeGDALDataset(vectorDataset);
+      return NULL;
     }
 
-    if (geometries->entries[geometries->size].geometry == NULL
-        || geometries->entries[geometries->size].mbr == NULL) {
-      fprintf(stderr, "Failed to convert OGR geometry to GEOS\n");
+    if (hashFeature(&geometries->entries[geometries->size], readPrecomputedCentroid)) {
+      fprintf(stderr, "Failed to hash feature\n");
+      freeVectorGeometry(&geometries->entries[geometries->size]);
       freeVectorGeometryList(geometries);
-      OGR_G_DestroyGeometry(geom);
       OGR_F_Destroy(feature); // current feature as loop is not finished
       CSLDestroy(transformerAddonOptions);
       OGR_GeomTransformer_Destroy(transformer);
@@ -264,11 +429,353 @@
   CPLFree((void *) layerWKT);
   closeGDALDataset(vectorDataset);
 
+  if (simplifyTolerance > 0.0
+      && simplifyFeatures(geometries, simplifyTolerance, readPrecomputedCentroid)) {
+    freeVectorGeometryList(geometries);
+    return NULL;
+  }
+
   return geometries;
 }
 
+int applySpatialFilter(OGRLayerH layer, const OGREnvelope *extent, char *extentWKT,
+                       char *layerWKT)
+{
+  OGREnvelope filter = *extent;
+
+  if (getCRSType(extentWKT) == CRS_GEOGRAPHIC) {
+    // rasters may be requested with longitudes in [-360, 360], features are in [-180, 180]
+    if (filter.MinX >= 180.0) {
+      filter.MinX -= 360.0;
+      filter.MaxX -= 360.0;
+    } else if (filter.MaxX <= -180.0) {
+      filter.MinX += 360.0;
+      filter.MaxX += 360.0;
+    }
+
+    if (filter.MinX < -180.0 || filter.MaxX > 180.0) {
+      filter.MinX = -180.0;
+      filter.MaxX = 180.0;
+    }
+  }
+
+  if (EQUAL(extentWKT, layerWKT)) {
+    OGR_L_SetSpatialFilterRect(layer, filter.MinX, filter.MinY, filter.MaxX, filter.MaxY);
+    return 0;
+  }
+
+  OGRCoordinateTransformationH transformation = transformationFromWKTs(extentWKT, layerWKT, false);
+  if (transformation == NULL) {
+    return 1;
+  }
+
+  const int defaultDensification = 21;
+  OGREnvelope layerFilter;
+
+  int transformed = OCTTransformBounds(transformation, filter.MinX, filter.MinY, filter.MaxX,
+                                       filter.MaxY, &layerFilter.MinX, &layerFilter.MinY, &layerFilter.MaxX,
+                                       &layerFilter.MaxY, defaultDensification);
+
+  OCTDestroyCoordinateTransformation(transformation);
+
+  // bounds crossing the antimeridian of a geographic layer CRS come back with MaxX < MinX
+  if (transformed == FALSE || layerFilter.MaxX <= layerFilter.MinX
+      || layerFilter.MaxY <= layerFilter.MinY) {
+    return 1;
+  }
+
+  OGR_L_SetSpatialFilterRect(layer, layerFilter.MinX, layerFilter.MinY, layerFilter.MaxX,
+                             layerFilter.MaxY);
+
+  return 0;
+}
+
+int simplifyFeatures(vectorGeometryVector *geometries, double tolerance,
+                     bool readPrecomputedCentroid)
+{
+  size_t verticesBefore = 0;
+  size_t verticesAfter = 0;
+  size_t simplifiedCount = 0;
+  double maximumChange = 0.0;
+  GIntBig maximumChangeFID = 0;
+
+  for (size_t i = 0; i < geometries->size; i++) {
+    struct vectorGeometry *feature = &geometries->entries[i];
+    double areaChange;
+
+    verticesBefore += feature->polygon.pointCount;
+
+    if (simplifyCompactPolygon(&feature->polygon, tolerance, &areaChange) == 0) {
+      if (hashFeature(feature, readPrecomputedCentroid)) {
+        fprintf(stderr, "Failed to hash feature\n");
+        return 1;
+      }
+
+      simplifiedCount++;
+
+      if (areaChange > maximumChange) {
+        maximumChange = areaChange;
+        maximumChangeFID = feature->id;
+      }
+
+#ifdef DEBUG
+      printf("Simplified feature with FID %lld, area weights change by at most %.4lf%%\n", feature->id,
+             areaChange * 100.0);
+#endif
+    }
+
+    verticesAfter += feature->polygon.pointCount;
+  }
+
+  printf("Simplified %lu of %lu features with tolerance %lf, kept %lu of %lu vertices\n",
+         simplifiedCount, geometries->size, tolerance, verticesAfter, verticesBefore);
+
+  if (simplifiedCount > 0) {
+    printf("Maximum area-weight change is %.4lf%% for feature with FID %lld\n", maximumChange * 100.0,
+           maximumChangeFID);
+  }
+
+  return 0;
+}
+
+void failIngestion(struct ingestContext *context)
+{
+  pthread_mutex_lock(&context->lock);
+  context->failed = true;
+  pthread_cond_broadcast(&context->wake);
+  pthread_mutex_unlock(&context->lock);
+}
+
+void *ingestWorker(void *arg)
+{
+  struct ingestContext *context = (struct ingestContext *) arg;
+
+  // coordinate transformations must not be shared between threads
+  OGRCoordinateTransformationH transformation = NULL;
+  CSLConstList transformerAddonOptions = NULL;
+  OGRGeomTransformerH transformer = NULL;
+
+  if (context->reproject) {
+    transformation = transformationFromWKTs(context->sourceWKT, context->targetWKT, false);
+    /// NOTE: see buildGEOSGeometriesFromFile on why WRAPDATELINE=NO is used
+    transformerAddonOptions = CSLAddStringMayFail(transformerAddonOptions, "WRAPDATELINE=NO");
+
+    if (transformation != NULL && transformerAddonOptions != NULL) {
+      transformer = OGR_GeomTransformer_Create(transformation, transformerAddonOptions);
+    }
+  }
+
+  if (context->reproject && transformer == NULL) {
+    fprintf(stderr, "Failed to set up AOI ingestion thread\n");
+    failIngestion(context);
+  }
+
+  while (!context->reproject || transformer != NULL) {
+    pthread_mutex_lock(&context->lock);
+
+    while (context->next >= context->ready && !context->readerDone && !context->failed) {
+      pthread_cond_wait(&context->wake, &context->lock);
+    }
+
+    if (context->failed || context->next >= context->ready) {
+      pthread_mutex_unlock(&context->lock);
+      break;
+    }
+
+    // features below `ready` are never moved, thus they can be converted without holding the lock
+    size_t index = context->next;
+    struct vectorGeometry *feature = &context->geometries->entries[index];
+    context->next++;
+
+    pthread_mutex_unlock(&context->lock);
+
+    OGRGeometryH geom = context->pending[index];
+    context->pending[index] = NULL;
+
+    if (context->reproject) {
+      OGRGeometryH transformedGeometry = OGR_GeomTransformer_Transform(transformer, geom);
+
+      OGR_G_DestroyGeometry(geom);
+      geom = transformedGeometry;
+
+      if (transformedGeometry == NULL) {
+        fprintf(stderr, "Failed to transform geometry: %s\n", CPLGetLastErrorMsg());
+        failIngestion(context);
+        break;
+      }
+    }
+
+    int compactStatus = compactPolygonFromOGR(geom, &feature->polygon);
+    OGR_G_DestroyGeometry(geom);
+
+    if (compactStatus) {
+      fprintf(stderr, "Failed to convert OGR geometry to compact polygon\n");
+      failIngestion(context);
+      break;
+    }
+
+    if (hashFeature(feature, context->usePrecomputedCentroid)) {
+      fprintf(stderr, "Failed to hash feature\n");
+      failIngestion(context);
+      break;
+    }
+  }
+
+  OGR_GeomTransformer_Destroy(transformer);
+  CSLDestroy(transformerAddonOptions);
+  OCTDestroyCoordinateTransformation(transformation);
+
+  return NULL;
+}
+
+int ingestFeaturesParallel(OGRLayerH layer, const char *filePath, char *layerWKT,
+                           char *inputReferenceSystem, bool needsReprojection, bool readPrecomputedCentroid,
+                           int threads, vectorGeometryVector *geometries)
+{
+  struct ingestContext context = {
+    .geometries = geometries,
+    .pending = calloc(geometries->capacity > 0 ? geometries->capacity : 1, sizeof(OGRGeometryH)),
+    .sourceWKT = layerWKT,
+    .targetWKT = inputReferenceSystem,
+    .reproject = needsReprojection,
+    .usePrecomputedCentroid = readPrecomputedCentroid,
+    .ready = 0,
+    .next = 0,
+    .readerDone = false,
+    .failed = false
+  };
+
+  if (context.pending == NULL) {
+    perror("calloc");
+    return 1;
+  }
+
+  if (pthread_mutex_init(&context.lock, NULL) != 0) {
+    fprintf(stderr, "Failed to initialize ingestion mutex\n");
+    free(context.pending);
+    return 1;
+  }
+
+  if (pthread_cond_init(&context.wake, NULL) != 0) {
+    fprintf(stderr, "Failed to initialize ingestion condition variable\n");
+    pthread_mutex_destroy(&context.lock);
+    free(context.pending);
+    return 1;
+  }
+
+  pthread_t *workers = calloc((size_t) threads, sizeof(pthread_t));
+  if (workers == NULL) {
+    perror("calloc");
+    pthread_cond_destroy(&context.wake);
+    pthread_mutex_destroy(&context.lock);
+    free(context.pending);
+    return 1;
+  }
+
+  int started = 0;
+
+  for (; started < threads; started++) {
+    if (pthread_create(&workers[started], NULL, ingestWorker, &context) != 0) {
+      fprintf(stderr, "Failed to start AOI ingestion thread\n");
+      failIngestion(&context);
+      break;
+    }
+  }
+
+  // reading features from the layer is left to this thread alone, OGR layers are not thread-safe
+  OGRFeatureH feature;
+  OGR_L_ResetReading(layer);
+
+  pthread_mutex_lock(&context.lock);
+  bool stop = context.failed;
+  pthread_mutex_unlock(&context.lock);
+
+  while (!stop && (feature = OGR_L_GetNextFeature(layer)) != NULL) {
+    if (context.ready == geometries->capacity) {
+      fprintf(stderr, "Layer holds more features than reported\n");
+      OGR_F_Destroy(feature);
+      failIngestion(&context);
+      break;
+    }
+
+    struct vectorGeometry *entry = &geometries->entries[context.ready];
+    context.pending[context.ready] = OGR_G_Clone(OGR_F_GetGeometryRef(feature));
+    entry->polygon.coordinates = NULL;
+    entry->id = OGR_F_GetFID(feature);
+    entry->order = context.ready;
+    entry->precomutedLongitude = 0.0;
+    entry->precomputedLatitude = 0.0;
+    entry->acquisitionHour = NAN;
+
+    bool invalid = context.pending[context.ready] == NULL
+                   || (readPrecomputedCentroid && readPrecomputedCentroidFields(feature, filePath,
+                       &entry->precomutedLongitude, &entry->precomputedLatitude));
+
+    OGR_F_Destroy(feature);
+
+    pthread_mutex_lock(&context.lock);
+    // published in any case, thus the feature is freed together with all others
+    context.ready++;
+    if (invalid) {
+      context.failed = true;
+    }
+    stop = context.failed;
+    pthread_cond_broadcast(&context.wake);
+    pthread_mutex_unlock(&context.lock);
+  }
+
+  pthread_mutex_lock(&context.lock);
+  context.readerDone = true;
+  pthread_cond_broadcast(&context.wake);
+  pthread_mutex_unlock(&context.lock);
+
+  for (int i = 0; i < started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+
+  // geometries published but never claimed by a worker after a failure
+  for (size_t i = 0; i < context.ready; i++) {
+    OGR_G_DestroyGeometry(context.pending[i]);
+  }
+
+  free(context.pending);
+  free(workers);
+  pthread_cond_destroy(&context.wake);
+  pthread_mutex_destroy(&context.lock);
+
+  geometries->size = context.ready;
+
+  return context.failed || started == 0 ? 1 : 0;
+}
+
+[[nodiscard]] GEOSGeometry *cyclicCellGeometry(double minX, double minY, double maxX, double maxY)
+{
+  // column positions are taken modulo 360°, such that the western edge lies in [-180°, 180°)
+  double shift = -360.0 * floor((minX + 180.0) / 360.0);
+
+  minX += shift;
+  maxX += shift;
+
+  if (maxX <= 180.0) {
+    return GEOSGeom_createRectangle(minX, minY, maxX, maxY);
+  }
+
+  GEOSGeometry *parts[2] = {
+    GEOSGeom_createRectangle(minX, minY, 180.0, maxY),
+    GEOSGeom_createRectangle(-180.0, minY, maxX - 360.0, maxY)
+  };
+
+  if (parts[0] == NULL || parts[1] == NULL) {
+    GEOSGeom_destroy(parts[0]);
+    GEOSGeom_destroy(parts[1]);
+    return NULL;
+  }
+
+  return GEOSGeom_createCollection(GEOS_MULTIPOLYGON, parts, 2);
+}
+
 [[nodiscard]] GEOSSTRtree *buildSTRTreefromRaster(const struct averagedData *data,
-    const struct geoTransform *transformation, cellGeometryList **cells)
+    const struct geoTransform *transformation, CRS_TYPE crsType, cellGeometryList **cells)
 {
   unsigned int err = 0;
   GEOSSTRtree *tree = GEOSSTRtree_create(TREE_NODE_CAP);
@@ -277,6 +784,11 @@
     return NULL;
   }
 
+  // only longitudes are cyclic, wrapping a raster covering more than the globe would stack cells
+  // onto each other
+  const bool cyclic = crsType == CRS_GEOGRAPHIC && transformation->rowRotation == 0.0
+                      && fabs(transformation->pixelWidth) * (double) data->columns <= 360.0 + 1e-9;
+
   for (size_t x = 0; x < data->columns; x++) {
     for (size_t y = 0; y < data->rows; y++) {
       double x1 = coordinateFromCell(transformation->xOrigin, (double) x, transformation->pixelWidth,
@@ -291,12 +803,9 @@
                                      (double) x, transformation->colRotation);
 
       // as per GDAL's RFC 73, the raster drivers use *gis-friendly* axis ordering; no further changes needed here!
-      GEOSGeometry *geom = GEOSGeom_createRectangle(
-                             MIN(x1, x2),
-                             MIN(y1, y2),
-                             MAX(x1, x2),
-                             MAX(y1, y2)
-                           );
+      GEOSGeometry *geom = cyclic
+                           ? cyclicCellGeometry(MIN(x1, x2), MIN(y1, y2), MAX(x1, x2), MAX(y1, y2))
+                           : GEOSGeom_createRectangle(MIN(x1, x2), MIN(y1, y2), MAX(x1, x2), MAX(y1, y2));
       if (geom == NULL) {
         fprintf(stderr, "Failed to create cell geometry\n");
         err = 1;
@@ -313,6 +822,7 @@
 
       cell->geometry = geom;
       cell->value = data->data[x + y * data->columns];
+      cell->index = x + y * data->columns;
 
       cellGeometryList *node = calloc(1, sizeof(cellGeometryList));
       if (node == NULL) {
@@ -360,6 +870,21 @@ void trackIntersectingGeometries(void *item, void *userdata)
   userdata_t *ud = (userdata_t *) userdata;
   struct cellGeometry *geom = (struct cellGeometry *) item;
 
+  if (ud->failed) {
+    return;
+  }
+
+  // GEOS geometry is only built for features whose envelope hits at least one cell
+  if (ud->queryGeometry == NULL) {
+    ud->geometry = compactPolygonToGEOS(ud->polygon);
+    ud->queryGeometry = ud->geometry == NULL ? NULL : GEOSPrepare(ud->geometry);
+
+    if (ud->queryGeometry == NULL) {
+      ud->failed = true;
+      return;
+    }
+  }
+
   switch (GEOSPreparedIntersects(ud->queryGeometry, geom->geometry)) {
     case 0:
       return; // actual geometries do not intersect, nothing to do
@@ -395,6 +920,65 @@ void trackIntersectingGeometries(void *item, void *userdata)
   return;
 }
 
+int sortFeaturesAlongHilbertCurve(vectorGeometryVector *geometries)
+{
+  if (geometries->size < 2) {
+    return 0;
+  }
+
+  OGREnvelope extent = {DBL_MAX, -DBL_MAX, DBL_MAX, -DBL_MAX};
+
+  for (size_t i = 0; i < geometries->size; i++) {
+    const OGREnvelope *envelope = &geometries->entries[i].polygon.envelope;
+    double centerX = (envelope->MinX + envelope->MaxX) / 2.0;
+    double centerY = (envelope->MinY + envelope->MaxY) / 2.0;
+
+    extent.MinX = fmin(extent.MinX, centerX);
+    extent.MaxX = fmax(extent.MaxX, centerX);
+    extent.MinY = fmin(extent.MinY, centerY);
+    extent.MaxY = fmax(extent.MaxY, centerY);
+  }
+
+  struct curveKey *keys = malloc(geometries->size * sizeof(struct curveKey));
+  struct vectorGeometry *sorted = malloc(geometries->size * sizeof(struct vectorGeometry));
+  if (keys == NULL || sorted == NULL) {
+    perror("malloc");
+    free(keys);
+    free(sorted);
+    return 1;
+  }
+
+  // centers are scaled onto the curve's grid, a degenerate extent maps all features onto one cell
+  const double cells = (double) (((uint32_t) 1 << HILBERT_ORDER) - 1);
+  double width = extent.MaxX - extent.MinX;
+  double height = extent.MaxY - extent.MinY;
+
+  for (size_t i = 0; i < geometries->size; i++) {
+    const OGREnvelope *envelope = &geometries->entries[i].polygon.envelope;
+    double centerX = (envelope->MinX + envelope->MaxX) / 2.0;
+    double centerY = (envelope->MinY + envelope->MaxY) / 2.0;
+    uint32_t x = width > 0.0 ? (uint32_t) ((centerX - extent.MinX) / width * cells) : 0;
+    uint32_t y = height > 0.0 ? (uint32_t) ((centerY - extent.MinY) / height * cells) : 0;
+
+    keys[i].key = hilbertIndex(x, y);
+    keys[i].index = i;
+  }
+
+  qsort(keys, geometries->size, sizeof(struct curveKey), curveKeyCmp);
+
+  for (size_t i = 0; i < geometries->size; i++) {
+    sorted[i] = geometries->entries[keys[i].index];
+  }
+
+  free(keys);
+  free(geometries->entries);
+
+  geometries->entries = sorted;
+  geometries->capacity = geometries->size;
+
+  return 0;
+}
+
 [[nodiscard]] intersectionVector *querySTRTree(vectorGeometryVector *areasOfInterest,
     GEOSSTRtree *rasterTree, bool usePrecomputedCentroid)
 {
@@ -404,7 +988,8 @@ void trackIntersectingGeometries(void *item, void *userdata)
     return NULL;
   }
 
-  queryResults->entries = malloc(areasOfInterest->size * sizeof(struct i));
+  queryResults->entries = calloc(areasOfInterest->size > 0 ? areasOfInterest->size : 1,
+                                 sizeof(struct i));
   queryResults->capacity = areasOfInterest->size;
   queryResults->size = 0;
 
@@ -415,33 +1000,53 @@ void trackIntersectingGeometries(void *item, void *userdata)
   }
 
   for (size_t i = 0; i < areasOfInterest->size; i++) {
+    const OGREnvelope *envelope = &areasOfInterest->entries[i].polygon.envelope;
+    GEOSGeometry *mbr = GEOSGeom_createRectangle(envelope->MinX, envelope->MinY, envelope->MaxX,
+                        envelope->MaxY);
+
+    if (mbr == NULL) {
+      fprintf(stderr, "Failed to create MBR for FID %lld\n", areasOfInterest->entries[i].id);
+      continue;
+    }
+
     userdata_t userdata = {
-      .queryGeometry = GEOSPrepare(areasOfInterest->entries[i].geometry),
+      .polygon = &areasOfInterest->entries[i].polygon,
+      .geometry = NULL,
+      .queryGeometry = NULL,
+      .failed = false,
       .intersectingCells = NULL,
       .intersectionCount = 0
     };
 
-    if (userdata.queryGeometry == NULL) {
-      fprintf(stderr, "Failed to prepare geometry for FID %lld\n", areasOfInterest->entries[i].id);
-      continue;
-    }
+    GEOSSTRtree_query(rasterTree, mbr, trackIntersectingGeometries, (void *) &userdata);
 
-    GEOSSTRtree_query(rasterTree, areasOfInterest->entries[i].mbr, trackIntersectingGeometries,
-                      (void *) &userdata);
+    GEOSGeom_destroy(mbr);
 
-    GEOSPreparedGeom_destroy(userdata.queryGeometry);
+    if (userdata.queryGeometry != NULL) {
+      GEOSPreparedGeom_destroy(userdata.queryGeometry);
+    }
+
+    if (userdata.failed) {
+      fprintf(stderr, "Failed to prepare geometry for FID %lld\n", areasOfInterest->entries[i].id);
+    }
 
     if (userdata.intersectingCells == NULL) {
-      fprintf(stderr, "No intersections found for geometry with FID %lld.\n",
-              areasOfInterest->entries[i].id);
+      if (!userdata.failed) {
+        fprintf(stderr, "No intersections found for geometry with FID %lld.\n",
+                areasOfInterest->entries[i].id);
+      }
+      GEOSGeom_destroy(userdata.geometry);
       continue;
     }
 
-    /// NOTE: no ownership of areasOfInterest->entry->OGRGeometry is taken,
+    /// NOTE: no ownership of areasOfInterest->entry->polygon is taken,
     ///       owner of `areaOfInterest` is responsible to free object!
-    queryResults->entries[queryResults->size].reference = areasOfInterest->entries[i].OGRGeometry;
-    queryResults->entries[queryResults->size].referenceASGEOS = areasOfInterest->entries[i].geometry;
+    ///       The GEOS geometry built during the query is owned by `queryResults`.
+    queryResults->entries[queryResults->size].reference = &areasOfInterest->entries[i].polygon;
+    queryResults->entries[queryResults->size].referenceASGEOS = userdata.geometry;
     queryResults->entries[queryResults->size].referenceFID = areasOfInterest->entries[i].id;
+    queryResults->entries[queryResults->size].referenceHash = areasOfInterest->entries[i].hash;
+    queryResults->entries[queryResults->size].referenceOrder = areasOfInterest->entries[i].order;
     queryResults->entries[queryResults->size].intersectionCount = userdata.intersectionCount;
     queryResults->entries[queryResults->size].intersectingCells = userdata.intersectingCells;
 
@@ -24,12 +24,16 @@
 
 #define TREE_NODE_CAP 100
 
+/// Upper bound of threads used to read AOI features
+#define MAX_INGEST_THREADS 256
+
 /**
- * @brief Create a vector of GEOS geometries from an OGR-readable vector dataset
+ * @brief Create a vector of compact polygons from an OGR-readable vector dataset
  *
  * @details This functions opens an OGR-readable vector dataset and extracts a single layer from it.
- *          Every feature of the extracted layer is exported to a GEOS geometry and possibly transformed
- *          if the layer CRS does not match the one provided in `inputReferenceSystem`.
+ *          Every feature of the extracted layer is possibly transformed if the layer CRS does not match
+ *          the one provided in `inputReferenceSystem` and stored as compact polygon. OGR and GEOS
+ *          geometries are built from it only when needed, see polygon-store.h.
  *          No attribute information of the layer features is stored/exported.
  *
  * @remark Geometries that don't describe an area or are not the strict 2D version are not allowed and return an error.
@@ -42,12 +46,145 @@
  * @param inputReferenceSystem Target CRS in WKT representation.
  * @param readPrecomputedCentroid Read the double fields "longitude" and "latitude" from the feature for later
  *        substitution of dynamically computed centroids.
+ * @param threads Number of threads reprojecting and converting features. If greater than 1, see ingestFeaturesParallel().
+ * @param spatialFilter Extent in `inputReferenceSystem` features must intersect to be read, possibly NULL.
+ *        See applySpatialFilter().
+ * @param simplifyTolerance Tolerance features are simplified with in units of `inputReferenceSystem`,
+ *        0 to keep them as they are. See simplifyFeatures().
  * @return vectorGeometryVector* Reference to vector of GEOS geometries, NULL on error.
  */
 [[nodiscard]] vectorGeometryVector *buildGEOSGeometriesFromFile(const char *filePath,
     const char *layerName,
     const char *inputReferenceSystem,
-    bool readPrecomputedCentroid);
+    bool readPrecomputedCentroid,
+    int threads,
+    const OGREnvelope *spatialFilter,
+    double simplifyTolerance);
+
+/**
+ * @brief Restrict features read from a layer to those intersecting an extent
+ *
+ * @details The extent is reprojected to the layer CRS with densified edges. Longitudes outside of
+ *          [-180, 180] are folded back or, if the extent crosses the antimeridian, the longitude
+ *          range is dropped from the filter. Depending on the driver, the filter may only compare
+ *          bounding boxes, thus some features not intersecting the extent are still read.
+ *
+ * @param layer Layer to filter.
+ * @param extent Extent in `extentWKT`, assumed to use longitude/latitude ordering if geographic.
+ * @param extentWKT CRS of extent in WKT representation.
+ * @param layerWKT CRS of layer in WKT representation.
+ * @return int 0 on success, 1 if the extent could not be reprojected, in which case no filter is set.
+ */
+int applySpatialFilter(OGRLayerH layer, const OGREnvelope *extent, char *extentWKT,
+                       char *layerWKT);
+
+/**
+ * @brief Read the precomputed centroid of a feature
+ *
+ * @param feature Feature to read fields "longitude" and "latitude" of type double from.
+ * @param filePath Path to vector dataset, used in error messages.
+ * @param longitude Set to the value of field "longitude".
+ * @param latitude Set to the value of field "latitude".
+ * @return int 0 on success, 1 if a field is missing, unset or not of type double.
+ */
+int readPrecomputedCentroidFields(OGRFeatureH feature, const char *filePath, double *longitude,
+                                  double *latitude);
+
+/**
+ * @brief Read the acquisition time of a feature as hour of day in UTC
+ *
+ * @param feature Feature to read from.
+ * @param fieldIndex Index of a field of type date-time or time.
+ * @param hour Set to the fractional hour in [0, 24), NaN if the field is unset or NULL.
+ * @return int 0 on success, 1 if the field could not be read.
+ */
+int readAcquisitionHour(OGRFeatureH feature, int fieldIndex, double *hour);
+
+/**
+ * @brief Read the acquisition times of AOI features
+ *
+ * @details The layer is read once more without geometries and features are matched to geometries
+ *          by FID. The time of each feature is mixed into its hash, thus rows of features with
+ *          changed times are recomputed by incremental runs. Features whose field is unset or NULL
+ *          keep NaN.
+ *
+ * @param filePath Path to vector dataset.
+ * @param layerName Layer to read. If NULL, the first layer will be used.
+ * @param fieldName Name of a field of type date-time or time.
+ * @param geometries Vector of AOI geometries whose `acquisitionHour` is set.
+ * @return int 0 on success, 1 on error.
+ */
+int readAcquisitionTimes(const char *filePath, const char *layerName, const char *fieldName,
+                         vectorGeometryVector *geometries);
+
+/**
+ * @brief Simplify all features and report the largest change of area weights
+ *
+ * @details Each feature is simplified with simplifyCompactPolygon() and rehashed afterwards. The
+ *          number of removed vertices and the largest relative area change of any feature are
+ *          printed, the latter bounds how much an area-weighted mean can shift towards other cells.
+ *
+ * @param geometries Vector of AOI geometries, simplified in place.
+ * @param tolerance Simplification tolerance and grid size in units of the geometries' CRS.
+ * @param readPrecomputedCentroid Whether precomputed centroids were read, passed on to hashFeature().
+ * @return int 0 on success, 1 on error.
+ */
+int simplifyFeatures(vectorGeometryVector *geometries, double tolerance,
+                     bool readPrecomputedCentroid);
+
+/**
+ * @brief Read features of a layer with one thread and convert them with multiple threads
+ *
+ * @details The calling thread streams features from the layer and publishes clones of their
+ *          geometries. Worker threads, each with their own coordinate transformation, reproject
+ *          published geometries and convert them to compact polygons. Order of features is the
+ *          same as with sequential reading.
+ *
+ * @param layer Layer to read.
+ * @param filePath Path to vector dataset, used in error messages.
+ * @param layerWKT CRS of layer in WKT representation.
+ * @param inputReferenceSystem Target CRS in WKT representation.
+ * @param needsReprojection Whether geometries need to be reprojected.
+ * @param readPrecomputedCentroid Whether precomputed centroids are read.
+ * @param threads Number of worker threads.
+ * @param geometries Vector with capacity for all features of the layer, filled by this function.
+ * @return int 0 on success, 1 on error. On error, `geometries` still needs to be freed by the caller.
+ */
+int ingestFeaturesParallel(OGRLayerH layer, const char *filePath, char *layerWKT,
+                           char *inputReferenceSystem, bool needsReprojection, bool readPrecomputedCentroid,
+                           int threads, vectorGeometryVector *geometries);
+
+/**
+ * @brief Thread function converting features published by ingestFeaturesParallel()
+ *
+ * @param arg Reference to struct ingestContext.
+ * @return void* Always NULL.
+ */
+void *ingestWorker(void *arg);
+
+/**
+ * @brief Mark parallel ingestion as failed and wake up all threads
+ *
+ * @param context Shared ingestion state.
+ */
+void failIngestion(struct ingestContext *context);
+
+/**
+ * @brief Build a rectangular cell geometry, treating longitude as cyclic
+ *
+ * @details Cells beyond +/- 180° are moved to the opposite side of the antimeridian by a multiple
+ *          of 360°. Cells crossing the antimeridian are split into a multipolygon with one part on
+ *          either side.
+ *
+ * @note After the function returns, the caller owns the returned geometry and must destroy it after use.
+ *
+ * @param minX Western edge of cell.
+ * @param minY Southern edge of cell.
+ * @param maxX Eastern edge of cell.
+ * @param maxY Northern edge of cell.
+ * @return GEOSGeometry* Polygon or multipolygon, NULL on error.
+ */
+[[nodiscard]] GEOSGeometry *cyclicCellGeometry(double minX, double minY, double maxX, double maxY);
 
 /**
  * @brief Build a STRTree of vectorized raster cells and their values
@@ -58,16 +195,21 @@
  *          GDAL's geo transfromation information is used to derive vectorized cell
  *          geometries as per GDAL's documentation. Thus, this function should work well
  *          even with non north-up raster datasets as the rotation is honored.
+ *          If the raster doesn't span more than 360° of longitude, cells are wrapped around the
+ *          antimeridian with cyclicCellGeometry(). Thus, AOI geometries split at +/- 180°
+ *          intersect cells of rasters extending beyond +/- 180°. Cells of projected rasters are
+ *          never wrapped.
  *
  * @note After the function returns, the caller owns the returned `GEOSTree` object and musst free it after use.
  *
  * @param data Averaged data.
  * @param transformation Extracted geo transfomation information used to create vectorized cells.
+ * @param crsType Type of the raster's CRS, only cells of geographic rasters are wrapped.
  * @param cells Indirect reference to linked list storing vectorzied geometries. Will not point to valid list on error.
  * @return GEOSSTRtree* Reference to STRTree, NULL on error
  */
 [[nodiscard]] GEOSSTRtree *buildSTRTreefromRaster(const struct averagedData *data,
-    const struct geoTransform *transformation, cellGeometryList **cells);
+    const struct geoTransform *transformation, CRS_TYPE crsType, cellGeometryList **cells);
 
 /**
  * @brief Callback used when querying STRTree
@@ -80,13 +222,26 @@
  */
 void trackIntersectingGeometries(void *item, void *userdata);
 
+/**
+ * @brief Sort features along a Hilbert curve of their envelope centers
+ *
+ * @details Features close to each other are queried one after another, thus they reuse the same
+ *          raster cells while those are still cached. The position of each feature in the layer is
+ *          kept in its `order` field, allowing outputs to be written in the original order.
+ *
+ * @param geometries Vector of AOI geometries, sorted in place.
+ * @return int 0 on success, 1 on error.
+ */
+int sortFeaturesAlongHilbertCurve(vectorGeometryVector *geometries);
+
 /**
  * @brief Query STRTree with MBRs of "extraction" geometries
  *
  * @details This function iterates over all geometries stored in `areaOfInterest` and queries the
  *          previously created STRTree, consisting of vectorized raster cells, for intersections.
  *          Any intersecting cells are added to a list and may be used to calculate area weighted
- *          means of total water column.
+ *          means of total water column. GEOS geometries of features are only built if their envelope
+ *          hits at least one cell and are owned by the returned vector afterwards.
  *
  * @note After the function returns, the caller owns the returned object and musst free it after use.
  *
@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+#include "table-writer.h"
+#include "math-utils.h"
+#include "paths.h"
+#include "types.h"
+#include "variables.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+size_t formatFixed(double value, int decimals, char *out)
+{
+  const uint64_t powers[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL
+  };
+
+  double magnitude = fabs(value);
+  double scaled = magnitude * (double) powers[decimals];
+  double integral = floor(scaled);
+  double fraction = scaled - integral;
+
+  // the product is off by at most half an ulp, ties and anything close to them are left to libc
+  if (!isfinite(value) || scaled >= 0x1p52 || fabs(fraction - 0.5) <= scaled * 0x1p-50 + 0x1p-60) {
+    char fallback[FIXED_FORMAT_MAX + 1];
+    int written = snprintf(fallback, sizeof(fallback), "%.*lf", decimals, value);
+    size_t length = written < 0 ? 0 : (size_t) written;
+
+    if (length > FIXED_FORMAT_MAX) {
+      length = FIXED_FORMAT_MAX;
+    }
+
+    memcpy(out, fallback, length);
+
+    return length;
+  }
+
+  uint64_t rounded = (uint64_t) integral + (fraction > 0.5 ? 1 : 0);
+  uint64_t integerPart = rounded / powers[decimals];
+  uint64_t decimalPart = rounded % powers[decimals];
+  char digits[20];
+  size_t digitCount = 0;
+  size_t length = 0;
+
+  // like printf, the sign is kept for negative values rounding to zero
+  if (signbit(value)) {
+    out[length++] = '-';
+  }
+
+  do {
+    digits[digitCount++] = (char) ('0' + integerPart % 10);
+    integerPart /= 10;
+  } while (integerPart > 0);
+
+  while (digitCount > 0) {
+    out[length++] = digits[--digitCount];
+  }
+
+  if (decimals > 0) {
+    out[length++] = '.';
+
+    for (int i = decimals - 1; i >= 0; i--) {
+      out[length + (size_t) i] = (char) ('0' + decimalPart % 10);
+      decimalPart /= 10;
+    }
+
+    length += (size_t) decimals;
+  }
+
+  return length;
+}
+
+[[nodiscard]] char *formatWeightedMeans(const meanVector *values, size_t *length)
+{
+  size_t capacity = (values->size + 1) * TABLE_ROW_ESTIMATE + TABLE_ROW_MAX;
+  char *buffer = malloc(capacity);
+  if (buffer == NULL) {
+    perror("malloc");
+    return NULL;
+  }
+
+  size_t size = 0;
+
+  for (size_t i = 0; i < values->size; i++) {
+    // rows are much shorter than the bound, growing is only needed for extreme values
+    if (capacity - size < TABLE_ROW_MAX) {
+      char *grown = realloc(buffer, capacity * 2);
+      if (grown == NULL) {
+        perror("realloc");
+        free(buffer);
+        return NULL;
+      }
+
+      buffer = grown;
+      capacity *= 2;
+    }
+
+    size += formatFixed(values->entries[i].x, 4, buffer + size);
+    buffer[size++] = ' ';
+    size += formatFixed(values->entries[i].y, 4, buffer + size);
+    buffer[size++] = ' ';
+
+    /// NOTE: after checking the calling code, this path shouldn't be taken, but who knows;
+    // throw it in for good measure
+    if (isnan(values->entries[i].value)) {
+      memcpy(buffer + size, "9999 TBD\n", 9);
+      size += 9;
+    } else {
+      size += formatFixed(variableValue(values->entries[i].value, values->variable), 10, buffer + size);
+      memcpy(buffer + size, " ERA\n", 5);
+      size += 5;
+    }
+  }
+
+  *length = size;
+
+  return buffer;
+}
+
+int writeFileAtomically(const char *filePath, const char *data, size_t length)
+{
+  char *temporaryPath = constructFilePath("%s.%d.tmp", filePath, (int) getpid());
+  if (temporaryPath == NULL) {
+    fprintf(stderr, "Failed to construct path of temporary file\n");
+    return 1;
+  }
+
+  int fd = open(temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    perror("open");
+    free(temporaryPath);
+    return 1;
+  }
+
+  size_t total = 0;
+
+  // a single call writes everything unless interrupted or the file system is full
+  while (total < length) {
+    ssize_t bytesWritten = write(fd, data + total, length - total);
+
+    if (bytesWritten < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (bytesWritten <= 0) {
+      perror("write");
+      break;
+    }
+
+    total += (size_t) bytesWritten;
+  }
+
+  if (close(fd) != 0 || total < length) {
+    fprintf(stderr, "Failed to write %s\n", filePath);
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  if (rename(temporaryPath, filePath) != 0) {
+    perror("rename");
+    unlink(temporaryPath);
+    free(temporaryPath);
+    return 1;
+  }
+
+  free(temporaryPath);
+
+  return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef TABLE_WRITER_H
+#define TABLE_WRITER_H
+/**
+ * @file table-writer.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for formatting output tables into a single
+ *        buffer and writing them atomically.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup table-writer Table Writer
+ * @{
+ */
+
+#include "types.h"
+#include <stddef.h>
+
+/// Upper bound of characters written by formatFixed(), enough for any finite double with 10 decimals
+#define FIXED_FORMAT_MAX 336
+
+/// Upper bound of characters of a single table row
+#define TABLE_ROW_MAX (3 * FIXED_FORMAT_MAX + 8)
+
+/// Number of bytes per row initially reserved when formatting a table
+#define TABLE_ROW_ESTIMATE 40
+
+/**
+ * @brief Format a double with a fixed number of decimals
+ *
+ * @details The output is identical to `printf("%.*lf", decimals, value)`. The value is scaled and
+ *          rounded with integer arithmetic. Values whose rounding can't be decided with certainty
+ *          this way, i.e. those close to a tie or too large, as well as non-finite values are
+ *          formatted with `snprintf` instead.
+ *
+ * @param value Value to format.
+ * @param decimals Number of decimals, in range [0, 15].
+ * @param out Buffer of at least FIXED_FORMAT_MAX bytes, not null-terminated by this function.
+ * @return size_t Number of characters written.
+ */
+size_t formatFixed(double value, int decimals, char *out);
+
+/**
+ * @brief Format area weighted means in format usable by FORCE
+ *
+ * @details Each row holds longitude and latitude with 4 decimals and the water column height, or the
+ *          value of another variable, with 10 decimals followed by "ERA", or "9999 TBD" if no value
+ *          could be computed.
+ *
+ * @note The caller must free the returned buffer.
+ *
+ * @param values Vector containing centroids of AOI geometries and associated water column value.
+ * @param length Set to the number of characters of the table.
+ * @return char* Table, not null-terminated, NULL on error.
+ */
+[[nodiscard]] char *formatWeightedMeans(const meanVector *values, size_t *length);
+
+/**
+ * @brief Write a buffer to a file with as few `write` calls as possible
+ *
+ * @details The buffer is written to a temporary file first, which is moved into place afterwards.
+ *          Thus, readers never observe a partially written file.
+ *
+ * @param filePath Path to file.
+ * @param data Buffer to write.
+ * @param length Number of bytes to write.
+ * @return int 0 on success, 1 on error.
+ */
+int writeFileAtomically(const char *filePath, const char *data, size_t length);
+
+/** @} */ // end of group
+#endif // TABLE_WRITER_H
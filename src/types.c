@@ -3,11 +3,18 @@
 #include <geos_c.h>
 #include <stdlib.h>
 
+void freeCompactPolygon(compactPolygon *polygon)
+{
+  // offsets are part of the same allocation
+  free(polygon->coordinates);
+  polygon->coordinates = NULL;
+  polygon->ringOffsets = NULL;
+  polygon->partOffsets = NULL;
+}
+
 void freeVectorGeometry(struct vectorGeometry *node)
 {
-  OGR_G_DestroyGeometry(node->OGRGeometry);
-  GEOSGeom_destroy(node->geometry);
-  GEOSGeom_destroy(node->mbr);
+  freeCompactPolygon(&node->polygon);
 }
 
 void freeVectorGeometryList(vectorGeometryVector *vector)
@@ -54,6 +61,11 @@ void freeIntersections(intersectionVector *vector)
     }
   }
 
+  // GEOS geometries of references are built per query and owned by the vector
+  for (size_t i = 0; i < vector->size; i++) {
+    GEOSGeom_destroy(vector->entries[i].referenceASGEOS);
+  }
+
   free(vector->entries);
   free(vector);
 }
@@ -64,12 +76,54 @@ void freeWeightedMeans(meanVector *vector)
   free(vector);
 }
 
+void freeWeightTable(weightTable *table)
+{
+  for (size_t i = 0; i < table->size; i++) {
+    free(table->entries[i].cells);
+    free(table->entries[i].weights);
+  }
+
+  free(table->entries);
+  table->entries = NULL;
+  table->size = 0;
+}
+
+void freeDayProducts(struct dayProducts *products)
+{
+  for (size_t i = 0; i < products->size; i++) {
+    if (products->entries[i].values != NULL) {
+      freeWeightedMeans(products->entries[i].values);
+    }
+  }
+
+  free(products->entries);
+  products->entries = NULL;
+  products->size = 0;
+
+  if (products->dailyMean != NULL) {
+    freeWeightedMeans(products->dailyMean);
+    products->dailyMean = NULL;
+  }
+}
+
 void freeOption(option_t *options)
 {
   if (!options)
     return;
 
   free(options->authenticationToken);
+
+  for (size_t i = 0; i < options->aoiSetCount; i++) {
+    free(options->aoiSets[i].buffer);
+    free(options->aoiSets[i].outputDirectory);
+    free(options->aoiSets[i].aoiCache);
+
+    if (options->aoiSets[i].areasOfInterest != NULL) {
+      freeVectorGeometryList(options->aoiSets[i].areasOfInterest);
+    }
+  }
+
+  free(options->aoiSets);
   free(options);
 }
 
@@ -12,8 +12,12 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sys/types.h>
 #include <geos_c.h>
 #include <gdal/gdal.h>
 
@@ -21,6 +25,7 @@
 #define MAXMONTH 12
 #define MAXDAY 31
 #define MAXHOUR 24
+#define WORKER_MAX_DEPTH 2
 
 // from gdal-ops
 typedef enum
@@ -74,6 +79,19 @@ struct m
   double x;
   double y;
   double value;
+  GIntBig fid;
+  uint64_t hash;
+  size_t order;
+};
+
+/**
+ * @struct tableProvenance
+ * @brief Hashes of the inputs an output table was computed from, see the manifest module.
+ */
+struct tableProvenance
+{
+  uint64_t input;
+  uint64_t features;
 };
 
 typedef struct
@@ -81,17 +99,96 @@ typedef struct
   struct m *entries;
   size_t size;
   size_t capcity;
+  struct tableProvenance provenance;
+  size_t featureCount;
+  int year;
+  int month;
+  int day;
+  bool completesDay;
+  bool recordManifest;
+  unsigned int variable;
 } meanVector;
 
+/**
+ * @struct featureWeights
+ * @brief Raster cells intersecting a single AOI feature together with their area weights. Cells
+ *        which must not contribute to the average are set to SIZE_MAX.
+ */
+struct featureWeights
+{
+  size_t count;
+  size_t *cells;
+  double *weights;
+};
+
+/**
+ * @struct weightTable
+ * @brief Area weights of all AOI features of a day table, in the order of the intersections they
+ *        were computed from. Shared by all temporal aggregations of a day.
+ */
+typedef struct weightTable
+{
+  struct featureWeights *entries;
+  size_t size;
+} weightTable;
+
+/**
+ * @struct aggregatedTable
+ * @brief Output table of a temporal aggregation other than the daily mean. `hour` is only set for
+ *        hourly tables.
+ */
+struct aggregatedTable
+{
+  meanVector *values;
+  unsigned int aggregation;
+  int hour;
+  unsigned int variable;
+};
+
+/**
+ * @struct dayProducts
+ * @brief Tables of all temporal aggregations of a day besides the daily mean, in the order they're
+ *        written. If values are interpolated at acquisition times, `dailyMean` keeps the daily mean
+ *        for the climatology, otherwise it's NULL.
+ */
+struct dayProducts
+{
+  struct aggregatedTable *entries;
+  size_t size;
+  meanVector *dailyMean;
+};
+
+// from polygon-store
+/**
+ * @struct compactPolygon
+ * @brief Flat representation of a polygon or multipolygon. Coordinates of all rings are stored as
+ *        interleaved x/y pairs. `ringOffsets[r]` is the index of the first point of ring r and
+ *        `partOffsets[p]` the index of the first ring of polygon p, the first ring being the
+ *        exterior one. Both offset arrays end with the total count. Coordinates and offsets share a
+ *        single allocation owned by `coordinates`.
+ */
+typedef struct compactPolygon
+{
+  double *coordinates;
+  uint32_t *ringOffsets;
+  uint32_t *partOffsets;
+  uint32_t pointCount;
+  uint32_t ringCount;
+  uint32_t partCount;
+  bool isMulti;
+  OGREnvelope envelope;
+} compactPolygon;
+
 // from strtree
 struct vectorGeometry
 {
-  GEOSGeometry *mbr;
-  GEOSGeometry *geometry;
-  OGRGeometryH OGRGeometry;
+  compactPolygon polygon;
   GIntBig id;
   double precomutedLongitude;
   double precomputedLatitude;
+  double acquisitionHour;
+  uint64_t hash;
+  size_t order;
 };
 
 typedef struct vectorGeometryList
@@ -105,12 +202,14 @@ typedef struct vectorGeometryVector
   struct vectorGeometry *entries;
   size_t size;
   size_t capacity;
+  uint64_t digest;
 } vectorGeometryVector;
 
 struct cellGeometry
 {
   GEOSGeometry *geometry;
   double value;
+  size_t index;
 };
 
 typedef struct cellGeometryList
@@ -130,13 +229,15 @@ typedef struct intersection
 
 struct i
 {
-  OGRGeometryH reference;
-  const GEOSGeometry *referenceASGEOS;
+  const compactPolygon *reference;
+  GEOSGeometry *referenceASGEOS;
   GIntBig referenceFID;
   cellGeometryList *intersectingCells;
   size_t intersectionCount;
   double precomutedLongitude;
   double precomputedLatitude;
+  uint64_t referenceHash;
+  size_t referenceOrder;
 };
 
 typedef struct
@@ -146,15 +247,46 @@ typedef struct
   size_t capacity;
 } intersectionVector;
 
+/**
+ * @struct ingestContext
+ * @brief Shared state of threads reading AOI features in parallel. The reader publishes features by
+ *        increasing `ready`, worker threads claim the next feature to convert by increasing `next`.
+ */
+struct ingestContext
+{
+  vectorGeometryVector *geometries;
+  OGRGeometryH *pending;
+  char *sourceWKT;
+  char *targetWKT;
+  bool reproject;
+  bool usePrecomputedCentroid;
+  size_t ready;
+  size_t next;
+  bool readerDone;
+  bool failed;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+};
+
 typedef struct userdata
 {
+  const compactPolygon *polygon;
+  GEOSGeometry *geometry;
   const GEOSPreparedGeometry *queryGeometry;
+  bool failed;
   cellGeometryList *intersectingCells;
   size_t intersectionCount;
 } userdata_t;
 
 /**
- * @brief Free a single OGR vector geometry node and all encapsulated fields
+ * @brief Free storage of a compact polygon
+ *
+ * @param polygon Polygon to free
+ */
+void freeCompactPolygon(compactPolygon *polygon);
+
+/**
+ * @brief Free a single vector geometry node and all encapsulated fields
  *
  * @param node Node to free
  */
@@ -200,7 +332,28 @@ void freeIntersections(intersectionVector *vector);
  */
 void freeWeightedMeans(meanVector *vector);
 
+/**
+ * @brief Free the area weights of all features held by a weight table
+ *
+ * @note The table itself is not freed.
+ *
+ * @param table Table to free
+ */
+void freeWeightTable(weightTable *table);
+
+/**
+ * @brief Free all tables held by day products
+ *
+ * @note The struct itself is not freed.
+ *
+ * @param products Products to free
+ */
+void freeDayProducts(struct dayProducts *products);
+
 // options
+struct aoiSet;
+struct intersectionExport;
+
 typedef struct options
 {
   bool printHelp;
@@ -221,12 +374,64 @@ typedef struct options
   char *authenticationToken;
   bool download;
   bool process;
+  bool exportStore;
   bool footprint;
   bool usePrecomputedCentroid;
+  bool pipeline;
+  int jobs;
+  bool shardClaim;
+  int claimExpiry;
+  bool deterministic;
+  size_t memoryBudget;
+  bool incremental;
+  char *aoiCache;
+  int threads;
+  double simplifyTolerance;
+  bool spatialFilter;
+  bool store;
+  char *storePath;
+  bool exportSeries;
+  bool query;
+  bool queryByFid;
+  GIntBig queryFid;
+  bool queryByLocation;
+  double queryLongitude;
+  double queryLatitude;
+  // first and last date of a query as YYYYMMDD
+  int queryFrom;
+  int queryTo;
+  unsigned int aggregations;
+  bool climatology;
+  char *acquisitionTimeField;
+  unsigned int variables;
+  struct aoiSet *aoiSets;
+  size_t aoiSetCount;
+  char *intersectionExportPath;
+  struct intersectionExport *intersectionExport;
 } option_t;
 
+/**
+ * @struct aoiSet
+ * @brief An additional AOI processed from the same rasters as the main one, given as
+ *        `name=path[@layer]`. `buffer` holds the parsed argument, `name`, `filePath` and `layerName`
+ *        point into it. Its tables are written to the subdirectory `name` of the output directory,
+ *        `options` are the options of the main AOI with paths replaced accordingly.
+ */
+struct aoiSet
+{
+  char *buffer;
+  char *name;
+  char *filePath;
+  char *layerName;
+  char *outputDirectory;
+  char *aoiCache;
+  vectorGeometryVector *areasOfInterest;
+  option_t options;
+};
+
 /**
  * @brief Free all heap-allocated objects within the `option` object, including the reference itself
+ *        and the geometries of additional AOIs
  *
  * @param option Object to free
  */
@@ -248,10 +453,16 @@ typedef enum
   ERROR
 } productStatus;
 
+/**
+ * @struct stringList
+ * @brief Linked list of log file entries. `completedDays` holds a bit per day of month (bit 0 being
+ *        the first day) whose output table was written while the entry wasn't processed completely.
+ */
 typedef struct stringList
 {
   char *string;
   char *status;
+  unsigned int completedDays;
   struct stringList *next;
 } stringList;
 
@@ -262,4 +473,351 @@ typedef struct stringList
  */
 void freeStringList(stringList *list);
 
+// from queue
+typedef struct boundedQueue
+{
+  void **items;
+  size_t capacity;
+  size_t head;
+  size_t count;
+  bool closed;
+  pthread_mutex_t lock;
+  pthread_cond_t notEmpty;
+  pthread_cond_t notFull;
+} boundedQueue;
+
+// from haze
+/**
+ * @struct loadedDataset
+ * @brief This struct holds a dataset read into memory together with the temporal information
+ *        back-filled from its band metadata, i.e. everything needed to compute output tables
+ *        without touching the file again.
+ */
+struct loadedDataset
+{
+  stringList *entry;
+  option_t temporal;
+  int layerCount;
+  int variableCount;
+  struct rawData data;
+  struct geoTransform transform;
+  bool failed;
+};
+
+/**
+ * @struct dayGrid
+ * @brief This struct holds the bands of a day averaged into a single grid together with the
+ *        STRTree of its cells, i.e. everything shared by all AOIs intersected with that day.
+ */
+struct dayGrid
+{
+  struct averagedData average;
+  cellGeometryList *cells;
+  GEOSSTRtree *tree;
+};
+
+/**
+ * @struct entryProvider
+ * @brief This struct decouples the selection of log file entries to process from the actual
+ *        processing. `next` returns the next entry to process (NULL if exhausted) and `complete`
+ *        is called exactly once for every entry returned by `next`. `completeDay` is called for every
+ *        output table written before the entry is completed.
+ */
+typedef struct entryProvider
+{
+  stringList *(*next)(struct entryProvider *provider);
+  void (*complete)(struct entryProvider *provider, stringList *entry, bool success);
+  void (*completeDay)(struct entryProvider *provider, stringList *entry, int day);
+  void *state;
+  struct statusJournal *journal;
+} entryProvider;
+
+/**
+ * @brief Callback receiving finished output tables for day `day` of log file entry `entry`. The
+ *        callback takes ownership of both `values` and `filePath`, regardless of its return value
+ *        (0 on success, 1 on error).
+ */
+typedef int (*tableSink)(meanVector *values, char *filePath, stringList *entry, int day,
+                         void *sinkData);
+
+// from pipeline
+/**
+ * @struct pipelineJob
+ * @brief Unit of work handed to the writer stage. If `values` is NULL, the job marks the end of
+ *        all tables belonging to log file entry `entry`, otherwise `values` should be written to
+ *        `filePath` and day `day` of `entry` is completed afterwards.
+ */
+struct pipelineJob
+{
+  meanVector *values;
+  char *filePath;
+  stringList *entry;
+  int day;
+  bool success;
+};
+
+/**
+ * @struct readerContext
+ * @brief Arguments of the reader stage thread.
+ */
+struct readerContext
+{
+  entryProvider *provider;
+  const vectorGeometryVector *areasOfInterest;
+  const option_t *options;
+  boundedQueue *datasets;
+  bool failed;
+};
+
+/**
+ * @struct writerContext
+ * @brief Arguments of the writer stage thread.
+ */
+struct writerContext
+{
+  entryProvider *provider;
+  boundedQueue *jobs;
+};
+
+// from workers
+/**
+ * @struct workerResult
+ * @brief Message sent from a worker process to the parent once a log file entry (`day` is 0) or a
+ *        single day of it is completed. `index` refers to the position of the entry among all
+ *        entries dispatched by the parent.
+ */
+struct workerResult
+{
+  size_t index;
+  int day;
+  bool success;
+};
+
+/**
+ * @struct workerHandle
+ * @brief Parent-side bookkeeping of a single worker process.
+ */
+typedef struct workerHandle
+{
+  pid_t pid;
+  int taskFd;
+  int resultFd;
+  size_t outstanding;
+  size_t assigned[WORKER_MAX_DEPTH];
+} workerHandle;
+
+/**
+ * @struct workerSchedule
+ * @brief Parent-side bookkeeping of dispatched entries and their estimated memory footprints.
+ *        A `budget` of 0 disables memory-aware admission.
+ */
+typedef struct workerSchedule
+{
+  stringList **entries;
+  size_t *estimates;
+  bool *dispatched;
+  size_t entryCount;
+  size_t remaining;
+  size_t budget;
+  size_t inUse;
+  size_t inFlight;
+} workerSchedule;
+
+/**
+ * @struct workerState
+ * @brief Worker-side state of the entry provider reading tasks from the parent.
+ */
+struct workerState
+{
+  stringList **entries;
+  size_t entryCount;
+  int taskFd;
+  int resultFd;
+};
+
+// from claims
+/**
+ * @struct claimState
+ * @brief State of the entry provider coordinating multiple haze instances via claim files.
+ *        Claims currently held by this instance are tracked in `held` and kept alive by a
+ *        heartbeat thread, which touches them regularly. The heartbeat touches `instancePath` as
+ *        well, whose modification time is the clock of the shared file system.
+ */
+typedef struct claimState
+{
+  stringList *cursor;
+  char *claimDirectory;
+  char *instance;
+  char *instancePath;
+  int expiry;
+  char **held;
+  size_t heldCount;
+  size_t heldCapacity;
+  bool stop;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_t heartbeat;
+} claimState;
+
+// from math-utils
+/**
+ * @struct contribution
+ * @brief Value and weight of a single raster cell contributing to a weighted average.
+ */
+struct contribution
+{
+  size_t cell;
+  double value;
+  double weight;
+};
+
+/**
+ * @struct curveKey
+ * @brief Position of an element along a space-filling curve.
+ */
+struct curveKey
+{
+  uint64_t key;
+  size_t index;
+};
+
+// from journal
+/**
+ * @struct statusJournal
+ * @brief Append-only journal of status changes belonging to a log file. Records are buffered
+ *        and written in batches of `syncInterval` records.
+ */
+typedef struct statusJournal
+{
+  char *logFile;
+  char *journalPath;
+  char *buffer;
+  size_t length;
+  size_t capacity;
+  size_t pending;
+  size_t syncInterval;
+  pthread_mutex_t lock;
+} statusJournal;
+
+/**
+ * @struct logIndex
+ * @brief Hash table (open addressing, linear probing) mapping dataset paths to log file entries.
+ */
+typedef struct logIndex
+{
+  stringList **slots;
+  size_t capacity;
+  size_t size;
+} logIndex;
+
+// from manifest
+/**
+ * @struct tableManifest
+ * @brief Contents of the manifest stored next to an output table: hashes of the inputs the table
+ *        was computed from and all of its rows, including the feature each row belongs to.
+ */
+typedef struct tableManifest
+{
+  struct tableProvenance provenance;
+  struct m *rows;
+  size_t size;
+  size_t capacity;
+} tableManifest;
+
+// from output-store
+/**
+ * @struct storeHeader
+ * @brief Header at the start of an output store. It's followed by the features table, the index
+ *        holding one entry per day slot and the day x feature matrix of values.
+ */
+struct storeHeader
+{
+  char magic[8];
+  uint32_t year;
+  uint32_t daySlots;
+  uint64_t featureCount;
+  uint64_t features;
+};
+
+/**
+ * @struct storeFeature
+ * @brief Entry of the features table of an output store. The FID is OGRNullFID until a value of
+ *        the feature was written.
+ */
+struct storeFeature
+{
+  GIntBig fid;
+  double x;
+  double y;
+};
+
+// from climatology
+/**
+ * @struct climatologyCell
+ * @brief Running sums of the values of a single feature on a single day of year.
+ */
+struct climatologyCell
+{
+  double sum;
+  double sumOfSquares;
+  uint64_t count;
+};
+
+// from intersection-export
+/**
+ * @struct exportedIntersection
+ * @brief A single intersection of an AOI feature and a raster cell waiting to be exported. The
+ *        geometry is owned by the record.
+ */
+struct exportedIntersection
+{
+  GIntBig fid;
+  GIntBig cell;
+  double value;
+  double weight;
+  const char *aoi;
+  int year;
+  int month;
+  int day;
+  OGRGeometryH geometry;
+};
+
+/**
+ * @struct intersectionBatch
+ * @brief Intersections handed to the writer thread at once.
+ */
+struct intersectionBatch
+{
+  struct exportedIntersection *entries;
+  size_t size;
+};
+
+/**
+ * @struct intersectionExport
+ * @brief Vector dataset intersections are exported to. It's opened once the first intersection is
+ *        exported, thus each worker process opens its own. Batches are written by a background
+ *        thread in transactions of INTERSECTION_TRANSACTION_SIZE features if the format supports
+ *        them. `aoi`, `year`, `month` and `day` are attached to each exported intersection.
+ */
+typedef struct intersectionExport
+{
+  char *path;
+  bool perProcess;
+  bool opened;
+  bool failed;
+  bool transactions;
+  size_t uncommitted;
+  size_t written;
+  GDALDatasetH dataset;
+  OGRLayerH layer;
+  struct intersectionBatch *current;
+  boundedQueue batches;
+  pthread_t writer;
+  pthread_mutex_t lock;
+  const char *aoi;
+  int year;
+  int month;
+  int day;
+} intersectionExport;
+
 #endif //TYPES_H
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "variables.h"
+#include "math-utils.h"
+#include <stddef.h>
+
+const char *variableRequestName(unsigned int variable)
+{
+  switch (variable) {
+    case VARIABLE_TOTAL_COLUMN_WATER_VAPOUR:
+      return "total_column_water_vapour";
+    case VARIABLE_SURFACE_PRESSURE:
+      return "surface_pressure";
+    case VARIABLE_TOTAL_COLUMN_OZONE:
+      return "total_column_ozone";
+    default:
+      return NULL;
+  }
+}
+
+const char *variableElement(unsigned int variable)
+{
+  switch (variable) {
+    case VARIABLE_TOTAL_COLUMN_WATER_VAPOUR:
+      return "TCWV";
+    case VARIABLE_SURFACE_PRESSURE:
+      return "SP";
+    case VARIABLE_TOTAL_COLUMN_OZONE:
+      return "TCO3";
+    default:
+      return NULL;
+  }
+}
+
+const char *variablePrefix(unsigned int variable)
+{
+  switch (variable) {
+    case VARIABLE_TOTAL_COLUMN_WATER_VAPOUR:
+      return "WVP";
+    case VARIABLE_SURFACE_PRESSURE:
+      return "SP";
+    case VARIABLE_TOTAL_COLUMN_OZONE:
+      return "TCO3";
+    default:
+      return NULL;
+  }
+}
+
+double variableValue(double value, unsigned int variable)
+{
+  switch (variable) {
+    case VARIABLE_SURFACE_PRESSURE:
+      [[fallthrough]];
+    case VARIABLE_TOTAL_COLUMN_OZONE:
+      return value;
+    default:
+      return kgsqmTocow(value);
+  }
+}
+
+int variableCount(unsigned int variables)
+{
+  int count = 0;
+
+  for (unsigned int flag = 1u; flag <= VARIABLE_LAST; flag <<= 1) {
+    count += (variables & flag) ? 1 : 0;
+  }
+
+  return count;
+}
+
+unsigned int nthVariable(unsigned int variables, int index)
+{
+  for (unsigned int flag = 1u; flag <= VARIABLE_LAST; flag <<= 1) {
+    if (!(variables & flag)) {
+      continue;
+    }
+
+    if (index == 0) {
+      return flag;
+    }
+
+    index--;
+  }
+
+  return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef VARIABLES_H
+#define VARIABLES_H
+/**
+ * @file variables.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures to map ERA5 single level variables to their
+ *        names in requests, GRIB elements and output tables.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup variables Variables
+ * @{
+ */
+
+/// Total column water vapour, always processed, written to 'WVP_YYYY-MM-DD.txt'
+#define VARIABLE_TOTAL_COLUMN_WATER_VAPOUR 1u
+
+/// Surface pressure, written to 'SP_YYYY-MM-DD.txt'
+#define VARIABLE_SURFACE_PRESSURE 2u
+
+/// Total column ozone, written to 'TCO3_YYYY-MM-DD.txt'
+#define VARIABLE_TOTAL_COLUMN_OZONE 4u
+
+/// Largest VARIABLE_* flag
+#define VARIABLE_LAST VARIABLE_TOTAL_COLUMN_OZONE
+
+/**
+ * @brief Get the name of a variable as used in CDS requests
+ *
+ * @param variable A single VARIABLE_* flag.
+ * @return const char* Name of the variable, NULL if the flag is unknown.
+ */
+const char *variableRequestName(unsigned int variable);
+
+/**
+ * @brief Get the GRIB element of a variable as reported by GDAL in 'GRIB_ELEMENT'
+ *
+ * @param variable A single VARIABLE_* flag.
+ * @return const char* Element of the variable, NULL if the flag is unknown.
+ */
+const char *variableElement(unsigned int variable);
+
+/**
+ * @brief Get the prefix of output tables of a variable
+ *
+ * @param variable A single VARIABLE_* flag.
+ * @return const char* Prefix of the variable, NULL if the flag is unknown.
+ */
+const char *variablePrefix(unsigned int variable);
+
+/**
+ * @brief Convert a value of a variable to the unit written to output tables
+ *
+ * @details Water vapor is converted to water column height as expected by FORCE, see kgsqmTocow().
+ *          Other variables are written in their ERA5 units.
+ *
+ * @param value Value in ERA5 units.
+ * @param variable A single VARIABLE_* flag, 0 is taken as water vapor.
+ * @return double Converted value.
+ */
+double variableValue(double value, unsigned int variable);
+
+/**
+ * @brief Count the variables of a set of VARIABLE_* flags
+ *
+ * @param variables Selected VARIABLE_* flags.
+ * @return int Number of selected variables.
+ */
+int variableCount(unsigned int variables);
+
+/**
+ * @brief Get the n-th variable of a set of VARIABLE_* flags in ascending order of flags
+ *
+ * @param variables Selected VARIABLE_* flags.
+ * @param index Position of the variable, water vapor being the first if selected.
+ * @return unsigned int VARIABLE_* flag, 0 if fewer variables are selected.
+ */
+unsigned int nthVariable(unsigned int variables, int index);
+
+/** @} */ // end of group
+#endif // VARIABLES_H
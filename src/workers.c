@@ -0,0 +1,543 @@
+#define _POSIX_C_SOURCE 200809L
+#include "workers.h"
+#include "haze.h"
+#include "pipeline.h"
+#include "types.h"
+#include "gdal-ops.h"
+#include <gdal/gdal.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int readFull(int fd, void *buffer, size_t size)
+{
+  char *position = (char *) buffer;
+  size_t remaining = size;
+
+  while (remaining > 0) {
+    ssize_t bytesRead = read(fd, position, remaining);
+
+    if (bytesRead < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("read");
+      return 1;
+    }
+
+    if (bytesRead == 0) {
+      // a clean end of file is only possible at message boundaries
+      return remaining == size ? -1 : 1;
+    }
+
+    position += bytesRead;
+    remaining -= (size_t) bytesRead;
+  }
+
+  return 0;
+}
+
+int writeFull(int fd, const void *buffer, size_t size)
+{
+  const char *position = (const char *) buffer;
+  size_t remaining = size;
+
+  while (remaining > 0) {
+    ssize_t bytesWritten = write(fd, position, remaining);
+
+    if (bytesWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("write");
+      return 1;
+    }
+
+    position += bytesWritten;
+    remaining -= (size_t) bytesWritten;
+  }
+
+  return 0;
+}
+
+stringList *nextDispatchedEntry(entryProvider *provider)
+{
+  struct workerState *state = (struct workerState *) provider->state;
+  size_t index;
+
+  if (readFull(state->taskFd, &index, sizeof(size_t)) != 0) {
+    return NULL;
+  }
+
+  if (index >= state->entryCount) {
+    fprintf(stderr, "Received invalid task %lu from parent process\n", index);
+    return NULL;
+  }
+
+  return state->entries[index];
+}
+
+int sendWorkerResult(struct workerState *state, stringList *entry, int day, bool success)
+{
+  struct workerResult result = {.index = state->entryCount, .day = day, .success = success};
+
+  // entries array is inherited from the parent, thus indices agree between processes
+  for (size_t i = 0; i < state->entryCount; i++) {
+    if (state->entries[i] == entry) {
+      result.index = i;
+      break;
+    }
+  }
+
+  if (result.index == state->entryCount) {
+    return 1;
+  }
+
+  return writeFull(state->resultFd, &result, sizeof(struct workerResult));
+}
+
+void reportEntry(entryProvider *provider, stringList *entry, bool success)
+{
+  if (sendWorkerResult((struct workerState *) provider->state, entry, 0, success)) {
+    fprintf(stderr, "Failed to report status of %s to parent process\n", entry->string);
+  }
+}
+
+void reportDay(entryProvider *provider, stringList *entry, int day)
+{
+  if (sendWorkerResult((struct workerState *) provider->state, entry, day, true)) {
+    fprintf(stderr, "Failed to report day %d of %s to parent process\n", day, entry->string);
+  }
+}
+
+size_t estimateFootprint(size_t bands, size_t rows, size_t columns, size_t features)
+{
+  size_t cells = rows * columns;
+
+  // a pipelined worker holds several datasets, but each of them is in flight and counted on its own
+  return bands * cells * sizeof(double)
+         + cells * (sizeof(double) + ESTIMATE_CELL_BYTES)
+         + features * ESTIMATE_FEATURE_BYTES;
+}
+
+int estimateFootprints(stringList **entries, size_t entryCount, size_t features,
+                       size_t *estimates)
+{
+  for (size_t i = 0; i < entryCount; i++) {
+    // only metadata is read here, decoding happens in workers
+    GDALDatasetH ds = openRasterDataset(entries[i]->string);
+
+    if (ds == NULL) {
+      // worker will fail quickly on this dataset as well
+      estimates[i] = 0;
+      continue;
+    }
+
+    estimates[i] = estimateFootprint((size_t) GDALGetRasterCount(ds),
+                                     (size_t) GDALGetRasterYSize(ds),
+                                     (size_t) GDALGetRasterXSize(ds), features);
+
+    closeGDALDataset(ds);
+  }
+
+  return 0;
+}
+
+size_t selectEntry(const workerSchedule *schedule)
+{
+  size_t firstUndispatched = schedule->entryCount;
+
+  for (size_t i = 0; i < schedule->entryCount && schedule->remaining > 0; i++) {
+    if (schedule->dispatched[i]) {
+      continue;
+    }
+
+    if (schedule->budget == 0 || schedule->inUse + schedule->estimates[i] <= schedule->budget) {
+      return i;
+    }
+
+    if (firstUndispatched == schedule->entryCount) {
+      firstUndispatched = i;
+    }
+  }
+
+  // datasets exceeding the budget on their own are processed once nothing else is in flight
+  return schedule->inFlight == 0 ? firstUndispatched : schedule->entryCount;
+}
+
+int dispatchEntry(workerHandle *worker, workerSchedule *schedule)
+{
+  if (worker->taskFd < 0 || worker->outstanding == WORKER_MAX_DEPTH) {
+    return 1;
+  }
+
+  size_t index = selectEntry(schedule);
+
+  if (index == schedule->entryCount) {
+    return 1;
+  }
+
+  if (writeFull(worker->taskFd, &index, sizeof(size_t))) {
+    fprintf(stderr, "Failed to hand out dataset to worker %d\n", (int) worker->pid);
+    close(worker->taskFd);
+    worker->taskFd = -1;
+    return 1;
+  }
+
+  if (schedule->budget != 0 && schedule->inUse + schedule->estimates[index] > schedule->budget) {
+    fprintf(stderr, "Estimated memory footprint of %s exceeds memory budget, processing it on its own\n",
+            schedule->entries[index]->string);
+  }
+
+  schedule->dispatched[index] = true;
+  schedule->remaining--;
+  schedule->inUse += schedule->estimates[index];
+  schedule->inFlight++;
+
+  worker->assigned[worker->outstanding] = index;
+  worker->outstanding++;
+
+  return 0;
+}
+
+void releaseEntry(workerHandle *worker, workerSchedule *schedule, size_t index)
+{
+  for (size_t i = 0; i < worker->outstanding; i++) {
+    if (worker->assigned[i] == index) {
+      worker->assigned[i] = worker->assigned[worker->outstanding - 1];
+      worker->outstanding--;
+      schedule->inUse -= schedule->estimates[index];
+      schedule->inFlight--;
+      return;
+    }
+  }
+}
+
+void fillIdleWorkers(workerHandle *workers, size_t workerCount, workerSchedule *schedule,
+                     size_t depth)
+{
+  for (size_t i = 0; i < workerCount; i++) {
+    while (workers[i].outstanding < depth && dispatchEntry(&workers[i], schedule) == 0)
+      ;
+  }
+
+  if (schedule->remaining == 0) {
+    // no more work, let workers drain their backlog and exit
+    for (size_t i = 0; i < workerCount; i++) {
+      if (workers[i].taskFd >= 0) {
+        close(workers[i].taskFd);
+        workers[i].taskFd = -1;
+      }
+    }
+  }
+}
+
+int runWorkers(entryProvider *provider, vectorGeometryVector *areasOfInterest,
+               const option_t *options, bool *isWorker)
+{
+  *isWorker = false;
+
+  size_t entryCount = 0;
+  size_t entryCapacity = 64;
+  stringList **entries = calloc(entryCapacity, sizeof(stringList *));
+  if (entries == NULL) {
+    perror("calloc");
+    return 1;
+  }
+
+  stringList *entry;
+  while ((entry = provider->next(provider)) != NULL) {
+    if (entryCount == entryCapacity) {
+      entryCapacity *= 2;
+      stringList **newEntries = realloc(entries, entryCapacity * sizeof(stringList *));
+      if (newEntries == NULL) {
+        perror("realloc");
+        free(entries);
+        return 1;
+      }
+      entries = newEntries;
+    }
+    entries[entryCount++] = entry;
+  }
+
+  if (entryCount == 0) {
+    free(entries);
+    return 0;
+  }
+
+  size_t workerCount = (size_t) options->jobs < entryCount ? (size_t) options->jobs : entryCount;
+  // the pipelined mode only overlaps reading and computation if a second entry is available
+  size_t depth = options->pipeline ? 2 : 1;
+
+  size_t *estimates = calloc(entryCount, sizeof(size_t));
+  bool *dispatched = calloc(entryCount, sizeof(bool));
+  if (estimates == NULL || dispatched == NULL) {
+    perror("calloc");
+    free(estimates);
+    free(dispatched);
+    free(entries);
+    return 1;
+  }
+
+  if (options->memoryBudget != 0) {
+    // tables of all AOIs of a day may be held at once
+    size_t featureCount = areasOfInterest->size;
+
+    for (size_t i = 0; i < options->aoiSetCount; i++) {
+      featureCount += options->aoiSets[i].areasOfInterest->size;
+    }
+
+    estimateFootprints(entries, entryCount, featureCount, estimates);
+  }
+
+  workerSchedule schedule = {
+    .entries = entries,
+    .estimates = estimates,
+    .dispatched = dispatched,
+    .entryCount = entryCount,
+    .remaining = entryCount,
+    .budget = options->memoryBudget,
+    .inUse = 0,
+    .inFlight = 0
+  };
+
+  workerHandle *workers = calloc(workerCount, sizeof(workerHandle));
+  if (workers == NULL) {
+    perror("calloc");
+    free(estimates);
+    free(dispatched);
+    free(entries);
+    return 1;
+  }
+
+  // a worker that dies should not take the parent with it when writing to its task pipe
+  struct sigaction ignorePipe = {.sa_handler = SIG_IGN};
+  struct sigaction previousPipe;
+  sigemptyset(&ignorePipe.sa_mask);
+  sigaction(SIGPIPE, &ignorePipe, &previousPipe);
+
+  int status = 0;
+  size_t started = 0;
+
+  for (; started < workerCount; started++) {
+    int taskPipe[2];
+    int resultPipe[2];
+
+    if (pipe(taskPipe) != 0) {
+      perror("pipe");
+      status = 1;
+      break;
+    }
+
+    if (pipe(resultPipe) != 0) {
+      perror("pipe");
+      close(taskPipe[0]);
+      close(taskPipe[1]);
+      status = 1;
+      break;
+    }
+
+    // don't duplicate buffered output in children
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+
+    if (pid < 0) {
+      perror("fork");
+      close(taskPipe[0]);
+      close(taskPipe[1]);
+      close(resultPipe[0]);
+      close(resultPipe[1]);
+      status = 1;
+      break;
+    }
+
+    if (pid == 0) {
+      *isWorker = true;
+      sigaction(SIGPIPE, &previousPipe, NULL);
+
+      // pipe ends of previously started workers are of no concern to this worker
+      for (size_t i = 0; i < started; i++) {
+        close(workers[i].taskFd);
+        close(workers[i].resultFd);
+      }
+      close(taskPipe[1]);
+      close(resultPipe[0]);
+
+      struct workerState state = {
+        .entries = entries,
+        .entryCount = entryCount,
+        .taskFd = taskPipe[0],
+        .resultFd = resultPipe[1]
+      };
+
+      entryProvider workerProvider = {
+        .next = nextDispatchedEntry,
+        .complete = reportEntry,
+        .completeDay = reportDay,
+        .state = (void *) &state
+      };
+
+      int workerStatus = options->pipeline
+                         ? runPipeline(&workerProvider, areasOfInterest, options)
+                         : processEntries(&workerProvider, areasOfInterest, options);
+
+      close(taskPipe[0]);
+      close(resultPipe[1]);
+      free(workers);
+      free(estimates);
+      free(dispatched);
+      free(entries);
+
+      return workerStatus;
+    }
+
+    close(taskPipe[0]);
+    close(resultPipe[1]);
+
+    workers[started].pid = pid;
+    workers[started].taskFd = taskPipe[1];
+    workers[started].resultFd = resultPipe[0];
+    workers[started].outstanding = 0;
+  }
+
+  if (started == 0) {
+    fprintf(stderr, "Failed to start any worker process\n");
+    sigaction(SIGPIPE, &previousPipe, NULL);
+    free(workers);
+    free(estimates);
+    free(dispatched);
+    free(entries);
+    return 1;
+  }
+
+  struct pollfd *pollFds = calloc(started, sizeof(struct pollfd));
+  if (pollFds == NULL) {
+    perror("calloc");
+    status = 1;
+  }
+
+  size_t alive = started;
+
+  if (pollFds == NULL) {
+    for (size_t i = 0; i < started; i++) {
+      close(workers[i].taskFd);
+      workers[i].taskFd = -1;
+    }
+  } else {
+    fillIdleWorkers(workers, started, &schedule, depth);
+  }
+
+  while (pollFds != NULL && alive > 0) {
+    for (size_t i = 0; i < started; i++) {
+      pollFds[i].fd = workers[i].resultFd;
+      pollFds[i].events = POLLIN;
+      pollFds[i].revents = 0;
+    }
+
+    if (poll(pollFds, (nfds_t) started, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("poll");
+      status = 1;
+      break;
+    }
+
+    for (size_t i = 0; i < started; i++) {
+      if (pollFds[i].revents == 0) {
+        continue;
+      }
+
+      struct workerResult result;
+      int readStatus = readFull(workers[i].resultFd, &result, sizeof(struct workerResult));
+
+      if (readStatus != 0) {
+        // worker exited; entries still assigned to it are left untouched in the log file
+        if (workers[i].outstanding > 0) {
+          fprintf(stderr, "Worker %d terminated with %lu unfinished dataset(s)\n", (int) workers[i].pid,
+                  workers[i].outstanding);
+          status = 1;
+        }
+        while (workers[i].outstanding > 0) {
+          releaseEntry(&workers[i], &schedule, workers[i].assigned[0]);
+        }
+        close(workers[i].resultFd);
+        workers[i].resultFd = -1;
+        if (workers[i].taskFd >= 0) {
+          close(workers[i].taskFd);
+          workers[i].taskFd = -1;
+        }
+        alive--;
+        continue;
+      }
+
+      if (result.index >= entryCount || workers[i].outstanding == 0) {
+        fprintf(stderr, "Received invalid result from worker %d\n", (int) workers[i].pid);
+        status = 1;
+        continue;
+      }
+
+      if (result.day != 0) {
+        // entry is still being processed by the worker
+        provider->completeDay(provider, entries[result.index], result.day);
+        continue;
+      }
+
+      releaseEntry(&workers[i], &schedule, result.index);
+      provider->complete(provider, entries[result.index], result.success);
+    }
+
+    // completed datasets free up budget, possibly for multiple smaller datasets
+    fillIdleWorkers(workers, started, &schedule, depth);
+  }
+
+  for (size_t i = 0; i < started; i++) {
+    if (workers[i].taskFd >= 0) {
+      close(workers[i].taskFd);
+    }
+    if (workers[i].resultFd >= 0) {
+      close(workers[i].resultFd);
+    }
+
+    int workerStatus = 0;
+    pid_t waited;
+    while ((waited = waitpid(workers[i].pid, &workerStatus, 0)) < 0 && errno == EINTR)
+      ;
+
+    if (waited < 0) {
+      perror("waitpid");
+      status = 1;
+      continue;
+    }
+
+    if (!WIFEXITED(workerStatus) || WEXITSTATUS(workerStatus) != EXIT_SUCCESS) {
+      fprintf(stderr, "Worker %d did not exit cleanly\n", (int) workers[i].pid);
+      status = 1;
+    }
+  }
+
+  sigaction(SIGPIPE, &previousPipe, NULL);
+
+  if (schedule.remaining > 0) {
+    fprintf(stderr, "%lu dataset(s) were not handed out to any worker\n", schedule.remaining);
+    status = 1;
+  }
+
+  free(pollFds);
+  free(workers);
+  free(estimates);
+  free(dispatched);
+  free(entries);
+
+  return status;
+}
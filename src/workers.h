@@ -0,0 +1,184 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+/**
+ * @file workers.h
+ * @author Florian Katerndahl <florian@katerndahl.com>
+ * @brief This header file describes function signatures for processing ERA-5 datasets with multiple worker processes.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * @defgroup workers Multi-Process Workers
+ * @{
+ */
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Maximum number of worker processes
+#define MAX_JOBS 1024
+
+/// Estimated bytes per raster cell for its GEOS geometry, list node and STRtree entry
+#define ESTIMATE_CELL_BYTES 512
+
+/// Estimated bytes per AOI feature for intersections, OGR copies and output rows
+#define ESTIMATE_FEATURE_BYTES 4096
+
+/**
+ * @brief Read exactly `size` bytes from a file descriptor
+ *
+ * @param fd File descriptor to read from.
+ * @param buffer Buffer of at least `size` bytes.
+ * @param size Number of bytes to read.
+ * @return int 0 on success, 1 on error, -1 if end of file was reached before any byte was read.
+ */
+int readFull(int fd, void *buffer, size_t size);
+
+/**
+ * @brief Write exactly `size` bytes to a file descriptor
+ *
+ * @param fd File descriptor to write to.
+ * @param buffer Buffer of at least `size` bytes.
+ * @param size Number of bytes to write.
+ * @return int 0 on success, 1 on error.
+ */
+int writeFull(int fd, const void *buffer, size_t size);
+
+/**
+ * @brief Entry provider callback of a worker, reading the index of the next entry from the parent
+ *
+ * @param provider Provider whose state is a reference to struct workerState.
+ * @return stringList* Next entry to process, NULL if the parent has no more work.
+ */
+stringList *nextDispatchedEntry(entryProvider *provider);
+
+/**
+ * @brief Send a result message to the parent
+ *
+ * @param state Worker-side state.
+ * @param entry Log file entry the message refers to.
+ * @param day Completed day of month, 0 if the entire entry is completed.
+ * @param success Whether processing was successful.
+ * @return int 0 on success, 1 on error.
+ */
+int sendWorkerResult(struct workerState *state, stringList *entry, int day, bool success);
+
+/**
+ * @brief Entry provider callback of a worker, reporting a completed entry to the parent
+ *
+ * @param provider Provider whose state is a reference to struct workerState.
+ * @param entry Log file entry which finished processing.
+ * @param success Whether all tables of the dataset were computed and written.
+ */
+void reportEntry(entryProvider *provider, stringList *entry, bool success);
+
+/**
+ * @brief Entry provider callback of a worker, reporting a written day of an entry to the parent
+ *
+ * @param provider Provider whose state is a reference to struct workerState.
+ * @param entry Log file entry the day belongs to.
+ * @param day Day of month.
+ */
+void reportDay(entryProvider *provider, stringList *entry, int day);
+
+/**
+ * @brief Estimate peak memory footprint of processing a dataset in a worker
+ *
+ * @details The estimate accounts for the raw data of a single dataset, per-day averages,
+ *          vectorized raster cells and per-feature intermediate results. It's meant as a
+ *          conservative guess, not an exact figure. Datasets held at once by a pipelined worker
+ *          are each accounted for while they're in flight.
+ *
+ * @param bands Number of bands in dataset.
+ * @param rows Number of rows in dataset.
+ * @param columns Number of columns in dataset.
+ * @param features Number of features in area of interest.
+ * @return size_t Estimated footprint in bytes.
+ */
+size_t estimateFootprint(size_t bands, size_t rows, size_t columns, size_t features);
+
+/**
+ * @brief Estimate peak memory footprint of all entries from their metadata
+ *
+ * @note Datasets are only opened to query their dimensions, no pixel data is read.
+ *
+ * @param entries Entries to estimate.
+ * @param entryCount Number of entries.
+ * @param features Number of features in area of interest.
+ * @param estimates Array of size `entryCount` receiving estimates in bytes, 0 if a dataset can't be opened.
+ * @return int 0 on success, 1 on error.
+ */
+int estimateFootprints(stringList **entries, size_t entryCount, size_t features,
+                       size_t *estimates);
+
+/**
+ * @brief Select the next entry to hand out
+ *
+ * @details The first undispatched entry fitting into the remaining budget is selected, such that
+ *          small datasets fill the slack left by large ones. An entry exceeding the budget on its
+ *          own is only selected when no other entry is in flight.
+ *
+ * @param schedule Reference to schedule.
+ * @return size_t Index of selected entry, `schedule->entryCount` if no entry can be selected right now.
+ */
+size_t selectEntry(const workerSchedule *schedule);
+
+/**
+ * @brief Hand the next admissible entry to a worker process
+ *
+ * @param worker Reference to worker bookkeeping.
+ * @param schedule Reference to schedule.
+ * @return int 0 on success, 1 if no entry can be handed out or writing to the worker failed.
+ */
+int dispatchEntry(workerHandle *worker, workerSchedule *schedule);
+
+/**
+ * @brief Release budget of an entry which was completed or abandoned by a worker
+ *
+ * @param worker Reference to worker bookkeeping.
+ * @param schedule Reference to schedule.
+ * @param index Index of entry.
+ */
+void releaseEntry(workerHandle *worker, workerSchedule *schedule, size_t index);
+
+/**
+ * @brief Hand out admissible entries to all workers with spare capacity
+ *
+ * @note Task pipes are closed once all entries were handed out, which lets workers exit after
+ *       finishing their backlog.
+ *
+ * @param workers Array of worker bookkeeping.
+ * @param workerCount Number of workers.
+ * @param schedule Reference to schedule.
+ * @param depth Number of entries a worker may hold at once.
+ */
+void fillIdleWorkers(workerHandle *workers, size_t workerCount, workerSchedule *schedule,
+                     size_t depth);
+
+/**
+ * @brief Process all entries supplied by a provider with multiple worker processes
+ *
+ * @details The calling process forks `options->jobs` workers after the area of interest was read,
+ *          thus workers share it copy-on-write. Entries are handed out one at a time (two if
+ *          the pipelined mode is used) as soon as a worker reports a completed entry, so that
+ *          workers never sit idle while other workers still have a backlog. If a memory budget
+ *          is set, entries are only handed out while the sum of their estimated footprints fits it. Completions are
+ *          passed back to `provider->complete` in the parent, which is the only process updating
+ *          log file entries.
+ *
+ * @note When `*isWorker` is set to `true` after the function returns, the caller is a worker process and
+ *       must not write the log file. It should release its resources and exit.
+ *
+ * @param provider Reference to entry provider.
+ * @param areasOfInterest Reference to vector of AOI geometries.
+ * @param options Reference to parsed options struct.
+ * @param isWorker Reference to flag set if the function returns in a worker process.
+ * @return int 0 on success, 1 on error.
+ */
+int runWorkers(entryProvider *provider, vectorGeometryVector *areasOfInterest,
+               const option_t *options, bool *isWorker);
+
+/** @} */ // end of group
+#endif // WORKERS_H